@@ -0,0 +1,150 @@
+#include "containers.hpp"
+#include <stdio.h>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+
+#define BENCH_ITEMS (1u << 20)
+#define BENCH_SMALL_ROUNDS (1u << 18)
+#define BENCH_SMALL_ITEMS 6
+
+// keeps the optimizer from dropping the work being measured
+static volatile uint64_t sink;
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t start_ns) {
+  printf("%-44s %9.2fms\n", name, (now_ns() - start_ns) / 1e6);
+}
+
+static void bench_push(mem_allocator *allocator, const char *name) {
+  uint64_t start = now_ns();
+  dyn_array<uint64_t> array = dyn_array_init<uint64_t>(allocator, 0);
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    dyn_array_push(&array, i);
+  }
+  sink = array.data[array.count - 1];
+  dyn_array_destroy(&array);
+  report(name, start);
+}
+
+static void bench_small(mem_allocator *allocator) {
+  uint64_t start = now_ns();
+  uint64_t sum = 0;
+  for (uint32_t round = 0; round < BENCH_SMALL_ROUNDS; round++) {
+    small_array<uint32_t, 8> array;
+    small_array_init(&array, allocator);
+    for (uint32_t i = 0; i < BENCH_SMALL_ITEMS; i++) {
+      small_array_push(&array, round + i);
+    }
+    sum += small_array_data(&array)[array.count - 1];
+    small_array_destroy(&array);
+  }
+  sink = sum;
+  report("small_array push 6, inline", start);
+
+  start = now_ns();
+  sum = 0;
+  for (uint32_t round = 0; round < BENCH_SMALL_ROUNDS; round++) {
+    std::vector<uint32_t> vector;
+    for (uint32_t i = 0; i < BENCH_SMALL_ITEMS; i++) {
+      vector.push_back(round + i);
+    }
+    sum += vector.back();
+  }
+  sink = sum;
+  report("std::vector push 6", start);
+}
+
+static void bench_map(mem_allocator *allocator, const uint64_t *keys) {
+  uint64_t start = now_ns();
+  hash_map<uint64_t, uint32_t> map = hash_map_init<uint64_t, uint32_t>(allocator, 0);
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    hash_map_put(&map, keys[i], i);
+  }
+  report("hash_map insert", start);
+
+  start = now_ns();
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    sum += *hash_map_get(&map, keys[i]);
+  }
+  sink = sum;
+  report("hash_map lookup hit", start);
+
+  start = now_ns();
+  uint32_t found = 0;
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    found += hash_map_get(&map, keys[i] + 1) != NULL;
+  }
+  sink = found;
+  report("hash_map lookup miss", start);
+
+  start = now_ns();
+  for (uint32_t i = 0; i < BENCH_ITEMS; i += 2) {
+    hash_map_remove(&map, keys[i]);
+  }
+  report("hash_map remove half", start);
+  hash_map_destroy(&map);
+
+  start = now_ns();
+  std::unordered_map<uint64_t, uint32_t> std_map;
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    std_map[keys[i]] = i;
+  }
+  report("std::unordered_map insert", start);
+
+  start = now_ns();
+  sum = 0;
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    sum += std_map.find(keys[i])->second;
+  }
+  sink = sum;
+  report("std::unordered_map lookup hit", start);
+
+  start = now_ns();
+  found = 0;
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    found += std_map.find(keys[i] + 1) != std_map.end();
+  }
+  sink = found;
+  report("std::unordered_map lookup miss", start);
+
+  start = now_ns();
+  for (uint32_t i = 0; i < BENCH_ITEMS; i += 2) {
+    std_map.erase(keys[i]);
+  }
+  report("std::unordered_map remove half", start);
+}
+
+int main() {
+  mem_allocator arena = allocator_arena_init(256 * MB);
+  mem_allocator free_list = allocator_free_list_init(256 * MB);
+
+  bench_push(&arena, "dyn_array push, arena");
+  bench_push(&free_list, "dyn_array push, free list");
+  uint64_t start = now_ns();
+  std::vector<uint64_t> vector;
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    vector.push_back(i);
+  }
+  sink = vector.back();
+  report("std::vector push", start);
+
+  bench_small(&free_list);
+
+  // even keys, so every key plus one is a miss
+  uint64_t *keys = allocator_alloc(&arena, uint64_t, BENCH_ITEMS);
+  for (uint32_t i = 0; i < BENCH_ITEMS; i++) {
+    keys[i] = hash_u64(i) & ~1ull;
+  }
+  bench_map(&free_list, keys);
+
+  allocator_destroy(&free_list);
+  allocator_destroy(&arena);
+  return 0;
+}
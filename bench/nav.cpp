@@ -0,0 +1,188 @@
+#include "nav.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_GRID_SIZE 1024
+#define BENCH_AGENTS 100000
+#define BENCH_FRAMES 60
+#define BENCH_WORKERS 4
+#define BENCH_GOALS 4
+
+// keeps the optimizer from dropping the work being measured
+static volatile float sink;
+
+static uint32_t rng_state = 0x9E3779B9;
+
+static uint32_t next_random() {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static uint64_t now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void report(const char *name, uint64_t start_ns) {
+  printf("%-44s %9.2fms\n", name, (now_ns() - start_ns) / 1e6);
+}
+
+// Walls with gaps and patches of rough ground, the same for every grid.
+static void fill_grid(nav_grid *grid) {
+  rng_state = 0x9E3779B9;
+  for (uint32_t wall = 0; wall < 400; wall++) {
+    uint32_t x = next_random() % BENCH_GRID_SIZE;
+    uint32_t y = next_random() % BENCH_GRID_SIZE;
+    bool horizontal = next_random() & 1;
+    uint32_t length = 20 + next_random() % 200;
+    for (uint32_t i = 0; i < length; i++) {
+      uint32_t wx = horizontal ? x + i : x;
+      uint32_t wy = horizontal ? y : y + i;
+      if (wx < BENCH_GRID_SIZE && wy < BENCH_GRID_SIZE && i % 50 != 25) {
+        nav_set_cost(grid, wx, wy, NAV_BLOCKED);
+      }
+    }
+  }
+  for (uint32_t patch = 0; patch < 2000; patch++) {
+    uint32_t x = next_random() % (BENCH_GRID_SIZE - 16);
+    uint32_t y = next_random() % (BENCH_GRID_SIZE - 16);
+    uint8_t cost = 2 + next_random() % 8;
+    for (uint32_t py = 0; py < 16; py++) {
+      for (uint32_t px = 0; px < 16; px++) {
+        if (nav_get_cost(grid, x + px, y + py) != NAV_BLOCKED) {
+          nav_set_cost(grid, x + px, y + py, cost);
+        }
+      }
+    }
+  }
+}
+
+static void init_grid(nav_grid *grid, platform_jobs *jobs, mem_allocator *allocator) {
+  nav_grid_init(grid,
+                (nav_config){
+                    .width = BENCH_GRID_SIZE,
+                    .height = BENCH_GRID_SIZE,
+                    .cell_size = 1.0f,
+                    .max_fields = BENCH_GOALS,
+                },
+                jobs, allocator);
+  fill_grid(grid);
+}
+
+static void bench_build(nav_grid *grid, const char *name) {
+  uint64_t start = now_ns();
+  for (uint32_t goal = 0; goal < BENCH_GOALS; goal++) {
+    nav_get_field(grid, 100 + goal * 250, 512);
+  }
+  report(name, start);
+}
+
+static void bench_agents(nav_grid *grid) {
+  glm::vec2 *positions = new glm::vec2[BENCH_AGENTS];
+  for (uint32_t i = 0; i < BENCH_AGENTS; i++) {
+    positions[i] = glm::vec2(next_random() % BENCH_GRID_SIZE, next_random() % BENCH_GRID_SIZE) + 0.5f;
+  }
+
+  uint64_t start = now_ns();
+  for (uint32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+    nav_field *fields[BENCH_GOALS];
+    for (uint32_t goal = 0; goal < BENCH_GOALS; goal++) {
+      fields[goal] = nav_get_field(grid, 100 + goal * 250, 512);
+    }
+    for (uint32_t i = 0; i < BENCH_AGENTS; i++) {
+      nav_field *field = fields[i % BENCH_GOALS];
+      positions[i] += nav_get_direction(grid, field, positions[i]) * 0.25f;
+    }
+  }
+  sink = positions[BENCH_AGENTS - 1].x;
+  report("100k agents steering, 60 frames, 4 goals", start);
+  delete[] positions;
+}
+
+static void set_gate(nav_grid *grid, bool open) {
+  for (uint32_t i = 0; i < 8; i++) {
+    nav_set_cost(grid, 600 + i, 300, open ? 1 : NAV_BLOCKED);
+  }
+}
+
+// A gate in a wall opening and closing, once repaired into every cached field and once rebuilt.
+static void bench_changes(nav_grid *grid) {
+  uint64_t start = now_ns();
+  for (uint32_t round = 0; round < BENCH_FRAMES; round++) {
+    set_gate(grid, round % 2);
+    for (uint32_t goal = 0; goal < BENCH_GOALS; goal++) {
+      nav_get_field(grid, 100 + goal * 250, 512);
+    }
+  }
+  report("gate toggled 60 times, repaired", start);
+  nav_stats stats = nav_get_stats(grid);
+  printf("%-44s %9.0f\n", "  cells recomputed per repair",
+         (double)stats.repaired_cell_count / glm::max(stats.repaired_count, 1u));
+
+  start = now_ns();
+  for (uint32_t round = 0; round < BENCH_FRAMES; round++) {
+    set_gate(grid, round % 2);
+    for (uint32_t goal = 0; goal < BENCH_GOALS; goal++) {
+      grid->fields[goal].stale = true;
+      nav_get_field(grid, 100 + goal * 250, 512);
+    }
+  }
+  report("gate toggled 60 times, rebuilt", start);
+}
+
+// The gate and a patch of rough ground change, and every repaired field has to equal a build from scratch.
+static bool check_repairs(nav_grid *grid) {
+  uint32_t cell_count = grid->config.width * grid->config.height;
+  uint32_t *integration = new uint32_t[cell_count];
+  uint8_t *directions = new uint8_t[cell_count];
+  bool matches = true;
+  for (uint32_t round = 0; round < 4; round++) {
+    set_gate(grid, round % 2);
+    for (uint32_t y = 0; y < 16; y++) {
+      for (uint32_t x = 0; x < 16; x++) {
+        if (nav_get_cost(grid, 700 + x, 500 + y) != NAV_BLOCKED) {
+          nav_set_cost(grid, 700 + x, 500 + y, round % 2 ? 1 : 9);
+        }
+      }
+    }
+    for (uint32_t goal = 0; goal < BENCH_GOALS; goal++) {
+      nav_field *field = nav_get_field(grid, 100 + goal * 250, 512);
+      memcpy(integration, field->integration, sizeof(uint32_t) * cell_count);
+      memcpy(directions, field->directions, cell_count);
+      field->stale = true;
+      field = nav_get_field(grid, 100 + goal * 250, 512);
+      matches = matches && memcmp(integration, field->integration, sizeof(uint32_t) * cell_count) == 0 &&
+                memcmp(directions, field->directions, cell_count) == 0;
+    }
+  }
+  delete[] directions;
+  delete[] integration;
+  printf("%-44s %12s\n", "repaired fields match a rebuild", matches ? "yes" : "NO");
+  return matches;
+}
+
+int main() {
+  mem_allocator allocator = allocator_free_list_init(256 * MB);
+  platform_jobs *jobs = platform_jobs_create(BENCH_WORKERS, MB);
+  printf("%ux%u grid, %u agents\n", BENCH_GRID_SIZE, BENCH_GRID_SIZE, BENCH_AGENTS);
+
+  nav_grid grid;
+  init_grid(&grid, NULL, &allocator);
+  bench_build(&grid, "build 4 fields, directions on one thread");
+  nav_grid_destroy(&grid);
+
+  init_grid(&grid, jobs, &allocator);
+  bench_build(&grid, "build 4 fields, directions in parallel tiles");
+  bench_agents(&grid);
+  bench_changes(&grid);
+  bool matches = check_repairs(&grid);
+  nav_grid_destroy(&grid);
+
+  platform_jobs_destroy(jobs);
+  allocator_destroy(&allocator);
+  return matches ? 0 : 1;
+}
@@ -3,18 +3,18 @@
 out vec4 FragColor;
 
 in vec2 TexCoord;
+in vec4 Color;
+in float SingleChannel;
 
 uniform sampler2D uTexture;
-uniform vec4 uColor; 
-uniform bool uIsSingleChannel;
 
 void main() {
     vec4 texColor = texture(uTexture, TexCoord);
     
-    if (uIsSingleChannel) {
-        FragColor = vec4(uColor.rgb, texColor.r * uColor.a);
+    if (SingleChannel > 0.5) {
+        FragColor = vec4(Color.rgb, texColor.r * Color.a);
     } else {
-        vec3 blendedColor = mix(texColor.rgb, uColor.rgb, uColor.a);
+        vec3 blendedColor = mix(texColor.rgb, Color.rgb, Color.a);
         FragColor = vec4(blendedColor, texColor.a);
     }
 }
@@ -2,8 +2,12 @@
 
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+layout (location = 3) in float aSingleChannel;
 
 out vec2 TexCoord;
+out vec4 Color;
+out float SingleChannel;
 
 uniform mat4 model;
 uniform mat4 view;
@@ -12,4 +16,6 @@ uniform mat4 projection;
 void main() {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
     TexCoord = aTexCoord;
+    Color = aColor;
+    SingleChannel = aSingleChannel;
 }
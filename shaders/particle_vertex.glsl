@@ -0,0 +1,19 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aInstancePosSize;
+layout (location = 3) in vec4 aInstanceColor;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+    vec3 pos = aInstancePosSize.xyz + vec3(aPos.xy * aInstancePosSize.w, 0.0);
+    gl_Position = projection * view * vec4(pos, 1.0);
+    TexCoord = aTexCoord;
+    Color = aInstanceColor;
+}
@@ -0,0 +1,285 @@
+#include "atlas.hpp"
+#include <string.h>
+
+void atlas_init(atlas *atlas, atlas_config config) {
+  assert(config.page_size > 0 && config.page_size <= config.max_page_size);
+  *atlas = {};
+  atlas->config = config;
+}
+
+void atlas_destroy(atlas *atlas, struct renderer *renderer, mem_allocator *allocator) {
+  for (uint32_t i = 0; i < atlas->page_count; i++) {
+    atlas_page *page = &atlas->pages[i];
+    renderer_delete_texture(renderer, (render_cmd_delete_texture){.texture_id = &page->texture_id});
+    allocator_dealloc(allocator, page->retired_pixels);
+    allocator_dealloc(allocator, page->pixels);
+  }
+  atlas->page_count = 0;
+  atlas->sprite_count = 0;
+}
+
+static void add_page(atlas *atlas, mem_allocator *allocator) {
+  assert(atlas->page_count < ATLAS_MAX_PAGES && "Out of atlas pages");
+  atlas_page *page = &atlas->pages[atlas->page_count++];
+  uint32_t size = atlas->config.page_size;
+  *page = {};
+  page->size = size;
+  page->pixels = allocator_alloc(allocator, uint8_t, size * size * 4);
+  assert(page->pixels != NULL);
+  memset(page->pixels, 0, size * size * 4);
+  page->nodes[0] = (atlas_skyline_node){.x = 0, .y = 0, .width = size};
+  page->node_count = 1;
+}
+
+static bool grow_page(atlas *atlas, atlas_page *page, mem_allocator *allocator) {
+  if (page->size * 2 > atlas->config.max_page_size) {
+    return false;
+  }
+  uint32_t old_size = page->size;
+  uint32_t size = old_size * 2;
+  uint8_t *pixels = allocator_alloc(allocator, uint8_t, size * size * 4);
+  assert(pixels != NULL);
+  memset(pixels, 0, size * size * 4);
+  for (uint32_t y = 0; y < old_size; y++) {
+    memcpy(pixels + y * size * 4, page->pixels + y * old_size * 4, old_size * 4);
+  }
+  // an upload queued for the page may still read the old pixels, they go once atlas_upload cancelled it
+  if (page->retired_pixels == NULL) {
+    page->retired_pixels = page->pixels;
+  } else {
+    allocator_dealloc(allocator, page->pixels);
+  }
+  page->pixels = pixels;
+  page->size = size;
+
+  // the new columns on the right are empty from the bottom up, the rows above were always free
+  assert(page->node_count < ATLAS_MAX_SKYLINE_NODES);
+  page->nodes[page->node_count++] = (atlas_skyline_node){.x = old_size, .y = 0, .width = old_size};
+  page->resized = true;
+  page->dirty = true;
+  return true;
+}
+
+// Returns the lowest y a rect of `width` can rest at when its left edge sits on node `index`.
+static bool skyline_fit(atlas_page *page, uint32_t index, uint32_t width, uint32_t height, uint32_t *y) {
+  uint32_t x = page->nodes[index].x;
+  if (x + width > page->size) {
+    return false;
+  }
+  uint32_t top = 0;
+  uint32_t remaining = width;
+  for (uint32_t i = index; remaining > 0; i++) {
+    assert(i < page->node_count);
+    top = glm::max(top, page->nodes[i].y);
+    if (top + height > page->size) {
+      return false;
+    }
+    remaining -= glm::min(remaining, page->nodes[i].width);
+  }
+  *y = top;
+  return true;
+}
+
+static void skyline_insert(atlas_page *page, uint32_t index, uint32_t x, uint32_t y, uint32_t width) {
+  assert(page->node_count < ATLAS_MAX_SKYLINE_NODES && "Atlas skyline is too fragmented");
+  memmove(&page->nodes[index + 1], &page->nodes[index],
+          sizeof(atlas_skyline_node) * (page->node_count - index));
+  page->nodes[index] = (atlas_skyline_node){.x = x, .y = y, .width = width};
+  page->node_count++;
+
+  // trim or drop the nodes the new one now covers
+  for (uint32_t i = index + 1; i < page->node_count;) {
+    atlas_skyline_node *prev = &page->nodes[i - 1];
+    atlas_skyline_node *node = &page->nodes[i];
+    uint32_t prev_end = prev->x + prev->width;
+    if (node->x >= prev_end) {
+      break;
+    }
+    uint32_t shrink = prev_end - node->x;
+    if (node->width > shrink) {
+      node->x += shrink;
+      node->width -= shrink;
+      break;
+    }
+    memmove(node, node + 1, sizeof(atlas_skyline_node) * (page->node_count - i - 1));
+    page->node_count--;
+  }
+
+  // merge neighbours at the same height
+  for (uint32_t i = 0; i + 1 < page->node_count;) {
+    if (page->nodes[i].y == page->nodes[i + 1].y) {
+      page->nodes[i].width += page->nodes[i + 1].width;
+      memmove(&page->nodes[i + 1], &page->nodes[i + 2],
+              sizeof(atlas_skyline_node) * (page->node_count - i - 2));
+      page->node_count--;
+    } else {
+      i++;
+    }
+  }
+}
+
+// Bottom-left heuristic: the lowest resting spot wins, ties go to the narrowest node.
+static bool skyline_pack(atlas_page *page, uint32_t width, uint32_t height, uint32_t *out_x,
+                         uint32_t *out_y) {
+  uint32_t best_index = UINT32_MAX;
+  uint32_t best_y = UINT32_MAX;
+  uint32_t best_width = UINT32_MAX;
+  for (uint32_t i = 0; i < page->node_count; i++) {
+    uint32_t y;
+    if (!skyline_fit(page, i, width, height, &y)) {
+      continue;
+    }
+    if (y + height < best_y || (y + height == best_y && page->nodes[i].width < best_width)) {
+      best_index = i;
+      best_y = y + height;
+      best_width = page->nodes[i].width;
+    }
+  }
+  if (best_index == UINT32_MAX) {
+    return false;
+  }
+  *out_x = page->nodes[best_index].x;
+  *out_y = best_y - height;
+  skyline_insert(page, best_index, *out_x, best_y, width);
+  return true;
+}
+
+static void blit(atlas_page *page, const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t x,
+                 uint32_t y, uint32_t padding, bool extrude) {
+  uint32_t stride = page->size * 4;
+  for (uint32_t row = 0; row < height; row++) {
+    memcpy(page->pixels + (y + row) * stride + x * 4, pixels + row * width * 4, width * 4);
+  }
+  if (!extrude || padding == 0) {
+    return;
+  }
+
+  // repeat the edge columns, then the edge rows including the corners
+  for (uint32_t row = 0; row < height; row++) {
+    uint8_t *line = page->pixels + (y + row) * stride;
+    for (uint32_t p = 1; p <= padding; p++) {
+      memcpy(line + (x - p) * 4, line + x * 4, 4);
+      memcpy(line + (x + width - 1 + p) * 4, line + (x + width - 1) * 4, 4);
+    }
+  }
+  uint32_t span = (width + padding * 2) * 4;
+  uint8_t *first = page->pixels + y * stride + (x - padding) * 4;
+  uint8_t *last = page->pixels + (y + height - 1) * stride + (x - padding) * 4;
+  for (uint32_t p = 1; p <= padding; p++) {
+    memcpy(first - p * stride, first, span);
+    memcpy(last + p * stride, last, span);
+  }
+}
+
+atlas_sprite atlas_add(atlas *atlas, const uint8_t *pixels, uint32_t width, uint32_t height,
+                       mem_allocator *allocator) {
+  assert(atlas->sprite_count < ATLAS_MAX_SPRITES && "Out of atlas sprites");
+  uint32_t padding = atlas->config.padding;
+  uint32_t padded_width = width + padding * 2;
+  uint32_t padded_height = height + padding * 2;
+  assert(padded_width <= atlas->config.max_page_size && padded_height <= atlas->config.max_page_size &&
+         "Image doesn't fit in an atlas page");
+
+  // try every page as it is, then let pages grow, then open a new one
+  atlas_page *page = NULL;
+  uint32_t x, y;
+  for (uint32_t i = 0; i < atlas->page_count && page == NULL; i++) {
+    if (skyline_pack(&atlas->pages[i], padded_width, padded_height, &x, &y)) {
+      page = &atlas->pages[i];
+    }
+  }
+  for (uint32_t i = 0; i < atlas->page_count && page == NULL; i++) {
+    while (grow_page(atlas, &atlas->pages[i], allocator)) {
+      if (skyline_pack(&atlas->pages[i], padded_width, padded_height, &x, &y)) {
+        page = &atlas->pages[i];
+        break;
+      }
+    }
+  }
+  while (page == NULL) {
+    add_page(atlas, allocator);
+    atlas_page *added = &atlas->pages[atlas->page_count - 1];
+    while (!skyline_pack(added, padded_width, padded_height, &x, &y)) {
+      bool grown = grow_page(atlas, added, allocator);
+      assert(grown);
+    }
+    page = added;
+  }
+
+  blit(page, pixels, width, height, x + padding, y + padding, padding, atlas->config.extrude);
+  page->dirty = true;
+  atlas->sprites[atlas->sprite_count++] = (atlas_rect){
+      .page = (uint32_t)(page - atlas->pages),
+      .x = x + padding,
+      .y = y + padding,
+      .width = width,
+      .height = height,
+  };
+  return atlas->sprite_count;
+}
+
+bool atlas_replace(atlas *atlas, atlas_sprite sprite, const uint8_t *pixels, uint32_t width,
+                   uint32_t height) {
+  assert(sprite != 0 && sprite <= atlas->sprite_count);
+  atlas_rect *rect = &atlas->sprites[sprite - 1];
+  if (rect->width != width || rect->height != height) {
+    return false;
+  }
+  atlas_page *page = &atlas->pages[rect->page];
+  blit(page, pixels, width, height, rect->x, rect->y, atlas->config.padding, atlas->config.extrude);
+  page->dirty = true;
+  return true;
+}
+
+static uint8_t *reload_page(void *user, uint32_t index, mem_allocator *temp_allocator) {
+  atlas_page *page = &((atlas *)user)->pages[index];
+  uint8_t *pixels = allocator_alloc(temp_allocator, uint8_t, page->size * page->size * 4);
+  memcpy(pixels, page->pixels, page->size * page->size * 4);
+  return pixels;
+}
+
+void atlas_upload(atlas *atlas, struct renderer *renderer, mem_allocator *allocator) {
+  for (uint32_t i = 0; i < atlas->page_count; i++) {
+    atlas_page *page = &atlas->pages[i];
+    if (!page->dirty) {
+      continue;
+    }
+    if (page->texture_id != 0 && !page->resized) {
+      renderer_update_texture(renderer, (render_cmd_update_texture){
+                                            .texture_id = page->texture_id,
+                                            .data = page->pixels,
+                                        });
+    } else {
+      // deleting the texture drops its queued uploads, so nothing reads the pixels from before a resize
+      renderer_delete_texture(renderer, (render_cmd_delete_texture){.texture_id = &page->texture_id});
+      if (page->retired_pixels != NULL) {
+        allocator_dealloc(allocator, page->retired_pixels);
+        page->retired_pixels = NULL;
+      }
+      renderer_load_texture(renderer, (render_cmd_load_texture){
+                                          .texture_id = &page->texture_id,
+                                          .data = page->pixels,
+                                          .size = glm::vec2((float)page->size),
+                                          .reload = reload_page,
+                                          .reload_user = atlas,
+                                          .reload_index = i,
+                                      });
+    }
+    page->dirty = false;
+    page->resized = false;
+  }
+}
+
+atlas_region atlas_get_region(atlas *atlas, atlas_sprite sprite) {
+  assert(sprite != 0 && sprite <= atlas->sprite_count);
+  atlas_rect *rect = &atlas->sprites[sprite - 1];
+  atlas_page *page = &atlas->pages[rect->page];
+  float inv_size = 1.0f / (float)page->size;
+  atlas_region region = {
+      .texture_id = page->texture_id,
+      .uv_rect = glm::vec4((float)rect->x, (float)rect->y, (float)(rect->x + rect->width),
+                           (float)(rect->y + rect->height)) *
+                 inv_size,
+  };
+  return region;
+}
@@ -0,0 +1,476 @@
+#include "audio.hpp"
+#include <assert.h>
+#include <string.h>
+
+static_assert((AUDIO_COMMAND_CAPACITY & (AUDIO_COMMAND_CAPACITY - 1)) == 0,
+              "Audio command capacity must be a power of two");
+
+static bool voice_is_busy(audio_voice *voice) { return voice->active && !ma_sound_at_end(&voice->sound); }
+
+static audio_voice *find_voice(audio_player *audio, uint32_t play_id) {
+  for (uint32_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+    audio_voice *voice = &audio->voices[i];
+    if (voice->active && voice->play_id == play_id) {
+      return voice;
+    }
+  }
+  return NULL;
+}
+
+static audio_voice *pick_voice(audio_player *audio, int32_t priority) {
+  audio_voice *free_voice = NULL;
+  audio_voice *victim = NULL;
+  uint32_t busy_count = 0;
+  for (uint32_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+    audio_voice *voice = &audio->voices[i];
+    if (!voice_is_busy(voice)) {
+      voice->active = false;
+      if (free_voice == NULL) {
+        free_voice = voice;
+      }
+      continue;
+    }
+    busy_count++;
+    // play ids wrap, so the oldest playback is the one furthest behind by distance
+    if (victim == NULL || voice->priority < victim->priority ||
+        (voice->priority == victim->priority && (int32_t)(voice->play_id - victim->play_id) < 0)) {
+      victim = voice;
+    }
+  }
+
+  if (free_voice != NULL && busy_count < audio->max_voices) {
+    return free_voice;
+  }
+  if (victim != NULL && victim->priority <= priority) {
+    return victim;
+  }
+  return NULL;
+}
+
+static void apply_command(audio_player *audio, audio_command *command) {
+  switch (command->type) {
+  case AUDIO_COMMAND_PLAY: {
+    audio->applied_play_id = command->play_id;
+    audio_voice *voice = pick_voice(audio, command->play.priority);
+    if (voice == NULL) {
+      break;
+    }
+    ma_sound_stop(&voice->sound);
+    ma_audio_buffer_ref_set_data(&voice->buffer, command->play.frames, command->play.frame_count);
+    ma_sound_set_volume(&voice->sound, 1.0f);
+    ma_sound_set_pitch(&voice->sound, 1.0f);
+    voice->play_id = command->play_id;
+    voice->priority = command->play.priority;
+    voice->active = true;
+    ma_sound_start(&voice->sound);
+  } break;
+
+  case AUDIO_COMMAND_STOP: {
+    audio_voice *voice = find_voice(audio, command->play_id);
+    if (voice != NULL) {
+      ma_sound_stop(&voice->sound);
+      voice->active = false;
+    }
+  } break;
+
+  case AUDIO_COMMAND_STOP_ALL:
+    for (uint32_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+      ma_sound_stop(&audio->voices[i].sound);
+      audio->voices[i].active = false;
+    }
+    break;
+
+  case AUDIO_COMMAND_SET_VOLUME: {
+    audio_voice *voice = find_voice(audio, command->play_id);
+    if (voice != NULL) {
+      ma_sound_set_volume(&voice->sound, command->value);
+    }
+  } break;
+
+  case AUDIO_COMMAND_SET_PITCH: {
+    audio_voice *voice = find_voice(audio, command->play_id);
+    if (voice != NULL) {
+      ma_sound_set_pitch(&voice->sound, command->value);
+    }
+  } break;
+
+  case AUDIO_COMMAND_STREAM_START:
+    ma_sound_start(&command->stream->sound);
+    break;
+
+  case AUDIO_COMMAND_STREAM_STOP:
+    ma_sound_stop(&command->stream->sound);
+    break;
+  }
+}
+
+// Returns false when the queue is full and the command was dropped.
+static bool push_command(audio_player *audio, audio_command command) {
+  audio_command_queue *queue = &audio->queue;
+  uint32_t write_index = queue->write_index;
+  uint32_t read_index = __atomic_load_n(&queue->read_index, __ATOMIC_ACQUIRE);
+  if (write_index - read_index == AUDIO_COMMAND_CAPACITY) {
+    __atomic_fetch_add(&queue->dropped, 1, __ATOMIC_RELAXED);
+    return false;
+  }
+  queue->commands[write_index & (AUDIO_COMMAND_CAPACITY - 1)] = command;
+  __atomic_store_n(&queue->write_index, write_index + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+static void drain_commands(audio_player *audio) {
+  audio_command_queue *queue = &audio->queue;
+  uint32_t read_index = queue->read_index;
+  uint32_t write_index = __atomic_load_n(&queue->write_index, __ATOMIC_ACQUIRE);
+  while (read_index != write_index) {
+    apply_command(audio, &queue->commands[read_index & (AUDIO_COMMAND_CAPACITY - 1)]);
+    read_index++;
+  }
+  __atomic_store_n(&queue->read_index, read_index, __ATOMIC_RELEASE);
+}
+
+static void audio_data_callback(ma_device *device, void *output, const void *input, ma_uint32 frame_count) {
+  audio_player *audio = (audio_player *)device->pUserData;
+  uint64_t start = platform_get_time_ns();
+
+  drain_commands(audio);
+  ma_engine_read_pcm_frames(&audio->engine, output, frame_count, NULL);
+
+  uint32_t active_voice_count = 0;
+  for (uint32_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+    audio_voice *voice = &audio->voices[i];
+    bool busy = voice_is_busy(voice);
+    if (busy) {
+      active_voice_count++;
+    }
+    __atomic_store_n(&audio->playing_ids[i], busy ? voice->play_id : 0, __ATOMIC_RELAXED);
+  }
+  __atomic_store_n(&audio->active_voice_count, active_voice_count, __ATOMIC_RELAXED);
+  // published after the ids, so a reader that sees a play as applied also sees whether it still plays
+  __atomic_store_n(&audio->published_play_id, audio->applied_play_id, __ATOMIC_RELEASE);
+
+  uint64_t elapsed = platform_get_time_ns() - start;
+  __atomic_store_n(&audio->callback_last_ns, elapsed, __ATOMIC_RELAXED);
+  if (elapsed > __atomic_load_n(&audio->callback_max_ns, __ATOMIC_RELAXED)) {
+    __atomic_store_n(&audio->callback_max_ns, elapsed, __ATOMIC_RELAXED);
+  }
+}
+
+void audio_init(audio_player *audio, uint32_t max_voices) {
+  assert(max_voices > 0 && max_voices <= AUDIO_MAX_VOICES);
+  *audio = {};
+  audio->max_voices = max_voices;
+  audio->next_play_id = 1;
+
+  // we own the device so the command queue can be drained right before the engine mixes
+  ma_device_config device_config = ma_device_config_init(ma_device_type_playback);
+  device_config.playback.format = ma_format_f32;
+  device_config.playback.channels = AUDIO_CHANNELS;
+  device_config.sampleRate = AUDIO_SAMPLE_RATE;
+  device_config.dataCallback = audio_data_callback;
+  device_config.pUserData = audio;
+  ma_result result = ma_device_init(NULL, &device_config, &audio->device);
+  assert(result == MA_SUCCESS);
+
+  ma_engine_config engine_config = ma_engine_config_init();
+  engine_config.pDevice = &audio->device;
+  engine_config.noAutoStart = MA_TRUE;
+  result = ma_engine_init(&engine_config, &audio->engine);
+  assert(result == MA_SUCCESS);
+
+  uint32_t channels = ma_engine_get_channels(&audio->engine);
+  for (uint32_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+    audio_voice *voice = &audio->voices[i];
+    result = ma_audio_buffer_ref_init(ma_format_f32, channels, NULL, 0, &voice->buffer);
+    assert(result == MA_SUCCESS);
+    result = ma_sound_init_from_data_source(&audio->engine, &voice->buffer, MA_SOUND_FLAG_NO_SPATIALIZATION,
+                                            NULL, &voice->sound);
+    assert(result == MA_SUCCESS);
+  }
+
+  result = ma_engine_start(&audio->engine);
+  assert(result == MA_SUCCESS);
+}
+
+void audio_destroy(audio_player *audio) {
+  ma_device_stop(&audio->device);
+  for (uint32_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+    ma_sound_uninit(&audio->voices[i].sound);
+    ma_audio_buffer_ref_uninit(&audio->voices[i].buffer);
+  }
+  ma_engine_uninit(&audio->engine);
+  ma_device_uninit(&audio->device);
+}
+
+uint32_t audio_get_channels(audio_player *audio) { return ma_engine_get_channels(&audio->engine); }
+
+uint32_t audio_get_sample_rate(audio_player *audio) { return ma_engine_get_sample_rate(&audio->engine); }
+
+uint32_t audio_play(audio_player *audio, audio_cmd_play play) {
+  assert(play.frames != NULL);
+  uint32_t play_id = audio->next_play_id;
+  // a dropped play must not take an id, it would stay ahead of the published one and look queued forever
+  if (!push_command(audio, (audio_command){.type = AUDIO_COMMAND_PLAY, .play_id = play_id, .play = play})) {
+    return 0;
+  }
+  audio->next_play_id++;
+  if (audio->next_play_id == 0) {
+    audio->next_play_id = 1;
+  }
+  return play_id;
+}
+
+void audio_stop(audio_player *audio, uint32_t play_id) {
+  push_command(audio, (audio_command){.type = AUDIO_COMMAND_STOP, .play_id = play_id});
+}
+
+void audio_stop_all(audio_player *audio) {
+  push_command(audio, (audio_command){.type = AUDIO_COMMAND_STOP_ALL});
+}
+
+void audio_set_volume(audio_player *audio, uint32_t play_id, float volume) {
+  push_command(audio, (audio_command){.type = AUDIO_COMMAND_SET_VOLUME, .play_id = play_id, .value = volume});
+}
+
+void audio_set_pitch(audio_player *audio, uint32_t play_id, float pitch) {
+  push_command(audio, (audio_command){.type = AUDIO_COMMAND_SET_PITCH, .play_id = play_id, .value = pitch});
+}
+
+uint32_t audio_get_active_voice_count(audio_player *audio) {
+  return __atomic_load_n(&audio->active_voice_count, __ATOMIC_RELAXED);
+}
+
+bool audio_is_playing(audio_player *audio, uint32_t play_id) {
+  if (play_id == 0) {
+    return false;
+  }
+  // still in the queue, play ids wrap so they are compared by their distance
+  if ((int32_t)(play_id - __atomic_load_n(&audio->published_play_id, __ATOMIC_ACQUIRE)) > 0) {
+    return true;
+  }
+  for (uint32_t i = 0; i < AUDIO_MAX_VOICES; i++) {
+    if (__atomic_load_n(&audio->playing_ids[i], __ATOMIC_RELAXED) == play_id) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void audio_get_callback_stats(audio_player *audio, uint64_t *last_ns, uint64_t *max_ns, uint32_t *dropped) {
+  *last_ns = __atomic_load_n(&audio->callback_last_ns, __ATOMIC_RELAXED);
+  *max_ns = __atomic_load_n(&audio->callback_max_ns, __ATOMIC_RELAXED);
+  *dropped = __atomic_load_n(&audio->queue.dropped, __ATOMIC_RELAXED);
+}
+
+static void stream_decode_thread(void *data) {
+  audio_stream *stream = (audio_stream *)data;
+  uint32_t handled_generation = 0;
+  uint64_t cursor = 0;
+  bool at_end = false;
+  // set by a jump back to the loop start until it decoded something, so a loop that reads nothing ends
+  // instead of spinning without ever sleeping
+  bool looped_empty = false;
+
+  while (__atomic_load_n(&stream->running, __ATOMIC_ACQUIRE)) {
+    uint32_t seek_generation = __atomic_load_n(&stream->seek_generation, __ATOMIC_ACQUIRE);
+    if (seek_generation != handled_generation) {
+      cursor = __atomic_load_n(&stream->seek_target, __ATOMIC_RELAXED);
+      ma_decoder_seek_to_pcm_frame(&stream->decoder, cursor);
+      handled_generation = seek_generation;
+      at_end = false;
+      looped_empty = false;
+      __atomic_store_n(&stream->decode_finished, 0, __ATOMIC_RELEASE);
+      __atomic_store_n(&stream->flush_generation, seek_generation, __ATOMIC_RELEASE);
+    }
+
+    // frames queued before a seek must be dropped by the audio thread before we write new ones
+    bool flushed = __atomic_load_n(&stream->consumer_generation, __ATOMIC_ACQUIRE) == handled_generation;
+    if (!flushed || at_end || ma_pcm_rb_available_write(&stream->ring) < stream->chunk_frames) {
+      platform_sleep_ms(AUDIO_STREAM_POLL_MS);
+      continue;
+    }
+
+    bool loop = __atomic_load_n(&stream->loop, __ATOMIC_RELAXED);
+    ma_uint32 frames = stream->chunk_frames;
+    if (loop && stream->loop_end > cursor && stream->loop_end - cursor < frames) {
+      frames = (ma_uint32)(stream->loop_end - cursor);
+    }
+    void *buffer;
+    ma_pcm_rb_acquire_write(&stream->ring, &frames, &buffer);
+    ma_uint64 frames_read = 0;
+    ma_result result = ma_decoder_read_pcm_frames(&stream->decoder, buffer, frames, &frames_read);
+    ma_pcm_rb_commit_write(&stream->ring, (ma_uint32)frames_read);
+    cursor += frames_read;
+    if (frames_read > 0) {
+      looped_empty = false;
+    }
+
+    bool reached_end = result != MA_SUCCESS || frames_read < frames;
+    if (loop && stream->loop_end != 0 && cursor >= stream->loop_end) {
+      reached_end = true;
+    }
+    if (reached_end) {
+      if (loop && !looped_empty &&
+          ma_decoder_seek_to_pcm_frame(&stream->decoder, stream->loop_start) == MA_SUCCESS) {
+        cursor = stream->loop_start;
+        looped_empty = true;
+      } else {
+        at_end = true;
+        __atomic_store_n(&stream->decode_finished, 1, __ATOMIC_RELEASE);
+      }
+    }
+  }
+}
+
+static ma_result stream_read(ma_data_source *data_source, void *frames_out, ma_uint64 frame_count,
+                             ma_uint64 *frames_read) {
+  audio_stream *stream = (audio_stream *)data_source;
+  // read before draining so the last frames committed before the flag are never lost
+  bool decode_finished = __atomic_load_n(&stream->decode_finished, __ATOMIC_ACQUIRE);
+
+  uint32_t flush_generation = __atomic_load_n(&stream->flush_generation, __ATOMIC_ACQUIRE);
+  if (flush_generation != __atomic_load_n(&stream->consumer_generation, __ATOMIC_RELAXED)) {
+    ma_pcm_rb_seek_read(&stream->ring, ma_pcm_rb_available_read(&stream->ring));
+    __atomic_store_n(&stream->consumer_generation, flush_generation, __ATOMIC_RELEASE);
+    decode_finished = false;
+  }
+
+  size_t frame_size = sizeof(float) * stream->channels;
+  ma_uint64 total = 0;
+  while (total < frame_count) {
+    ma_uint64 remaining = frame_count - total;
+    ma_uint32 frames = remaining > UINT32_MAX ? UINT32_MAX : (ma_uint32)remaining;
+    void *buffer;
+    ma_pcm_rb_acquire_read(&stream->ring, &frames, &buffer);
+    if (frames == 0) {
+      break;
+    }
+    if (frames_out != NULL) {
+      memcpy((unsigned char *)frames_out + total * frame_size, buffer, frames * frame_size);
+    }
+    ma_pcm_rb_commit_read(&stream->ring, frames);
+    total += frames;
+  }
+
+  if (total < frame_count) {
+    bool seek_pending = __atomic_load_n(&stream->seek_generation, __ATOMIC_ACQUIRE) !=
+                        __atomic_load_n(&stream->consumer_generation, __ATOMIC_RELAXED);
+    if (decode_finished && !seek_pending) {
+      *frames_read = total;
+      return total == 0 ? MA_AT_END : MA_SUCCESS;
+    }
+    // the decoder fell behind, play silence rather than ending the sound
+    if (frames_out != NULL) {
+      memset((unsigned char *)frames_out + total * frame_size, 0, (frame_count - total) * frame_size);
+    }
+    total = frame_count;
+  }
+  *frames_read = total;
+  return MA_SUCCESS;
+}
+
+static ma_result stream_seek(ma_data_source *data_source, ma_uint64 frame) {
+  audio_stream_seek((audio_stream *)data_source, frame);
+  return MA_SUCCESS;
+}
+
+static ma_result stream_get_data_format(ma_data_source *data_source, ma_format *format, ma_uint32 *channels,
+                                        ma_uint32 *sample_rate, ma_channel *channel_map,
+                                        size_t channel_map_cap) {
+  audio_stream *stream = (audio_stream *)data_source;
+  *format = ma_format_f32;
+  *channels = stream->channels;
+  *sample_rate = stream->sample_rate;
+  ma_channel_map_init_standard(ma_standard_channel_map_default, channel_map, channel_map_cap,
+                               stream->channels);
+  return MA_SUCCESS;
+}
+
+static ma_result stream_set_looping(ma_data_source *data_source, ma_bool32 is_looping) {
+  audio_stream_set_loop((audio_stream *)data_source, is_looping);
+  return MA_SUCCESS;
+}
+
+static ma_data_source_vtable stream_vtable = {
+    .onRead = stream_read,
+    .onSeek = stream_seek,
+    .onGetDataFormat = stream_get_data_format,
+    .onGetCursor = NULL,
+    .onGetLength = NULL,
+    .onSetLooping = stream_set_looping,
+    .flags = 0,
+};
+
+void audio_stream_init(audio_stream *stream, audio_player *audio, audio_cmd_stream cmd,
+                       mem_allocator *allocator) {
+  *stream = {};
+  stream->channels = audio_get_channels(audio);
+  stream->sample_rate = audio_get_sample_rate(audio);
+  stream->loop_start = cmd.loop_start;
+  stream->loop_end = cmd.loop_end;
+
+  ma_decoder_config config = ma_decoder_config_init(ma_format_f32, stream->channels, stream->sample_rate);
+  ma_result result;
+  if (cmd.data != NULL) {
+    result = ma_decoder_init_memory(cmd.data, cmd.size, &config, &stream->decoder);
+  } else {
+    result = ma_decoder_init_file(cmd.path, &config, &stream->decoder);
+  }
+  assert(result == MA_SUCCESS);
+
+  // half a second of audio unless told otherwise, refilled a quarter at a time
+  uint32_t budget_frames = cmd.budget_frames != 0 ? cmd.budget_frames : stream->sample_rate / 2;
+  stream->chunk_frames = budget_frames / 4;
+  stream->ring_memory = allocator_alloc(allocator, float, budget_frames * stream->channels);
+  assert(stream->ring_memory != NULL);
+  result = ma_pcm_rb_init(ma_format_f32, stream->channels, budget_frames, stream->ring_memory, NULL,
+                          &stream->ring);
+  assert(result == MA_SUCCESS);
+
+  ma_data_source_config source_config = ma_data_source_config_init();
+  source_config.vtable = &stream_vtable;
+  result = ma_data_source_init(&source_config, &stream->base);
+  assert(result == MA_SUCCESS);
+  result = ma_sound_init_from_data_source(&audio->engine, stream, MA_SOUND_FLAG_NO_SPATIALIZATION, NULL,
+                                          &stream->sound);
+  assert(result == MA_SUCCESS);
+  // initializing the sound resets looping on its data source
+  ma_sound_set_looping(&stream->sound, cmd.loop);
+
+  stream->running = 1;
+  stream->thread = platform_thread_create(stream_decode_thread, stream);
+}
+
+void audio_stream_destroy(audio_stream *stream, audio_player *audio, mem_allocator *allocator) {
+  // the audio thread may still hold a start or stop command pointing at this stream
+  audio_command_queue *queue = &audio->queue;
+  while (ma_device_is_started(&audio->device) &&
+         __atomic_load_n(&queue->read_index, __ATOMIC_ACQUIRE) != queue->write_index) {
+    platform_sleep_ms(1);
+  }
+  ma_sound_uninit(&stream->sound);
+  __atomic_store_n(&stream->running, 0, __ATOMIC_RELEASE);
+  platform_thread_join(stream->thread);
+  ma_data_source_uninit(&stream->base);
+  ma_pcm_rb_uninit(&stream->ring);
+  ma_decoder_uninit(&stream->decoder);
+  allocator_dealloc(allocator, stream->ring_memory);
+  stream->ring_memory = NULL;
+}
+
+void audio_stream_start(audio_player *audio, audio_stream *stream) {
+  push_command(audio, (audio_command){.type = AUDIO_COMMAND_STREAM_START, .stream = stream});
+}
+
+void audio_stream_stop(audio_player *audio, audio_stream *stream) {
+  push_command(audio, (audio_command){.type = AUDIO_COMMAND_STREAM_STOP, .stream = stream});
+}
+
+void audio_stream_seek(audio_stream *stream, uint64_t frame) {
+  __atomic_store_n(&stream->seek_target, frame, __ATOMIC_RELAXED);
+  __atomic_fetch_add(&stream->seek_generation, 1, __ATOMIC_RELEASE);
+}
+
+void audio_stream_set_loop(audio_stream *stream, bool loop) {
+  __atomic_store_n(&stream->loop, loop ? 1 : 0, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,211 @@
+#include "capture.hpp"
+#include <stb_image.h>
+#include <stdio.h>
+#include <string.h>
+
+void capture_init(frame_capture *capture, capture_config config, platform_jobs *jobs,
+                  mem_allocator *allocator) {
+  *capture = {};
+  capture->config = config;
+  capture->jobs = jobs;
+  capture->allocator = allocator;
+  if (config.record_dir != NULL) {
+    platform_create_directory(config.record_dir);
+  }
+  // set once the golden frame was captured
+  capture->golden_sequence = UINT32_MAX;
+  if (config.golden_path != NULL) {
+    capture->golden.state = CAPTURE_GOLDEN_PENDING;
+  }
+}
+
+static void finish_golden(frame_capture *capture, bool passed, uint32_t mismatch_count,
+                          uint32_t max_difference) {
+  capture->golden.mismatch_count = mismatch_count;
+  capture->golden.max_difference = max_difference;
+  __atomic_store_n(&capture->golden.state, passed ? CAPTURE_GOLDEN_PASSED : CAPTURE_GOLDEN_FAILED,
+                   __ATOMIC_RELEASE);
+}
+
+// Packs the frame into a PPM in its own buffer, which only shrinks since every pixel loses its alpha.
+static uintptr_t pack_ppm(render_capture *frame) {
+  char header[64];
+  int header_size = snprintf(header, sizeof(header), "P6\n%u %u\n255\n", frame->width, frame->height);
+  uintptr_t pixel_count = (uintptr_t)frame->width * frame->height;
+  assert(pixel_count >= (uintptr_t)header_size);
+  for (uintptr_t i = 0; i < pixel_count; i++) {
+    memmove(frame->pixels + i * 3, frame->pixels + i * 4, 3);
+  }
+  memmove(frame->pixels + header_size, frame->pixels, pixel_count * 3);
+  memcpy(frame->pixels, header, header_size);
+  return header_size + pixel_count * 3;
+}
+
+static void compare_golden(frame_capture *capture, render_capture *frame) {
+  const char *path = capture->config.golden_path;
+  if (!platform_file_exists(path)) {
+    platform_log_error("Golden image %s doesn't exist", path);
+    finish_golden(capture, false, 0, 0);
+    return;
+  }
+  int width, height, channels;
+  uint8_t *golden = stbi_load(path, &width, &height, &channels, 4);
+  if (golden == NULL || (uint32_t)width != frame->width || (uint32_t)height != frame->height) {
+    platform_log_error("Golden image %s doesn't match the %ux%u frame", path, frame->width, frame->height);
+    stbi_image_free(golden);
+    finish_golden(capture, false, 0, 0);
+    return;
+  }
+
+  uint32_t mismatch_count = 0;
+  uint32_t max_difference = 0;
+  uintptr_t pixel_count = (uintptr_t)frame->width * frame->height;
+  for (uintptr_t i = 0; i < pixel_count; i++) {
+    uint32_t difference = 0;
+    for (uint32_t c = 0; c < 3; c++) {
+      int delta = (int)frame->pixels[i * 4 + c] - (int)golden[i * 4 + c];
+      difference = glm::max(difference, (uint32_t)glm::abs(delta));
+    }
+    max_difference = glm::max(max_difference, difference);
+    if (difference > capture->config.golden_tolerance) {
+      mismatch_count++;
+    }
+  }
+  stbi_image_free(golden);
+  finish_golden(capture, mismatch_count == 0, mismatch_count, max_difference);
+}
+
+// Nothing here goes through the worker's scratch, which is sized for asset files and not for frames.
+static void capture_job_run(void *data, mem_allocator *scratch) {
+  capture_job *job = (capture_job *)data;
+  frame_capture *capture = job->capture;
+  // a failed frame is kept next to the reference to look at
+  bool keep_failed = false;
+  if (job->golden) {
+    compare_golden(capture, &job->frame);
+    keep_failed = __atomic_load_n(&capture->golden.state, __ATOMIC_ACQUIRE) == CAPTURE_GOLDEN_FAILED;
+  }
+  if (keep_failed || job->path[0] != '\0') {
+    uintptr_t size = pack_ppm(&job->frame);
+    if (keep_failed) {
+      char path[CAPTURE_PATH_SIZE];
+      snprintf(path, sizeof(path), "%s.actual.ppm", capture->config.golden_path);
+      platform_write_file(path, size, job->frame.pixels);
+    }
+    if (job->path[0] != '\0') {
+      platform_write_file(job->path, size, job->frame.pixels);
+    }
+  }
+  allocator_dealloc(capture->allocator, job->frame.pixels);
+  __atomic_store_n(&job->busy, false, __ATOMIC_RELEASE);
+}
+
+static capture_job *find_free_job(frame_capture *capture) {
+  for (uint32_t i = 0; i < CAPTURE_MAX_JOBS; i++) {
+    if (!__atomic_load_n(&capture->jobs_data[i].busy, __ATOMIC_ACQUIRE)) {
+      return &capture->jobs_data[i];
+    }
+  }
+  return NULL;
+}
+
+static void read_captures(frame_capture *capture, struct renderer *renderer, bool wait) {
+  while (capture->read_count != capture->captured_count) {
+    // frames stay in the renderer's buffers until a job can take them
+    capture_job *job = find_free_job(capture);
+    if (job == NULL) {
+      if (!wait) {
+        return;
+      }
+      platform_jobs_wait(capture->jobs);
+      continue;
+    }
+    render_capture frame;
+    if (!renderer_read_capture(renderer, capture->allocator, wait, &frame)) {
+      return;
+    }
+    uint32_t sequence = capture->read_count++;
+    job->capture = capture;
+    job->frame = frame;
+    job->golden = capture->golden.state == CAPTURE_GOLDEN_PENDING && sequence == capture->golden_sequence;
+    job->path[0] = '\0';
+    if (capture->config.record_dir != NULL) {
+      snprintf(job->path, sizeof(job->path), "%s/frame_%06u.ppm", capture->config.record_dir, sequence);
+    }
+    job->busy = true;
+    platform_jobs_push(capture->jobs, capture_job_run, job);
+  }
+}
+
+// Nothing streams anymore when the only jobs left are the capture's own and every texture is on the GPU.
+static bool is_idle(frame_capture *capture, struct renderer *renderer) {
+  uint32_t busy_count = 0;
+  for (uint32_t i = 0; i < CAPTURE_MAX_JOBS; i++) {
+    busy_count += __atomic_load_n(&capture->jobs_data[i].busy, __ATOMIC_ACQUIRE);
+  }
+  return platform_jobs_get_pending_count(capture->jobs) <= busy_count &&
+         renderer_get_pending_upload_count(renderer) == 0;
+}
+
+void capture_end_frame(frame_capture *capture, struct renderer *renderer) {
+  // a load that finished late in a frame only shows in the next one, so idle has to hold for a few frames
+  if (capture->idle_frames < CAPTURE_SETTLE_FRAMES) {
+    capture->idle_frames = is_idle(capture, renderer) ? capture->idle_frames + 1 : 0;
+  }
+  bool settled = capture->idle_frames == CAPTURE_SETTLE_FRAMES;
+  bool golden = capture->config.golden_path != NULL && settled &&
+                capture->frame_count == capture->config.golden_frame;
+  if (capture->config.record_dir != NULL || golden) {
+    if (renderer_capture_frame(renderer)) {
+      if (golden) {
+        capture->golden_sequence = capture->captured_count;
+      }
+      capture->captured_count++;
+    } else {
+      capture->dropped_count++;
+      if (golden) {
+        platform_log_error("Golden frame %u was dropped", capture->frame_count);
+        finish_golden(capture, false, 0, 0);
+      }
+    }
+  }
+  if (settled) {
+    capture->frame_count++;
+  }
+  read_captures(capture, renderer, false);
+}
+
+void capture_handle_context_lost(frame_capture *capture) {
+  bool golden_lost =
+      capture->golden_sequence != UINT32_MAX && capture->golden_sequence >= capture->read_count;
+  capture->dropped_count += capture->captured_count - capture->read_count;
+  capture->read_count = capture->captured_count;
+  if (capture->golden.state != CAPTURE_GOLDEN_PENDING) {
+    return;
+  }
+  if (capture->golden_sequence == UINT32_MAX) {
+    // what comes back has to settle again before frames count
+    capture->idle_frames = 0;
+    capture->frame_count = 0;
+  } else if (golden_lost) {
+    platform_log_error("Golden frame %u was lost with the context", capture->config.golden_frame);
+    finish_golden(capture, false, 0, 0);
+  }
+}
+
+void capture_destroy(frame_capture *capture, struct renderer *renderer) {
+  read_captures(capture, renderer, true);
+  platform_jobs_wait(capture->jobs);
+  if (capture->config.record_dir != NULL) {
+    platform_log_info("Captured %u frames to %s, %u dropped", capture->read_count, capture->config.record_dir,
+                      capture->dropped_count);
+  }
+  *capture = {};
+}
+
+capture_golden_result capture_get_golden_result(frame_capture *capture) {
+  capture_golden_result result = {.state = __atomic_load_n(&capture->golden.state, __ATOMIC_ACQUIRE)};
+  result.mismatch_count = capture->golden.mismatch_count;
+  result.max_difference = capture->golden.max_difference;
+  return result;
+}
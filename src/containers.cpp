@@ -0,0 +1,15 @@
+#include "containers.hpp"
+
+uint64_t hash_bytes(const void *data, size_t size) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  uint64_t hash = 0x9E3779B97F4A7C15ull ^ size;
+  // eight bytes per round, the tail is zero padded
+  for (; size >= 8; size -= 8, bytes += 8) {
+    uint64_t word;
+    memcpy(&word, bytes, 8);
+    hash = hash_u64(hash ^ word);
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, bytes, size);
+  return hash_u64(hash ^ tail);
+}
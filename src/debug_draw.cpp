@@ -0,0 +1,167 @@
+#include "debug_draw.hpp"
+#include <math.h>
+
+void debug_draw_init(debug_draw *draw, mem_allocator *allocator, mem_allocator *temp_allocator) {
+  *draw = {};
+  draw->timed = dyn_array_init<debug_shape>(allocator, 0);
+  draw->temp_allocator = temp_allocator;
+}
+
+void debug_draw_destroy(debug_draw *draw) {
+  dyn_array_destroy(&draw->timed);
+  *draw = {};
+}
+
+static void push_line(debug_draw *draw, glm::vec3 from, glm::vec3 to, glm::vec4 color) {
+  dyn_array_push(&draw->lines, (render_debug_vertex){.pos = from, .color = color});
+  dyn_array_push(&draw->lines, (render_debug_vertex){.pos = to, .color = color});
+}
+
+static void push_triangle(debug_draw *draw, glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::vec4 color) {
+  dyn_array_push(&draw->triangles, (render_debug_vertex){.pos = a, .color = color});
+  dyn_array_push(&draw->triangles, (render_debug_vertex){.pos = b, .color = color});
+  dyn_array_push(&draw->triangles, (render_debug_vertex){.pos = c, .color = color});
+}
+
+static void emit_line(debug_draw *draw, debug_cmd_line line) {
+  push_line(draw, line.from, line.to, line.color / 255.0f);
+}
+
+static void emit_rect(debug_draw *draw, debug_cmd_rect rect) {
+  glm::vec4 color = rect.color / 255.0f;
+  glm::vec3 corners[4] = {
+      rect.min,
+      rect.min + glm::vec3(rect.size.x, 0.0f, 0.0f),
+      rect.min + glm::vec3(rect.size, 0.0f),
+      rect.min + glm::vec3(0.0f, rect.size.y, 0.0f),
+  };
+  if (rect.filled) {
+    push_triangle(draw, corners[0], corners[1], corners[2], color);
+    push_triangle(draw, corners[0], corners[2], corners[3], color);
+    return;
+  }
+  for (uint32_t i = 0; i < 4; i++) {
+    push_line(draw, corners[i], corners[(i + 1) % 4], color);
+  }
+}
+
+// Bigger circles get more segments, so they stay round without small ones costing as much.
+static void emit_circle(debug_draw *draw, debug_cmd_circle circle) {
+  glm::vec4 color = circle.color / 255.0f;
+  uint32_t segments = glm::clamp((uint32_t)(circle.radius * 0.5f), (uint32_t)DEBUG_DRAW_MIN_CIRCLE_SEGMENTS,
+                                 (uint32_t)DEBUG_DRAW_MAX_CIRCLE_SEGMENTS);
+  float step = 2.0f * (float)M_PI / segments;
+  glm::vec3 previous = circle.center + glm::vec3(circle.radius, 0.0f, 0.0f);
+  for (uint32_t i = 1; i <= segments; i++) {
+    glm::vec3 next = circle.center + glm::vec3(cosf(step * i), sinf(step * i), 0.0f) * circle.radius;
+    if (circle.filled) {
+      push_triangle(draw, circle.center, previous, next, color);
+    } else {
+      push_line(draw, previous, next, color);
+    }
+    previous = next;
+  }
+}
+
+static void emit_arrow(debug_draw *draw, debug_cmd_arrow arrow) {
+  glm::vec4 color = arrow.color / 255.0f;
+  push_line(draw, arrow.from, arrow.to, color);
+  glm::vec2 delta = glm::vec2(arrow.to - arrow.from);
+  float length = glm::length(delta);
+  if (length == 0.0f) {
+    return;
+  }
+  float head_size = arrow.head_size > 0.0f ? arrow.head_size : DEBUG_DRAW_ARROW_HEAD_SIZE;
+  head_size = glm::min(head_size, length * 0.5f);
+  glm::vec2 direction = delta / length;
+  glm::vec3 back = glm::vec3(direction * -head_size, 0.0f);
+  glm::vec3 side = glm::vec3(-direction.y, direction.x, 0.0f) * (head_size * 0.5f);
+  push_line(draw, arrow.to, arrow.to + back + side, color);
+  push_line(draw, arrow.to, arrow.to + back - side, color);
+}
+
+static void emit_shape(debug_draw *draw, debug_shape *shape) {
+  switch (shape->kind) {
+  case DEBUG_SHAPE_LINE:
+    emit_line(draw, shape->line);
+    break;
+  case DEBUG_SHAPE_RECT:
+    emit_rect(draw, shape->rect);
+    break;
+  case DEBUG_SHAPE_CIRCLE:
+    emit_circle(draw, shape->circle);
+    break;
+  case DEBUG_SHAPE_ARROW:
+    emit_arrow(draw, shape->arrow);
+    break;
+  }
+}
+
+void debug_draw_begin_frame(debug_draw *draw, float dt) {
+  // last frame's streams went with the temp allocator
+  uint32_t reserved = draw->enabled ? DEBUG_DRAW_RESERVED_VERTICES : 0;
+  draw->lines = dyn_array_init<render_debug_vertex>(draw->temp_allocator, reserved);
+  draw->triangles = dyn_array_init<render_debug_vertex>(draw->temp_allocator, reserved);
+  uint32_t i = 0;
+  while (i < draw->timed.count) {
+    debug_shape *shape = &draw->timed.data[i];
+    shape->time_left -= dt;
+    if (shape->time_left <= 0.0f) {
+      dyn_array_remove_swap(&draw->timed, i);
+      continue;
+    }
+    if (draw->enabled) {
+      emit_shape(draw, shape);
+    }
+    i++;
+  }
+}
+
+void debug_draw_flush(debug_draw *draw, struct renderer *renderer) {
+  renderer_render_debug(renderer, (render_cmd_debug){
+                                      .line_vertices = draw->lines.data,
+                                      .line_vertex_count = draw->lines.count,
+                                      .triangle_vertices = draw->triangles.data,
+                                      .triangle_vertex_count = draw->triangles.count,
+                                  });
+  dyn_array_clear(&draw->lines);
+  dyn_array_clear(&draw->triangles);
+}
+
+static void keep_shape(debug_draw *draw, debug_shape shape) {
+  if (shape.time_left > 0.0f) {
+    dyn_array_push(&draw->timed, shape);
+  }
+}
+
+void debug_draw_line(debug_draw *draw, debug_cmd_line line) {
+  if (!draw->enabled) {
+    return;
+  }
+  emit_line(draw, line);
+  keep_shape(draw, (debug_shape){.kind = DEBUG_SHAPE_LINE, .time_left = line.duration, .line = line});
+}
+
+void debug_draw_rect(debug_draw *draw, debug_cmd_rect rect) {
+  if (!draw->enabled) {
+    return;
+  }
+  emit_rect(draw, rect);
+  keep_shape(draw, (debug_shape){.kind = DEBUG_SHAPE_RECT, .time_left = rect.duration, .rect = rect});
+}
+
+void debug_draw_circle(debug_draw *draw, debug_cmd_circle circle) {
+  if (!draw->enabled) {
+    return;
+  }
+  emit_circle(draw, circle);
+  keep_shape(draw, (debug_shape){.kind = DEBUG_SHAPE_CIRCLE, .time_left = circle.duration, .circle = circle});
+}
+
+void debug_draw_arrow(debug_draw *draw, debug_cmd_arrow arrow) {
+  if (!draw->enabled) {
+    return;
+  }
+  emit_arrow(draw, arrow);
+  keep_shape(draw, (debug_shape){.kind = DEBUG_SHAPE_ARROW, .time_left = arrow.duration, .arrow = arrow});
+}
@@ -1,33 +1,369 @@
 #include "game.hpp"
+#include "atlas.hpp"
+#include "debug_draw.hpp"
 #include "game/asset.hpp"
+#include "game/asset_registry.hpp"
+#include "game/perf_hud.hpp"
+#include "game/task.hpp"
 #include "game/text.hpp"
+#include "game/world.hpp"
 #include "renderer.hpp"
+#include "spatial.hpp"
+#include "transform.hpp"
+#include <string.h>
+
+/** A reload decodes on a worker and is swapped in on the main thread once `done` is set. A file that changes
+ * again while its reload runs is decoded once more after the swap, so the last write always wins.
+ */
+struct game_reload {
+  uint64_t changed_ns;
+  bool in_flight;
+  bool again;
+  uint32_t done;
+};
 
 struct game_state {
-  asset_image sprite;
-  asset_font font;
-  asset_sound wav;
+  atlas atlas;
+  atlas_sprite wizard;
+  transform_hierarchy transforms;
+  uint32_t wizard_transform;
+  uint32_t staff_transform;
+  asset_registry assets;
+  asset_handle sprite;
+  asset_handle font;
+  asset_handle wav;
+  perf_hud hud;
+  task_scheduler tasks;
+  // the library the running tasks were started from and the tileset's reload callback points into
+  void *task_code;
+  uint32_t tileset_texture;
+  world world;
+  spatial_grid props;
+  debug_draw debug;
+
+  platform_jobs *jobs;
+  uint32_t reloads_in_flight;
+  game_reload sprite_reload;
+  asset_image reloaded_sprite;
+  game_reload font_reload;
+  asset_font reloaded_font;
 };
 
-void game_init(game_memory *memory, renderer *renderer, ma_engine *audio_player) {
+static void reload_sprite_job(void *data, mem_allocator *scratch) {
+  game_memory *memory = (game_memory *)data;
+  game_state *state = (game_state *)memory->game_state;
+  const char *path = asset_get_path(&state->assets, state->sprite);
+  state->reloaded_sprite = asset_load_image(path, &memory->allocator, scratch);
+  __atomic_store_n(&state->sprite_reload.done, 1, __ATOMIC_RELEASE);
+}
+
+static void reload_font_job(void *data, mem_allocator *scratch) {
+  game_memory *memory = (game_memory *)data;
+  game_state *state = (game_state *)memory->game_state;
+  asset_font *font = asset_get_font(&state->assets, state->font);
+  state->reloaded_font = asset_load_font(font->path, font->height, &memory->allocator, scratch);
+  __atomic_store_n(&state->font_reload.done, 1, __ATOMIC_RELEASE);
+}
+
+static void start_reload(game_memory *memory, game_reload *reload, platform_job_fn job) {
+  game_state *state = (game_state *)memory->game_state;
+  if (reload->in_flight) {
+    reload->again = true;
+    return;
+  }
+  reload->in_flight = true;
+  reload->done = 0;
+  state->reloads_in_flight++;
+  platform_jobs_push(state->jobs, job, memory);
+}
+
+static bool is_reload_done(game_reload *reload) {
+  return reload->in_flight && __atomic_load_n(&reload->done, __ATOMIC_ACQUIRE);
+}
+
+// Called after the swap, the job writes into the same slot the swap reads from.
+static void finish_reload(game_memory *memory, game_reload *reload, platform_job_fn job) {
+  game_state *state = (game_state *)memory->game_state;
+  reload->in_flight = false;
+  state->reloads_in_flight--;
+  if (reload->again) {
+    reload->again = false;
+    start_reload(memory, reload, job);
+  }
+}
+
+void game_file_changed(game_memory *memory, const char *path, uint64_t changed_ns) {
+  game_state *state = (game_state *)memory->game_state;
+  asset_handle changed = asset_lookup(&state->assets, asset_hash_path(path));
+  if (changed.index == state->sprite.index) {
+    state->sprite_reload.changed_ns = changed_ns;
+    start_reload(memory, &state->sprite_reload, reload_sprite_job);
+  } else if (changed.index == state->font.index) {
+    state->font_reload.changed_ns = changed_ns;
+    start_reload(memory, &state->font_reload, reload_font_job);
+  }
+}
+
+static void swap_reloaded_assets(game_memory *memory, renderer *renderer) {
   game_state *state = (game_state *)memory->game_state;
-  state->sprite = asset_load_image("assets/wizard-idle.png", &memory->allocator, &memory->temp_allocator);
+  if (is_reload_done(&state->sprite_reload)) {
+    asset_image *image = &state->reloaded_sprite;
+    uint32_t width = (uint32_t)image->size.x;
+    uint32_t height = (uint32_t)image->size.y;
+    asset_image *sprite = asset_get_image(&state->assets, state->sprite);
+    if (image->data == NULL) {
+      platform_log_error("Keeping the previous version of %s", sprite->path);
+    } else {
+      // a sprite that changed size gets a new spot in the atlas, the old one is simply left unused
+      if (!atlas_replace(&state->atlas, state->wizard, image->data, width, height)) {
+        state->wizard = atlas_add(&state->atlas, image->data, width, height, &memory->allocator);
+      }
+      atlas_upload(&state->atlas, renderer, &memory->allocator);
+      sprite->size = image->size;
+      platform_log_info("Reloaded %s in %.2fms", sprite->path,
+                        (platform_get_time_ns() - state->sprite_reload.changed_ns) / 1e6);
+    }
+    asset_delete_image(image, &memory->allocator);
+    finish_reload(memory, &state->sprite_reload, reload_sprite_job);
+  }
+
+  if (is_reload_done(&state->font_reload)) {
+    // the glyph reload callbacks point at the registry's font, so the new font takes over the same spot
+    asset_font *font = asset_get_font(&state->assets, state->font);
+    if (state->reloaded_font.height == 0.0f) {
+      platform_log_error("Keeping the previous version of %s", font->path);
+      asset_delete_font(&state->reloaded_font, &memory->allocator);
+    } else {
+      text_delete_font_glyphs(renderer, font);
+      asset_delete_font(font, &memory->allocator);
+      *font = state->reloaded_font;
+      text_load_font_page(renderer, font, &memory->temp_allocator);
+      renderer_flush_uploads(renderer);
+      asset_drop_font_data(font, &memory->allocator);
+      platform_log_info("Reloaded %s in %.2fms", font->path,
+                        (platform_get_time_ns() - state->font_reload.changed_ns) / 1e6);
+    }
+    state->reloaded_font = {};
+    finish_reload(memory, &state->font_reload, reload_font_job);
+  }
+}
+
+#define STAFF_REST_ROTATION -0.3f
+#define STAFF_RAISED_ROTATION -1.2f
+#define STAFF_RAISE_SECONDS 0.25f
+#define STAFF_IDLE_SECONDS 5.0f
+
+static void set_staff_rotation(game_state *state, float rotation) {
+  transform_local local = transform_get_local(&state->transforms, state->staff_transform);
+  local.rotation = rotation;
+  transform_set_local(&state->transforms, state->staff_transform, local);
+}
+
+// Every few seconds the wizard raises the staff, holds it up while the coin sound plays and lowers it again.
+static task staff_task(task_scheduler *scheduler, game_state *state, audio_player *audio) {
+  if (co_await task_wait_asset(scheduler, &state->assets, state->wav) != ASSET_STATE_LOADED) {
+    co_return;
+  }
+  for (;;) {
+    co_await task_wait_seconds(scheduler, STAFF_IDLE_SECONDS);
+    double start = scheduler->time;
+    while (scheduler->time - start < STAFF_RAISE_SECONDS) {
+      float t = (float)(scheduler->time - start) / STAFF_RAISE_SECONDS;
+      set_staff_rotation(state, glm::mix(STAFF_REST_ROTATION, STAFF_RAISED_ROTATION, t));
+      co_await task_next_frame(scheduler);
+    }
+    set_staff_rotation(state, STAFF_RAISED_ROTATION);
+    asset_sound *wav = asset_get_sound(&state->assets, state->wav);
+    if (wav == NULL) {
+      co_return;
+    }
+    uint32_t play_id = audio_play(audio, (audio_cmd_play){
+                                             .frames = wav->frames,
+                                             .frame_count = wav->frame_count,
+                                         });
+    co_await task_wait_sound(scheduler, audio, play_id);
+    set_staff_rotation(state, STAFF_REST_ROTATION);
+  }
+}
+
+// The repo ships no level, so the demo streams a generated one much bigger than the view.
+#define WORLD_DEMO_PATH "cache/world.bin"
+#define WORLD_DEMO_TILES 1024
+#define WORLD_DEMO_CELL_TILES 32
+#define WORLD_DEMO_TILE_SIZE 32.0f
+#define TILESET_TILE_PIXELS 16
+#define TILESET_TILE_COUNT 4
+
+static void write_demo_world(mem_allocator *temp_allocator) {
+  uint16_t *tiles = allocator_alloc(temp_allocator, uint16_t, WORLD_DEMO_TILES * WORLD_DEMO_TILES);
+  assert(tiles != NULL);
+  for (uint32_t y = 0; y < WORLD_DEMO_TILES; y++) {
+    for (uint32_t x = 0; x < WORLD_DEMO_TILES; x++) {
+      uint32_t hash = (x * 73856093u) ^ (y * 19349663u);
+      hash = (hash ^ (hash >> 13)) * 0x5bd1e995u;
+      uint16_t tile = 1 + ((x / 8 + y / 8) % TILESET_TILE_COUNT);
+      tiles[y * WORLD_DEMO_TILES + x] = (hash >> 28) == 0 ? TILEMAP_EMPTY : tile;
+    }
+  }
+  world_write_file(WORLD_DEMO_PATH, tiles, WORLD_DEMO_TILES, WORLD_DEMO_TILES, WORLD_DEMO_CELL_TILES,
+                   temp_allocator);
+}
+
+#define PROP_COUNT 20000
+#define PROP_CELL_SIZE 64.0f
+
+// Rocks scattered over the whole world, far more than are ever on screen at once.
+static void scatter_props(spatial_grid *props) {
+  float world_extent = WORLD_DEMO_TILES * WORLD_DEMO_TILE_SIZE;
+  for (uint32_t i = 0; i < PROP_COUNT; i++) {
+    uint32_t hash = (i + 1) * 0x9E3779B9u;
+    hash = (hash ^ (hash >> 15)) * 0x2C1B3C6Du;
+    glm::vec2 pos = glm::vec2(hash & 0xFFFF, hash >> 16) / 65536.0f * world_extent;
+    float size = 8.0f + (hash % 33);
+    spatial_grid_insert(props, (spatial_aabb){.min = pos, .max = pos + size});
+  }
+}
+
+static void render_props(game_state *state, renderer *renderer, mem_allocator *temp_allocator) {
+  glm::vec2 view_min, view_max;
+  renderer_get_view_bounds(renderer, &view_min, &view_max);
+  uint32_t *visible = allocator_alloc(temp_allocator, uint32_t, PROP_COUNT);
+  assert(visible != NULL);
+  spatial_aabb view = {.min = view_min, .max = view_max};
+  uint32_t visible_count = spatial_grid_query_aabb(&state->props, view, visible, PROP_COUNT);
+  for (uint32_t i = 0; i < visible_count; i++) {
+    spatial_aabb bounds = state->props.bounds[visible[i]];
+    float shade = 90.0f + (visible[i] % 5) * 15.0f;
+    renderer_render_quad(renderer, (render_cmd_quad){
+                                       .pos = glm::vec3((bounds.min + bounds.max) * 0.5f, 0.0f),
+                                       .size = bounds.max - bounds.min,
+                                       .color = {shade, shade, shade, 255},
+                                   });
+  }
+}
+
+// Flat colored tiles with a darker border, drawn again whenever the texture has to be reloaded.
+static uint8_t *draw_tileset(void *user, uint32_t index, mem_allocator *temp_allocator) {
+  static const uint8_t colors[TILESET_TILE_COUNT][3] = {
+      {86, 140, 60}, {140, 110, 70}, {120, 120, 130}, {60, 100, 170}};
+  uint32_t width = TILESET_TILE_PIXELS * TILESET_TILE_COUNT;
+  uint8_t *pixels = allocator_alloc(temp_allocator, uint8_t, width * TILESET_TILE_PIXELS * 4);
+  assert(pixels != NULL);
+  for (uint32_t y = 0; y < TILESET_TILE_PIXELS; y++) {
+    for (uint32_t x = 0; x < width; x++) {
+      uint32_t tx = x % TILESET_TILE_PIXELS;
+      bool border = tx == 0 || y == 0 || tx == TILESET_TILE_PIXELS - 1 || y == TILESET_TILE_PIXELS - 1;
+      uint8_t *pixel = &pixels[(y * width + x) * 4];
+      for (uint32_t c = 0; c < 3; c++) {
+        uint8_t color = colors[x / TILESET_TILE_PIXELS][c];
+        pixel[c] = border ? color * 3 / 4 : color;
+      }
+      pixel[3] = 255;
+    }
+  }
+  return pixels;
+}
+
+void game_load(game_memory *memory, platform_jobs *jobs) {
+  game_state *state = (game_state *)memory->game_state;
+  state->jobs = jobs;
+  state->reloads_in_flight = 0;
+  state->sprite_reload = {};
+  state->font_reload = {};
+  asset_registry_init(&state->assets, 64, jobs, &memory->allocator);
+  state->sprite = asset_request_image(&state->assets, "assets/wizard-idle.png");
+  state->font = asset_request_font(&state->assets, "assets/Roboto.ttf", 48.0f);
+  state->wav = asset_request_sound(&state->assets, "assets/coin.wav");
+  if (!platform_file_exists(WORLD_DEMO_PATH)) {
+    platform_create_directory("cache");
+    write_demo_world(&memory->temp_allocator);
+  }
+}
+
+void game_init(game_memory *memory, renderer *renderer, audio_player *audio_player) {
+  game_state *state = (game_state *)memory->game_state;
+  asset_image *sprite = asset_get_image(&state->assets, state->sprite);
+  asset_font *font = asset_get_font(&state->assets, state->font);
+  assert(sprite != NULL && font != NULL);
+  atlas_init(&state->atlas, (atlas_config){
+                                .page_size = 512,
+                                .max_page_size = 2048,
+                                .padding = 1,
+                                .extrude = true,
+                            });
+  state->wizard = atlas_add(&state->atlas, sprite->data, (uint32_t)sprite->size.x, (uint32_t)sprite->size.y,
+                            &memory->allocator);
+  atlas_upload(&state->atlas, renderer, &memory->allocator);
+  text_load_font_page(renderer, font, &memory->temp_allocator);
+  glm::vec2 tileset_size = glm::vec2(TILESET_TILE_PIXELS * TILESET_TILE_COUNT, TILESET_TILE_PIXELS);
   renderer_load_texture(renderer, (render_cmd_load_texture){
-                                      .texture_id = &state->sprite.texture_id,
-                                      .data = state->sprite.data,
-                                      .size = state->sprite.size,
+                                      .texture_id = &state->tileset_texture,
+                                      .data = draw_tileset(NULL, 0, &memory->temp_allocator),
+                                      .size = tileset_size,
+                                      .reload = draw_tileset,
                                   });
+  renderer_flush_uploads(renderer);
+  perf_hud_init(&state->hud);
+  debug_draw_init(&state->debug, &memory->allocator, &memory->temp_allocator);
+  task_scheduler_init(&state->tasks, &memory->allocator);
+  state->task_code = NULL;
+  world_init(&state->world,
+             (world_config){
+                 .path = WORLD_DEMO_PATH,
+                 .tile_size = WORLD_DEMO_TILE_SIZE,
+                 .tileset = {.texture_id = state->tileset_texture,
+                             .texture_size = tileset_size,
+                             .tile_size = glm::vec2(TILESET_TILE_PIXELS)},
+                 .max_resident_cells = 40,
+                 .cell_arena_size = 16 * 1024,
+                 .prefetch_margin = 512.0f,
+                 .lookahead_seconds = 0.5f,
+             },
+             state->jobs, &memory->allocator);
+  state->props = spatial_grid_init(PROP_COUNT, PROP_CELL_SIZE, &memory->allocator);
+  scatter_props(&state->props);
 
-  state->font = asset_load_font("assets/Roboto.ttf", 48.0f, &memory->allocator, &memory->temp_allocator);
-  text_load_font_glyphs(renderer, &state->font);
+  state->transforms = transform_hierarchy_init(256, &memory->allocator);
+  state->wizard_transform = transform_create(&state->transforms, TRANSFORM_NULL);
+  transform_set_local(&state->transforms, state->wizard_transform,
+                      (transform_local){.pos = {1920.0 / 2, 1080.0 / 2, 0.0}, .scale = {1.0, 1.0}});
+  state->staff_transform = transform_create(&state->transforms, state->wizard_transform);
+  transform_set_local(&state->transforms, state->staff_transform,
+                      (transform_local){
+                          .pos = {sprite->size.x * 0.3f, 0.0, 0.0},
+                          .rotation = STAFF_REST_ROTATION,
+                          .scale = {1.0, 1.0},
+                      });
 
-  state->wav = asset_load_sound("assets/coin.wav", audio_player, &memory->allocator);
+  // the atlas keeps its own copy and glyphs can be decoded again from disk
+  asset_drop_image_data(sprite, &memory->allocator);
+  asset_drop_font_data(font, &memory->allocator);
 }
 
 void game_update(const game_input *input, const float dt, game_memory *memory, renderer *renderer,
-                 ma_engine *audio_player) {
+                 audio_player *audio_player) {
   renderer_begin_frame(renderer);
   game_state *state = (game_state *)memory->game_state;
+  if (state->reloads_in_flight > 0) {
+    swap_reloaded_assets(memory, renderer);
+  }
+  asset_registry_collect(&state->assets, renderer);
+  perf_hud_record_frame(&state->hud, dt);
+  debug_draw_begin_frame(&state->debug, dt);
+
+  // suspended tasks would resume into the code of a library that was unloaded, so they start over, and the
+  // tileset reloads through this library's copy of draw_tileset
+  if (state->task_code != (void *)game_update) {
+    renderer_set_texture_reload(renderer, (render_cmd_set_texture_reload){
+                                              .texture_id = state->tileset_texture,
+                                              .reload = draw_tileset,
+                                          });
+    task_scheduler_reset(&state->tasks);
+    set_staff_rotation(state, STAFF_REST_ROTATION);
+    staff_task(&state->tasks, state, audio_player);
+    state->task_code = (void *)game_update;
+  }
+  task_scheduler_update(&state->tasks, dt);
 
   float camera_speed = 500.0f * dt;
   if (input->keys[KEY_W].is_down) {
@@ -43,39 +379,114 @@ void game_update(const game_input *input, const float dt, game_memory *memory, r
     renderer_move_camera(renderer, glm::vec2(-camera_speed, 0.0f));
   }
 
+  asset_sound *wav = asset_get_sound(&state->assets, state->wav);
+  if (input->keys[KEY_F3].is_down && input->keys[KEY_F3].half_transition_count > 0) {
+    state->hud.visible = !state->hud.visible;
+    state->debug.enabled = state->hud.visible;
+  }
+  // a sound that failed to load plays nothing, the circle still shows the key was seen
   if (input->keys[KEY_SPACE].is_down && input->keys[KEY_SPACE].half_transition_count > 0) {
-    ma_sound_seek_to_pcm_frame(state->wav.sound, 0);
-    ma_sound_start(state->wav.sound);
+    if (wav != NULL) {
+      audio_play(audio_player, (audio_cmd_play){
+                                   .frames = wav->frames,
+                                   .frame_count = wav->frame_count,
+                               });
+    }
+    debug_draw_circle(&state->debug, (debug_cmd_circle){
+                                         .center = transform_get_world_pos(&state->transforms,
+                                                                           state->wizard_transform),
+                                         .radius = 80.0f,
+                                         .color = {255, 220, 0, 255},
+                                         .duration = 0.5f,
+                                     });
   }
 
+  transform_update(&state->transforms);
+  world_update(&state->world, renderer, dt);
   renderer_render_clear(renderer, glm::vec4(51, 77, 77, 255));
+  world_render(&state->world, renderer, &memory->temp_allocator);
+  render_props(state, renderer, &memory->temp_allocator);
 
   renderer_render_quad(
       renderer, (render_cmd_quad){.pos = {20.0, 20.0, 0.0}, .size = {20.0, 20.0}, .color = {255, 0, 0, 255}});
 
-  renderer_render_quad(renderer, (render_cmd_quad){.texture_id = state->sprite.texture_id,
-                                                   .pos = {1920.0 / 2, 1080.0 / 2, 0.0},
-                                                   .size = {state->sprite.size.x, state->sprite.size.y}});
+  asset_image *sprite = asset_get_image(&state->assets, state->sprite);
+  atlas_region wizard = atlas_get_region(&state->atlas, state->wizard);
+  transform_hierarchy *transforms = &state->transforms;
+  renderer_render_quad(renderer, (render_cmd_quad){
+                                     .texture_id = wizard.texture_id,
+                                     .pos = transform_get_world_pos(transforms, state->wizard_transform),
+                                     .size = {sprite->size.x, sprite->size.y},
+                                     .uv_rect = wizard.uv_rect,
+                                     .basis = transform_get_world_basis(transforms, state->wizard_transform),
+                                 });
+  renderer_render_quad(renderer, (render_cmd_quad){
+                                     .pos = transform_get_world_pos(transforms, state->staff_transform),
+                                     .size = {4.0, 40.0},
+                                     .color = {120, 80, 40, 255},
+                                     .basis = transform_get_world_basis(transforms, state->staff_transform),
+                                 });
 
+  // the streamed cells, and where the world expects the camera to be by the time it gets there
+  world *world = &state->world;
+  float cell_extent = world->header.cell_tiles * world->config.tile_size;
+  for (uint32_t i = 0; i < world->config.max_resident_cells; i++) {
+    world_cell *cell = &world->cells[i];
+    uint32_t cell_state = __atomic_load_n(&cell->state, __ATOMIC_ACQUIRE);
+    if (cell_state == WORLD_CELL_FREE) {
+      continue;
+    }
+    bool loaded = cell_state == WORLD_CELL_LOADED;
+    glm::vec4 color = loaded ? glm::vec4(0, 255, 0, 255) : glm::vec4(255, 255, 0, 255);
+    debug_draw_rect(&state->debug, (debug_cmd_rect){
+                                       .min = glm::vec3(cell->x, cell->y, 0.0f) * cell_extent,
+                                       .size = glm::vec2(cell_extent),
+                                       .color = color,
+                                   });
+  }
+  glm::vec2 ahead = world->last_center + world->velocity * world->config.lookahead_seconds;
+  debug_draw_arrow(&state->debug, (debug_cmd_arrow){
+                                      .from = glm::vec3(world->last_center, 0.0f),
+                                      .to = glm::vec3(ahead, 0.0f),
+                                      .color = {255, 255, 255, 255},
+                                  });
+  debug_draw_flush(&state->debug, renderer);
+
+  renderer_begin_ui_layer(renderer);
+  asset_font *font = asset_get_font(&state->assets, state->font);
   text_render_text(renderer, (text_cmd_render){
-                                 .font = &state->font,
+                                 .font = font,
                                  .text = "hello, world!",
                                  .pos = {100.0, 100.0, 0.0},
                                  .color = {255, 255, 255, 255},
                                  .scale = 1,
                              });
+
+  glm::vec2 view_min, view_max;
+  renderer_get_view_bounds(renderer, &view_min, &view_max);
+  perf_hud_render(&state->hud, renderer, font, glm::vec2(10.0f, view_max.y - view_min.y - 10.0f),
+                  (perf_hud_stats){
+                      .render = renderer_get_state_stats(renderer),
+                      .allocator = allocator_get_usage(&memory->allocator),
+                      .temp_allocator = allocator_get_usage(&memory->temp_allocator),
+                      .voice_count = audio_get_active_voice_count(audio_player),
+                      .pending_asset_count = asset_registry_get_pending_count(&state->assets),
+                  });
 }
 
 void game_deinit(game_memory *memory, struct renderer *renderer) {
   game_state *state = (game_state *)memory->game_state;
 
-  text_delete_font_glyphs(renderer, &state->font);
-  asset_delete_font(&state->font, &memory->allocator);
-
-  renderer_delete_texture(renderer, (render_cmd_delete_texture){
-                                        .texture_id = &state->sprite.texture_id,
-                                    });
+  task_scheduler_destroy(&state->tasks);
+  debug_draw_destroy(&state->debug);
+  world_destroy(&state->world, renderer);
+  spatial_grid_destroy(&state->props, &memory->allocator);
+  renderer_delete_texture(renderer, (render_cmd_delete_texture){.texture_id = &state->tileset_texture});
+  atlas_destroy(&state->atlas, renderer, &memory->allocator);
+  transform_hierarchy_destroy(&state->transforms, &memory->allocator);
 
-  asset_delete_sound(&state->wav, &memory->allocator);
-  asset_delete_image(&state->sprite, &memory->allocator);
+  asset_release(&state->assets, state->wav);
+  asset_release(&state->assets, state->font);
+  asset_release(&state->assets, state->sprite);
+  asset_registry_destroy(&state->assets, renderer);
 }
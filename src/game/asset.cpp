@@ -2,8 +2,18 @@
 #include "platform.hpp"
 #include <ft2build.h>
 #include <stb_image.h>
+#include <string.h>
 #include FT_FREETYPE_H
 
+// Paths are copied, the caller's string may live in the game library, which can be swapped out.
+static const char *copy_path(const char *path, mem_allocator *allocator) {
+  size_t length = strlen(path);
+  char *copy = allocator_alloc(allocator, char, length + 1);
+  assert(copy != NULL);
+  memcpy(copy, path, length + 1);
+  return copy;
+}
+
 asset_image asset_load_image(const char *path, mem_allocator *allocator, mem_allocator *temp_allocator) {
   size_t file_size;
   unsigned char *file_memory;
@@ -11,11 +21,16 @@ asset_image asset_load_image(const char *path, mem_allocator *allocator, mem_all
 
   int x, y, n;
   unsigned char *pixels = stbi_load_from_memory(file_memory, file_size, &x, &y, &n, 4);
+  if (pixels == NULL) {
+    platform_log_error("Failed to decode %s: %s", path, stbi_failure_reason());
+    return (asset_image){.path = copy_path(path, allocator)};
+  }
   size_t pixels_size = x * y * 4;
 
   void *buffer = allocator_alloc(allocator, unsigned char, pixels_size);
   assert(buffer != NULL);
   asset_image png = {
+      .path = copy_path(path, allocator),
       .size = glm::vec2(static_cast<float>(x), static_cast<float>(y)),
       .data = static_cast<unsigned char *>(buffer),
       .texture_id = 0,
@@ -27,6 +42,13 @@ asset_image asset_load_image(const char *path, mem_allocator *allocator, mem_all
   return png;
 }
 
+void asset_drop_image_data(asset_image *image, mem_allocator *allocator) {
+  if (image->data != NULL) {
+    allocator_dealloc(allocator, image->data);
+    image->data = NULL;
+  }
+}
+
 void asset_delete_image(asset_image *image, mem_allocator *allocator) {
   if (image->texture_id > 0) {
     platform_log_debug("Asset image deleted with dangling texture: %i", image->texture_id);
@@ -35,28 +57,54 @@ void asset_delete_image(asset_image *image, mem_allocator *allocator) {
     allocator_dealloc(allocator, image->data);
     image->data = NULL;
   }
+  if (image->path != NULL) {
+    allocator_dealloc(allocator, (void *)image->path);
+    image->path = NULL;
+  }
 };
 
-asset_sound asset_load_sound(const char *path, ma_engine *audio_player, mem_allocator *allocator) {
-  asset_sound sound;
-  size_t size;
-  platform_load_entire_file_with_free_list(path, allocator, &sound.data, &size);
-  sound.decoder = allocator_alloc(allocator, ma_decoder, 1);
-  sound.sound = allocator_alloc(allocator, ma_sound, 1);
-  ma_result result = ma_decoder_init_memory(sound.data, size, NULL, sound.decoder);
-  assert(result == MA_SUCCESS);
-  result = ma_sound_init_from_data_source(audio_player, sound.decoder, 0, NULL, sound.sound);
-  assert(result == MA_SUCCESS);
+asset_sound asset_load_sound(const char *path, mem_allocator *allocator, mem_allocator *temp_allocator) {
+  size_t file_size;
+  unsigned char *file_memory;
+  platform_load_entire_file_with_arena(path, temp_allocator, &file_memory, &file_size);
+
+  uint32_t channels = AUDIO_CHANNELS;
+  ma_decoder_config config = ma_decoder_config_init(ma_format_f32, channels, AUDIO_SAMPLE_RATE);
+  ma_decoder decoder;
+  ma_result result = ma_decoder_init_memory(file_memory, file_size, &config, &decoder);
+  if (result != MA_SUCCESS) {
+    platform_log_error("Failed to decode %s: %s", path, ma_result_description(result));
+    return (asset_sound){};
+  }
 
+  // the length is an estimate when resampling, so keep whatever the decoder actually produced
+  ma_uint64 frame_count;
+  result = ma_decoder_get_length_in_pcm_frames(&decoder, &frame_count);
+  if (result != MA_SUCCESS || frame_count == 0) {
+    platform_log_error("Failed to decode %s: no frames", path);
+    ma_decoder_uninit(&decoder);
+    return (asset_sound){};
+  }
+  float *frames = allocator_alloc(allocator, float, frame_count * channels);
+  assert(frames != NULL);
+  ma_uint64 frames_read;
+  result = ma_decoder_read_pcm_frames(&decoder, frames, frame_count, &frames_read);
+  assert(result == MA_SUCCESS || result == MA_AT_END);
+  ma_decoder_uninit(&decoder);
+
+  asset_sound sound = {
+      .frames = frames,
+      .frame_count = frames_read,
+  };
   return sound;
 }
 
 void asset_delete_sound(asset_sound *sound, mem_allocator *allocator) {
-  ma_decoder_uninit(sound->decoder);
-  ma_sound_uninit(sound->sound);
-  allocator_dealloc(allocator, sound->sound);
-  allocator_dealloc(allocator, sound->decoder);
-  allocator_dealloc(allocator, sound->data);
+  if (sound->frames != NULL) {
+    allocator_dealloc(allocator, sound->frames);
+    sound->frames = NULL;
+  }
+  sound->frame_count = 0;
 }
 
 asset_font asset_load_font(const char *path, float height, mem_allocator *allocator,
@@ -68,10 +116,14 @@ asset_font asset_load_font(const char *path, float height, mem_allocator *alloca
   FT_Library ft;
   assert(FT_Init_FreeType(&ft) == 0);
   FT_Face face;
-  assert(FT_New_Memory_Face(ft, file_memory, file_size, 0, &face) == 0);
+  if (FT_New_Memory_Face(ft, file_memory, file_size, 0, &face) != 0) {
+    platform_log_error("Failed to decode %s", path);
+    FT_Done_FreeType(ft);
+    return (asset_font){.path = copy_path(path, allocator)};
+  }
   FT_Set_Pixel_Sizes(face, 0, height);
 
-  asset_font font = {};
+  asset_font font = {.path = copy_path(path, allocator), .height = height};
   for (unsigned char c = 0; c < ASSET_FONT_NUM_CHARS; c++) {
     assert(FT_Load_Char(face, c, FT_LOAD_RENDER) == 0);
     assert(face->glyph->bitmap.pixel_mode == FT_PIXEL_MODE_GRAY);
@@ -92,6 +144,38 @@ asset_font asset_load_font(const char *path, float height, mem_allocator *alloca
   return font;
 }
 
+uint8_t *asset_reload_font_glyph(void *user, uint32_t index, mem_allocator *temp_allocator) {
+  asset_font *font = (asset_font *)user;
+  assert(index < ASSET_FONT_NUM_CHARS);
+  size_t file_size;
+  unsigned char *file_memory;
+  platform_load_entire_file_with_arena(font->path, temp_allocator, &file_memory, &file_size);
+
+  FT_Library ft;
+  assert(FT_Init_FreeType(&ft) == 0);
+  FT_Face face;
+  assert(FT_New_Memory_Face(ft, file_memory, file_size, 0, &face) == 0);
+  FT_Set_Pixel_Sizes(face, 0, font->height);
+  assert(FT_Load_Char(face, index, FT_LOAD_RENDER) == 0);
+
+  size_t buffer_size = abs(face->glyph->bitmap.pitch) * face->glyph->bitmap.rows;
+  uint8_t *data = allocator_alloc(temp_allocator, uint8_t, buffer_size);
+  memcpy(data, face->glyph->bitmap.buffer, buffer_size);
+
+  FT_Done_Face(face);
+  FT_Done_FreeType(ft);
+  return data;
+}
+
+void asset_drop_font_data(asset_font *font, mem_allocator *allocator) {
+  for (unsigned char c = 0; c < ASSET_FONT_NUM_CHARS; c++) {
+    if (font->characters[c].data != NULL) {
+      allocator_dealloc(allocator, font->characters[c].data);
+      font->characters[c].data = NULL;
+    }
+  }
+}
+
 void asset_delete_font(asset_font *font, mem_allocator *allocator) {
   for (unsigned char c = 0; c < ASSET_FONT_NUM_CHARS; c++) {
     if (font->characters[c].data == NULL) {
@@ -104,4 +188,8 @@ void asset_delete_font(asset_font *font, mem_allocator *allocator) {
     allocator_dealloc(allocator, font->characters[c].data);
     font->characters[c].data = NULL;
   }
+  if (font->path != NULL) {
+    allocator_dealloc(allocator, (void *)font->path);
+    font->path = NULL;
+  }
 }
@@ -0,0 +1,224 @@
+#include "game/asset_registry.hpp"
+#include "game/text.hpp"
+#include <assert.h>
+#include <string.h>
+
+void asset_registry_init(asset_registry *registry, uint32_t capacity, platform_jobs *jobs,
+                         mem_allocator *allocator) {
+  assert(capacity > 0);
+  registry->entries = allocator_alloc(allocator, asset_entry, capacity);
+  assert(registry->entries != NULL);
+  memset(registry->entries, 0, sizeof(asset_entry) * capacity);
+  registry->capacity = capacity;
+  registry->used = 0;
+  registry->free_slots = dyn_array_init<uint32_t>(allocator, 0);
+  registry->released = dyn_array_init<uint32_t>(allocator, 0);
+  registry->slots = hash_map_init<uint64_t, uint32_t>(allocator, capacity);
+  registry->frame = 0;
+  registry->pending_count = 0;
+  registry->jobs = jobs;
+  registry->allocator = allocator;
+  registry->stats = {};
+}
+
+static void load_asset_job(void *data, mem_allocator *scratch) {
+  asset_entry *entry = (asset_entry *)data;
+  mem_allocator *allocator = entry->registry->allocator;
+  uint32_t state = ASSET_STATE_LOADED;
+  switch (entry->type) {
+  case ASSET_TYPE_IMAGE:
+    entry->image = asset_load_image(entry->path, allocator, scratch);
+    state = entry->image.data != NULL ? ASSET_STATE_LOADED : ASSET_STATE_FAILED;
+    break;
+  case ASSET_TYPE_FONT:
+    entry->font = asset_load_font(entry->path, entry->font_height, allocator, scratch);
+    state = entry->font.height > 0.0f ? ASSET_STATE_LOADED : ASSET_STATE_FAILED;
+    break;
+  case ASSET_TYPE_SOUND:
+    entry->sound = asset_load_sound(entry->path, allocator, scratch);
+    state = entry->sound.frames != NULL ? ASSET_STATE_LOADED : ASSET_STATE_FAILED;
+    break;
+  }
+  __atomic_store_n(&entry->state, state, __ATOMIC_RELEASE);
+  __atomic_sub_fetch(&entry->registry->pending_count, 1, __ATOMIC_RELAXED);
+}
+
+static asset_handle request(asset_registry *registry, asset_type type, const char *path, float font_height) {
+  registry->stats.request_count++;
+  uint64_t id = asset_hash_path(path);
+  uint32_t *slot = hash_map_get(&registry->slots, id);
+  if (slot != NULL) {
+    asset_entry *entry = &registry->entries[*slot];
+    assert(entry->type == type && strcmp(entry->path, path) == 0 && "Asset id collision");
+    assert((type != ASSET_TYPE_FONT || entry->font_height == font_height) && "Font requested at two heights");
+    entry->ref_count++;
+    registry->stats.shared_count++;
+    return (asset_handle){.index = *slot, .generation = entry->generation};
+  }
+
+  uint32_t index;
+  if (registry->free_slots.count > 0) {
+    index = dyn_array_pop(&registry->free_slots);
+  } else {
+    assert(registry->used < registry->capacity && "Out of asset slots");
+    index = registry->used++;
+  }
+  asset_entry *entry = &registry->entries[index];
+  size_t length = strlen(path);
+  char *path_copy = allocator_alloc(registry->allocator, char, length + 1);
+  assert(path_copy != NULL);
+  memcpy(path_copy, path, length + 1);
+  entry->id = id;
+  entry->type = type;
+  entry->state = ASSET_STATE_LOADING;
+  entry->ref_count = 1;
+  entry->pending_free = false;
+  entry->path = path_copy;
+  entry->font_height = font_height;
+  entry->registry = registry;
+  hash_map_put(&registry->slots, id, index);
+
+  registry->stats.decode_count++;
+  __atomic_add_fetch(&registry->pending_count, 1, __ATOMIC_RELAXED);
+  platform_jobs_push(registry->jobs, load_asset_job, entry);
+  return (asset_handle){.index = index, .generation = entry->generation};
+}
+
+asset_handle asset_request_image(asset_registry *registry, const char *path) {
+  return request(registry, ASSET_TYPE_IMAGE, path, 0.0f);
+}
+
+asset_handle asset_request_font(asset_registry *registry, const char *path, float height) {
+  return request(registry, ASSET_TYPE_FONT, path, height);
+}
+
+asset_handle asset_request_sound(asset_registry *registry, const char *path) {
+  return request(registry, ASSET_TYPE_SOUND, path, 0.0f);
+}
+
+asset_handle asset_lookup(asset_registry *registry, uint64_t id) {
+  uint32_t *slot = hash_map_get(&registry->slots, id);
+  if (slot == NULL) {
+    return (asset_handle){.index = ASSET_NULL, .generation = 0};
+  }
+  return (asset_handle){.index = *slot, .generation = registry->entries[*slot].generation};
+}
+
+static asset_entry *get_entry(asset_registry *registry, asset_handle handle) {
+  assert(handle.index < registry->used);
+  asset_entry *entry = &registry->entries[handle.index];
+  assert(entry->generation == handle.generation && entry->path != NULL && "Asset was freed");
+  return entry;
+}
+
+void asset_release(asset_registry *registry, asset_handle handle) {
+  asset_entry *entry = get_entry(registry, handle);
+  assert(entry->ref_count > 0);
+  if (--entry->ref_count > 0) {
+    return;
+  }
+  entry->released_frame = registry->frame;
+  if (!entry->pending_free) {
+    entry->pending_free = true;
+    dyn_array_push(&registry->released, handle.index);
+  }
+}
+
+static void free_entry(asset_registry *registry, uint32_t index, struct renderer *renderer) {
+  asset_entry *entry = &registry->entries[index];
+  switch (entry->type) {
+  case ASSET_TYPE_IMAGE:
+    if (entry->image.texture_id > 0) {
+      renderer_delete_texture(renderer, (render_cmd_delete_texture){.texture_id = &entry->image.texture_id});
+    }
+    asset_delete_image(&entry->image, registry->allocator);
+    break;
+  case ASSET_TYPE_FONT:
+    text_delete_font_glyphs(renderer, &entry->font);
+    asset_delete_font(&entry->font, registry->allocator);
+    break;
+  case ASSET_TYPE_SOUND:
+    asset_delete_sound(&entry->sound, registry->allocator);
+    break;
+  }
+  hash_map_remove(&registry->slots, entry->id);
+  allocator_dealloc(registry->allocator, (void *)entry->path);
+  entry->path = NULL;
+  entry->ref_count = 0;
+  entry->pending_free = false;
+  entry->generation++;
+  dyn_array_push(&registry->free_slots, index);
+  registry->stats.freed_count++;
+}
+
+void asset_registry_collect(asset_registry *registry, struct renderer *renderer) {
+  registry->frame++;
+  uint32_t i = 0;
+  while (i < registry->released.count) {
+    uint32_t index = registry->released.data[i];
+    asset_entry *entry = &registry->entries[index];
+    // requested again during its grace period
+    if (entry->ref_count > 0) {
+      entry->pending_free = false;
+      dyn_array_remove_swap(&registry->released, i);
+      continue;
+    }
+    // a load still in flight writes into the entry, so it is freed once the load lands
+    if (registry->frame - entry->released_frame < ASSET_REGISTRY_GRACE_FRAMES ||
+        __atomic_load_n(&entry->state, __ATOMIC_ACQUIRE) == ASSET_STATE_LOADING) {
+      i++;
+      continue;
+    }
+    free_entry(registry, index, renderer);
+    dyn_array_remove_swap(&registry->released, i);
+  }
+}
+
+void asset_registry_destroy(asset_registry *registry, struct renderer *renderer) {
+  platform_jobs_wait(registry->jobs);
+  for (uint32_t i = 0; i < registry->used; i++) {
+    if (registry->entries[i].path != NULL) {
+      free_entry(registry, i, renderer);
+    }
+  }
+  platform_log_info("Assets: %u requests, %u shared, %u decoded, %u freed", registry->stats.request_count,
+                    registry->stats.shared_count, registry->stats.decode_count, registry->stats.freed_count);
+  hash_map_destroy(&registry->slots);
+  dyn_array_destroy(&registry->released);
+  dyn_array_destroy(&registry->free_slots);
+  allocator_dealloc(registry->allocator, registry->entries);
+  *registry = {};
+}
+
+uint32_t asset_registry_get_pending_count(asset_registry *registry) {
+  return __atomic_load_n(&registry->pending_count, __ATOMIC_RELAXED);
+}
+
+asset_state asset_get_state(asset_registry *registry, asset_handle handle) {
+  return (asset_state)__atomic_load_n(&get_entry(registry, handle)->state, __ATOMIC_ACQUIRE);
+}
+
+const char *asset_get_path(asset_registry *registry, asset_handle handle) {
+  return get_entry(registry, handle)->path;
+}
+
+static asset_entry *get_loaded_entry(asset_registry *registry, asset_handle handle, asset_type type) {
+  asset_entry *entry = get_entry(registry, handle);
+  assert(entry->type == type);
+  return asset_get_state(registry, handle) == ASSET_STATE_LOADED ? entry : NULL;
+}
+
+asset_image *asset_get_image(asset_registry *registry, asset_handle handle) {
+  asset_entry *entry = get_loaded_entry(registry, handle, ASSET_TYPE_IMAGE);
+  return entry != NULL ? &entry->image : NULL;
+}
+
+asset_font *asset_get_font(asset_registry *registry, asset_handle handle) {
+  asset_entry *entry = get_loaded_entry(registry, handle, ASSET_TYPE_FONT);
+  return entry != NULL ? &entry->font : NULL;
+}
+
+asset_sound *asset_get_sound(asset_registry *registry, asset_handle handle) {
+  asset_entry *entry = get_loaded_entry(registry, handle, ASSET_TYPE_SOUND);
+  return entry != NULL ? &entry->sound : NULL;
+}
@@ -0,0 +1,106 @@
+#include "game/perf_hud.hpp"
+#include "game/text.hpp"
+#include "platform.hpp"
+#include <stdio.h>
+#include <string.h>
+
+#define PERF_HUD_WIDTH 420.0f
+#define PERF_HUD_PADDING 8.0f
+#define PERF_HUD_TEXT_SCALE 0.35f
+#define PERF_HUD_LINES 4
+#define PERF_HUD_GRAPH_HEIGHT 60.0f
+#define PERF_HUD_BUDGET_MS 16.7f
+
+void perf_hud_init(perf_hud *hud) { memset(hud, 0, sizeof(perf_hud)); }
+
+void perf_hud_record_frame(perf_hud *hud, float dt) {
+  hud->frame_ms[hud->next_frame] = dt * 1000.0f;
+  hud->next_frame = (hud->next_frame + 1) % PERF_HUD_FRAMES;
+  hud->frame_count = glm::min(hud->frame_count + 1, (uint32_t)PERF_HUD_FRAMES);
+}
+
+float perf_hud_get_p99_ms(perf_hud *hud) {
+  // only the worst 1% matter, so keep those sorted instead of sorting everything
+  float worst[PERF_HUD_FRAMES / 100 + 1] = {};
+  uint32_t kept = hud->frame_count / 100 + 1;
+  for (uint32_t i = 0; i < hud->frame_count; i++) {
+    float ms = hud->frame_ms[i];
+    for (uint32_t k = 0; k < kept; k++) {
+      if (ms > worst[k]) {
+        float swapped = worst[k];
+        worst[k] = ms;
+        ms = swapped;
+      }
+    }
+  }
+  return worst[kept - 1];
+}
+
+static void render_line(struct renderer *renderer, asset_font *font, glm::vec2 pos, uint32_t line,
+                        const char *text) {
+  float line_height = font->height * PERF_HUD_TEXT_SCALE * 1.25f;
+  text_render_text(renderer, (text_cmd_render){
+                                 .font = font,
+                                 .text = text,
+                                 .pos = {pos.x + PERF_HUD_PADDING,
+                                         pos.y - PERF_HUD_PADDING - line_height * (line + 0.8f), 0.0f},
+                                 .color = {255, 255, 255, 255},
+                                 .scale = PERF_HUD_TEXT_SCALE,
+                             });
+}
+
+void perf_hud_render(perf_hud *hud, struct renderer *renderer, asset_font *font, glm::vec2 pos,
+                     perf_hud_stats stats) {
+  if (!hud->visible || hud->frame_count == 0) {
+    return;
+  }
+  uint64_t start = platform_get_time_ns();
+
+  float line_height = font->height * PERF_HUD_TEXT_SCALE * 1.25f;
+  float text_height = line_height * PERF_HUD_LINES;
+  float height = PERF_HUD_PADDING * 3 + text_height + PERF_HUD_GRAPH_HEIGHT;
+  text_render_rect(renderer, font, glm::vec3(pos.x + PERF_HUD_WIDTH / 2, pos.y - height / 2, 0.0f),
+                   glm::vec2(PERF_HUD_WIDTH, height), glm::vec4(0, 0, 0, 180));
+
+  char text[128];
+  uint32_t last = (hud->next_frame + PERF_HUD_FRAMES - 1) % PERF_HUD_FRAMES;
+  snprintf(text, sizeof(text), "frame %.2fms  p99 %.2fms  hud %.3fms", hud->frame_ms[last],
+           perf_hud_get_p99_ms(hud), hud->build_ms);
+  render_line(renderer, font, pos, 0, text);
+  snprintf(text, sizeof(text), "draws %u  binds %u  gl calls %u  elided %u", stats.render.draw_call_count,
+           stats.render.texture_bind_count, stats.render.issued_count, stats.render.elided_count);
+  render_line(renderer, font, pos, 1, text);
+  // the temp arena is cleared every frame, so the previous frame's high water mark is what says anything
+  mem_allocator_usage temp = stats.temp_allocator;
+  mem_allocator_usage memory = stats.allocator;
+  snprintf(text, sizeof(text), "memory %.1f/%.0fMB  temp %.1f/%.0fMB", memory.used_bytes / (double)MB,
+           memory.size_bytes / (double)MB, temp.last_cleared_bytes / (double)MB,
+           temp.size_bytes / (double)MB);
+  render_line(renderer, font, pos, 2, text);
+  snprintf(text, sizeof(text), "voices %u  loading %u", stats.voice_count, stats.pending_asset_count);
+  render_line(renderer, font, pos, 3, text);
+
+  // oldest frame on the left
+  float graph_width = PERF_HUD_WIDTH - PERF_HUD_PADDING * 2;
+  float graph_bottom = pos.y - height + PERF_HUD_PADDING;
+  float bar_width = graph_width / PERF_HUD_FRAMES;
+  for (uint32_t i = 0; i < hud->frame_count; i++) {
+    uint32_t frame = (hud->next_frame + PERF_HUD_FRAMES - hud->frame_count + i) % PERF_HUD_FRAMES;
+    float ms = hud->frame_ms[frame];
+    float bar_height = glm::max(glm::min(ms / PERF_HUD_GRAPH_MS, 1.0f) * PERF_HUD_GRAPH_HEIGHT, 1.0f);
+    glm::vec4 color = glm::vec4(230, 60, 60, 255);
+    if (ms <= PERF_HUD_BUDGET_MS) {
+      color = glm::vec4(80, 220, 80, 255);
+    } else if (ms <= PERF_HUD_GRAPH_MS) {
+      color = glm::vec4(230, 200, 60, 255);
+    }
+    float x = pos.x + PERF_HUD_PADDING + bar_width * (i + PERF_HUD_FRAMES - hud->frame_count + 0.5f);
+    text_render_rect(renderer, font, glm::vec3(x, graph_bottom + bar_height / 2, 0.0f),
+                     glm::vec2(bar_width * 0.8f, bar_height), color);
+  }
+  float budget_y = graph_bottom + PERF_HUD_BUDGET_MS / PERF_HUD_GRAPH_MS * PERF_HUD_GRAPH_HEIGHT;
+  text_render_rect(renderer, font, glm::vec3(pos.x + PERF_HUD_WIDTH / 2, budget_y, 0.0f),
+                   glm::vec2(graph_width, 1.0f), glm::vec4(255, 255, 255, 120));
+
+  hud->build_ms = (platform_get_time_ns() - start) / 1e6f;
+}
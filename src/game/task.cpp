@@ -0,0 +1,218 @@
+#include "game/task.hpp"
+
+static_assert(sizeof(task_frame) % 16 == 0, "Task frames must stay 16 byte aligned");
+static_assert(alignof(task_frame) >= __STDCPP_DEFAULT_NEW_ALIGNMENT__,
+              "Coroutine frames follow the header and need operator new's alignment");
+static_assert(TASK_FRAME_BLOCK_SIZE % alignof(task_frame) == 0, "Pooled blocks must stay aligned");
+
+void task_scheduler_init(task_scheduler *scheduler, mem_allocator *allocator) {
+  *scheduler = {};
+  scheduler->next_frame = dyn_array_init<std::coroutine_handle<>>(allocator, 0);
+  scheduler->ready = dyn_array_init<std::coroutine_handle<>>(allocator, 0);
+  scheduler->timers = dyn_array_init<task_timer>(allocator, 0);
+  scheduler->asset_waits = dyn_array_init<task_asset_wait>(allocator, 0);
+  scheduler->sound_waits = dyn_array_init<task_sound_wait>(allocator, 0);
+  scheduler->chunks = dyn_array_init<uint8_t *>(allocator, 0);
+  scheduler->allocator = allocator;
+}
+
+void task_scheduler_destroy(task_scheduler *scheduler) {
+  task_scheduler_reset(scheduler);
+  for (uint32_t i = 0; i < scheduler->chunks.count; i++) {
+    allocator_dealloc(scheduler->allocator, scheduler->chunks.data[i]);
+  }
+  dyn_array_destroy(&scheduler->chunks);
+  dyn_array_destroy(&scheduler->sound_waits);
+  dyn_array_destroy(&scheduler->asset_waits);
+  dyn_array_destroy(&scheduler->timers);
+  dyn_array_destroy(&scheduler->ready);
+  dyn_array_destroy(&scheduler->next_frame);
+  *scheduler = {};
+}
+
+static void add_pool_chunk(task_scheduler *scheduler) {
+  // every block starts a frame, so the chunk needs the frame's alignment rather than a byte's
+  uint8_t *chunk = (uint8_t *)allocator_alloc_impl(
+      scheduler->allocator, TASK_FRAME_BLOCK_SIZE * TASK_POOL_CHUNK_BLOCKS, alignof(task_frame));
+  assert(chunk != NULL && (uintptr_t)chunk % alignof(task_frame) == 0);
+  dyn_array_push(&scheduler->chunks, chunk);
+  for (uint32_t i = 0; i < TASK_POOL_CHUNK_BLOCKS; i++) {
+    task_frame *block = (task_frame *)(chunk + i * TASK_FRAME_BLOCK_SIZE);
+    block->next = scheduler->free_blocks;
+    scheduler->free_blocks = block;
+  }
+  scheduler->pooled_block_count += TASK_POOL_CHUNK_BLOCKS;
+}
+
+void *task_alloc_frame(task_scheduler *scheduler, size_t size) {
+  uint32_t total = (uint32_t)(sizeof(task_frame) + size);
+  task_frame *frame;
+  if (total <= TASK_FRAME_BLOCK_SIZE) {
+    if (scheduler->free_blocks == NULL) {
+      add_pool_chunk(scheduler);
+    }
+    frame = scheduler->free_blocks;
+    scheduler->free_blocks = frame->next;
+  } else {
+    frame = (task_frame *)allocator_alloc_impl(scheduler->allocator, total, alignof(task_frame));
+    assert(frame != NULL && (uintptr_t)frame % alignof(task_frame) == 0);
+  }
+  frame->prev = NULL;
+  frame->next = scheduler->live;
+  if (scheduler->live != NULL) {
+    scheduler->live->prev = frame;
+  }
+  scheduler->live = frame;
+  frame->scheduler = scheduler;
+  frame->size = total;
+  scheduler->live_count++;
+  return frame + 1;
+}
+
+static void release_frame(task_frame *frame) {
+  task_scheduler *scheduler = frame->scheduler;
+  if (frame->size <= TASK_FRAME_BLOCK_SIZE) {
+    frame->next = scheduler->free_blocks;
+    scheduler->free_blocks = frame;
+  } else {
+    allocator_dealloc(scheduler->allocator, frame);
+  }
+}
+
+void task_free_frame(void *data) {
+  task_frame *frame = (task_frame *)data - 1;
+  task_scheduler *scheduler = frame->scheduler;
+  if (frame->prev != NULL) {
+    frame->prev->next = frame->next;
+  } else {
+    scheduler->live = frame->next;
+  }
+  if (frame->next != NULL) {
+    frame->next->prev = frame->prev;
+  }
+  scheduler->live_count--;
+  release_frame(frame);
+}
+
+void task_scheduler_reset(task_scheduler *scheduler) {
+  task_frame *frame = scheduler->live;
+  while (frame != NULL) {
+    task_frame *next = frame->next;
+    release_frame(frame);
+    frame = next;
+  }
+  scheduler->live = NULL;
+  scheduler->live_count = 0;
+  dyn_array_clear(&scheduler->next_frame);
+  dyn_array_clear(&scheduler->ready);
+  dyn_array_clear(&scheduler->timers);
+  dyn_array_clear(&scheduler->asset_waits);
+  dyn_array_clear(&scheduler->sound_waits);
+}
+
+// Timers form a binary min heap on the wake time.
+static void push_timer(task_scheduler *scheduler, task_timer timer) {
+  dyn_array<task_timer> *timers = &scheduler->timers;
+  dyn_array_push(timers, timer);
+  uint32_t i = timers->count - 1;
+  while (i > 0) {
+    uint32_t parent = (i - 1) / 2;
+    if (timers->data[parent].wake_time <= timers->data[i].wake_time) {
+      break;
+    }
+    task_timer swapped = timers->data[parent];
+    timers->data[parent] = timers->data[i];
+    timers->data[i] = swapped;
+    i = parent;
+  }
+}
+
+static task_timer pop_timer(task_scheduler *scheduler) {
+  dyn_array<task_timer> *timers = &scheduler->timers;
+  task_timer top = timers->data[0];
+  timers->data[0] = dyn_array_pop(timers);
+  uint32_t i = 0;
+  for (;;) {
+    uint32_t smallest = i;
+    uint32_t left = i * 2 + 1;
+    uint32_t right = left + 1;
+    if (left < timers->count && timers->data[left].wake_time < timers->data[smallest].wake_time) {
+      smallest = left;
+    }
+    if (right < timers->count && timers->data[right].wake_time < timers->data[smallest].wake_time) {
+      smallest = right;
+    }
+    if (smallest == i) {
+      break;
+    }
+    task_timer swapped = timers->data[smallest];
+    timers->data[smallest] = timers->data[i];
+    timers->data[i] = swapped;
+    i = smallest;
+  }
+  return top;
+}
+
+void task_frame_awaiter::await_suspend(std::coroutine_handle<> handle) {
+  dyn_array_push(&scheduler->next_frame, handle);
+}
+
+void task_time_awaiter::await_suspend(std::coroutine_handle<> handle) {
+  push_timer(scheduler, (task_timer){.wake_time = wake_time, .handle = handle});
+}
+
+void task_asset_awaiter::await_suspend(std::coroutine_handle<> handle) {
+  dyn_array_push(&scheduler->asset_waits,
+                 (task_asset_wait){.handle = handle, .registry = registry, .asset = asset});
+}
+
+void task_sound_awaiter::await_suspend(std::coroutine_handle<> handle) {
+  dyn_array_push(&scheduler->sound_waits,
+                 (task_sound_wait){.handle = handle, .audio = audio, .play_id = play_id});
+}
+
+void task_scheduler_update(task_scheduler *scheduler, float dt) {
+  scheduler->time += dt;
+  // tasks that wait for the next frame again while resuming land in the emptied list
+  dyn_array<std::coroutine_handle<>> ready = scheduler->next_frame;
+  scheduler->next_frame = scheduler->ready;
+  scheduler->ready = ready;
+
+  while (scheduler->timers.count > 0 && scheduler->timers.data[0].wake_time <= scheduler->time) {
+    dyn_array_push(&scheduler->ready, pop_timer(scheduler).handle);
+  }
+  uint32_t i = 0;
+  while (i < scheduler->asset_waits.count) {
+    task_asset_wait *wait = &scheduler->asset_waits.data[i];
+    if (asset_get_state(wait->registry, wait->asset) == ASSET_STATE_LOADING) {
+      i++;
+      continue;
+    }
+    dyn_array_push(&scheduler->ready, wait->handle);
+    dyn_array_remove_swap(&scheduler->asset_waits, i);
+  }
+  i = 0;
+  while (i < scheduler->sound_waits.count) {
+    task_sound_wait *wait = &scheduler->sound_waits.data[i];
+    if (audio_is_playing(wait->audio, wait->play_id)) {
+      i++;
+      continue;
+    }
+    dyn_array_push(&scheduler->ready, wait->handle);
+    dyn_array_remove_swap(&scheduler->sound_waits, i);
+  }
+
+  for (uint32_t r = 0; r < scheduler->ready.count; r++) {
+    scheduler->ready.data[r].resume();
+  }
+  scheduler->resumed_count = scheduler->ready.count;
+  dyn_array_clear(&scheduler->ready);
+}
+
+task_scheduler_stats task_scheduler_get_stats(task_scheduler *scheduler) {
+  return (task_scheduler_stats){
+      .live_count = scheduler->live_count,
+      .resumed_count = scheduler->resumed_count,
+      .pooled_block_count = scheduler->pooled_block_count,
+  };
+}
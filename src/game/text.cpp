@@ -1,4 +1,6 @@
 #include "game/text.hpp"
+#include <assert.h>
+#include <string.h>
 
 void text_load_font_glyphs(struct renderer *renderer, asset_font *font) {
   for (int i = 0; i < ASSET_FONT_NUM_CHARS; i++) {
@@ -6,10 +8,102 @@ void text_load_font_glyphs(struct renderer *renderer, asset_font *font) {
                                       .texture_id = &font->characters[i].texture_id,
                                       .data = font->characters[i].data,
                                       .size = font->characters[i].size,
+                                      .reload = asset_reload_font_glyph,
+                                      .reload_user = font,
+                                      .reload_index = (uint32_t)i,
                                   });
   }
 }
 
+// Shelf packing, the solid block takes the first spot of the first row. Returns the page height.
+static uint32_t layout_page(const asset_font_char *characters, glm::uvec2 *offsets) {
+  uint32_t x = TEXT_PAGE_PADDING * 2 + TEXT_PAGE_SOLID_SIZE;
+  uint32_t y = TEXT_PAGE_PADDING;
+  uint32_t row_height = TEXT_PAGE_SOLID_SIZE;
+  for (int i = 0; i < ASSET_FONT_NUM_CHARS; i++) {
+    uint32_t width = (uint32_t)characters[i].size.x;
+    uint32_t height = (uint32_t)characters[i].size.y;
+    assert(width + TEXT_PAGE_PADDING * 2 <= TEXT_PAGE_WIDTH && "Glyph is wider than the font page");
+    if (x + width + TEXT_PAGE_PADDING > TEXT_PAGE_WIDTH) {
+      x = TEXT_PAGE_PADDING;
+      y += row_height + TEXT_PAGE_PADDING;
+      row_height = 0;
+    }
+    offsets[i] = glm::uvec2(x, y);
+    x += width + TEXT_PAGE_PADDING;
+    row_height = glm::max(row_height, height);
+  }
+  uint32_t page_height = 1;
+  while (page_height < y + row_height + TEXT_PAGE_PADDING) {
+    page_height *= 2;
+  }
+  return page_height;
+}
+
+static uint8_t *draw_page(const asset_font_char *characters, const glm::uvec2 *offsets, uint32_t page_height,
+                          mem_allocator *temp_allocator) {
+  uint8_t *pixels = allocator_alloc(temp_allocator, uint8_t, TEXT_PAGE_WIDTH * page_height);
+  assert(pixels != NULL);
+  memset(pixels, 0, TEXT_PAGE_WIDTH * page_height);
+  for (uint32_t row = 0; row < TEXT_PAGE_SOLID_SIZE; row++) {
+    uint8_t *solid_row = pixels + (TEXT_PAGE_PADDING + row) * TEXT_PAGE_WIDTH + TEXT_PAGE_PADDING;
+    memset(solid_row, 0xFF, TEXT_PAGE_SOLID_SIZE);
+  }
+  for (int i = 0; i < ASSET_FONT_NUM_CHARS; i++) {
+    const asset_font_char *ch = &characters[i];
+    assert(ch->data != NULL && "Font data was dropped before building its page");
+    uint32_t width = (uint32_t)ch->size.x;
+    uint32_t height = (uint32_t)ch->size.y;
+    for (uint32_t row = 0; row < height; row++) {
+      memcpy(pixels + (offsets[i].y + row) * TEXT_PAGE_WIDTH + offsets[i].x, ch->data + row * width, width);
+    }
+  }
+  return pixels;
+}
+
+// Decodes the font from disk again into the temp allocator and lays it out the same way.
+static uint8_t *reload_font_page(void *user, uint32_t index, mem_allocator *temp_allocator) {
+  asset_font *font = (asset_font *)user;
+  asset_font decoded = asset_load_font(font->path, font->height, temp_allocator, temp_allocator);
+  if (decoded.height == 0.0f) {
+    return NULL;
+  }
+  // a file that changed on disk may not fit the uvs anymore, the hot reload builds a new page for it
+  for (int i = 0; i < ASSET_FONT_NUM_CHARS; i++) {
+    if (decoded.characters[i].size != font->characters[i].size) {
+      return NULL;
+    }
+  }
+  glm::uvec2 offsets[ASSET_FONT_NUM_CHARS];
+  uint32_t page_height = layout_page(decoded.characters, offsets);
+  return draw_page(decoded.characters, offsets, page_height, temp_allocator);
+}
+
+void text_load_font_page(struct renderer *renderer, asset_font *font, mem_allocator *temp_allocator) {
+  glm::uvec2 offsets[ASSET_FONT_NUM_CHARS];
+  uint32_t page_height = layout_page(font->characters, offsets);
+  uint8_t *pixels = draw_page(font->characters, offsets, page_height, temp_allocator);
+  glm::vec2 page_size = glm::vec2(TEXT_PAGE_WIDTH, page_height);
+  for (int i = 0; i < ASSET_FONT_NUM_CHARS; i++) {
+    asset_font_char *ch = &font->characters[i];
+    glm::vec2 uv_min = glm::vec2(offsets[i]) / page_size;
+    glm::vec2 uv_max = glm::vec2(offsets[i] + glm::uvec2(ch->size)) / page_size;
+    ch->page_uv = glm::vec4(uv_min, uv_max);
+  }
+  // the inner texels of the block, so filtering never reaches the empty border
+  float solid_min = TEXT_PAGE_PADDING + 1.0f;
+  float solid_max = TEXT_PAGE_PADDING + TEXT_PAGE_SOLID_SIZE - 1.0f;
+  font->page_solid_uv = glm::vec4(solid_min / page_size.x, solid_min / page_size.y, solid_max / page_size.x,
+                                  solid_max / page_size.y);
+  renderer_load_glyph(renderer, (render_cmd_load_glyph){
+                                    .texture_id = &font->page_texture_id,
+                                    .data = pixels,
+                                    .size = page_size,
+                                    .reload = reload_font_page,
+                                    .reload_user = font,
+                                });
+}
+
 void text_delete_font_glyphs(struct renderer *renderer, asset_font *font) {
   for (int i = 0; i < ASSET_FONT_NUM_CHARS; i++) {
     if (font->characters[i].texture_id > 0) {
@@ -18,6 +112,9 @@ void text_delete_font_glyphs(struct renderer *renderer, asset_font *font) {
                                         });
     }
   }
+  if (font->page_texture_id > 0) {
+    renderer_delete_texture(renderer, (render_cmd_delete_texture){.texture_id = &font->page_texture_id});
+  }
 }
 
 void text_render_text(struct renderer *renderer, text_cmd_render cmd) {
@@ -31,9 +128,26 @@ void text_render_text(struct renderer *renderer, text_cmd_render cmd) {
     float ypos = cmd.pos.y - (ch->size.y - ch->bearing.y) * cmd.scale + h / 2.0f;
     glm::vec3 char_pos = glm::vec3(xpos, ypos, cmd.pos.z);
     glm::vec2 char_size = glm::vec2(w, h);
-    renderer_render_glyph(
-        renderer, (render_cmd_glyph){
-                      .texture_id = ch->texture_id, .pos = char_pos, .size = char_size, .color = cmd.color});
+    bool paged = cmd.font->page_texture_id != 0;
+    renderer_render_glyph(renderer, (render_cmd_glyph){
+                                        .texture_id = paged ? cmd.font->page_texture_id : ch->texture_id,
+                                        .pos = char_pos,
+                                        .size = char_size,
+                                        .color = cmd.color,
+                                        .uv_rect = paged ? ch->page_uv : glm::vec4(0.0f),
+                                    });
     x += (ch->advance >> 6) * cmd.scale;
   }
 }
+
+void text_render_rect(struct renderer *renderer, asset_font *font, glm::vec3 pos, glm::vec2 size,
+                      glm::vec4 color) {
+  assert(font->page_texture_id != 0 && "Rects need the font page");
+  renderer_render_glyph(renderer, (render_cmd_glyph){
+                                      .texture_id = font->page_texture_id,
+                                      .pos = pos,
+                                      .size = size,
+                                      .color = color,
+                                      .uv_rect = font->page_solid_uv,
+                                  });
+}
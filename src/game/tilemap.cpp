@@ -0,0 +1,143 @@
+#include "game/tilemap.hpp"
+#include <string.h>
+
+static_assert(TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE <= RENDERER_MAX_MESH_QUADS,
+              "Tilemap chunks must fit in a single mesh");
+
+tilemap tilemap_init(uint32_t width, uint32_t height, float tile_size, tilemap_tileset tileset,
+                     mem_allocator *allocator) {
+  tilemap map = {
+      .width = width,
+      .height = height,
+      .chunks_x = (width + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE,
+      .chunks_y = (height + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE,
+      .tile_size = tile_size,
+      .pos = glm::vec3(0.0f),
+      .tileset = tileset,
+  };
+  map.tiles = allocator_alloc(allocator, uint16_t, width * height);
+  map.chunks = allocator_alloc(allocator, tilemap_chunk, map.chunks_x * map.chunks_y);
+  assert(map.tiles != NULL && map.chunks != NULL);
+  memset(map.tiles, 0, sizeof(uint16_t) * width * height);
+  for (uint32_t i = 0; i < map.chunks_x * map.chunks_y; i++) {
+    map.chunks[i] = (tilemap_chunk){.mesh_id = 0, .dirty = true};
+  }
+  return map;
+}
+
+void tilemap_destroy(tilemap *map, struct renderer *renderer, mem_allocator *allocator) {
+  for (uint32_t i = 0; i < map->chunks_x * map->chunks_y; i++) {
+    renderer_delete_mesh(renderer, (render_cmd_delete_mesh){.mesh_id = &map->chunks[i].mesh_id});
+  }
+  allocator_dealloc(allocator, map->chunks);
+  allocator_dealloc(allocator, map->tiles);
+  map->chunks = NULL;
+  map->tiles = NULL;
+}
+
+void tilemap_set_tile(tilemap *map, uint32_t x, uint32_t y, uint16_t tile) {
+  assert(x < map->width && y < map->height);
+  uint16_t *current = &map->tiles[y * map->width + x];
+  if (*current == tile) {
+    return;
+  }
+  *current = tile;
+  map->chunks[(y / TILEMAP_CHUNK_SIZE) * map->chunks_x + x / TILEMAP_CHUNK_SIZE].dirty = true;
+}
+
+uint16_t tilemap_get_tile(tilemap *map, uint32_t x, uint32_t y) {
+  assert(x < map->width && y < map->height);
+  return map->tiles[y * map->width + x];
+}
+
+static void rebuild_chunk(tilemap *map, uint32_t cx, uint32_t cy, struct renderer *renderer,
+                          mem_allocator *temp_allocator) {
+  tilemap_chunk *chunk = &map->chunks[cy * map->chunks_x + cx];
+  render_vertex *vertices =
+      allocator_alloc(temp_allocator, render_vertex, TILEMAP_CHUNK_SIZE * TILEMAP_CHUNK_SIZE * 4);
+
+  glm::vec2 uv_size = map->tileset.tile_size / map->tileset.texture_size;
+  uint32_t columns = (uint32_t)(map->tileset.texture_size.x / map->tileset.tile_size.x);
+  uint32_t quad_count = 0;
+  for (uint32_t ty = 0; ty < TILEMAP_CHUNK_SIZE; ty++) {
+    uint32_t y = cy * TILEMAP_CHUNK_SIZE + ty;
+    if (y >= map->height) {
+      break;
+    }
+    for (uint32_t tx = 0; tx < TILEMAP_CHUNK_SIZE; tx++) {
+      uint32_t x = cx * TILEMAP_CHUNK_SIZE + tx;
+      if (x >= map->width) {
+        break;
+      }
+      uint16_t tile = map->tiles[y * map->width + x];
+      if (tile == TILEMAP_EMPTY) {
+        continue;
+      }
+
+      // texture rows go top to bottom while the world y axis points up
+      uint32_t index = tile - 1;
+      glm::vec2 uv0 = glm::vec2((float)(index % columns), (float)(index / columns)) * uv_size;
+      glm::vec2 uv1 = uv0 + uv_size;
+      float x0 = tx * map->tile_size;
+      float y0 = ty * map->tile_size;
+      float x1 = x0 + map->tile_size;
+      float y1 = y0 + map->tile_size;
+
+      render_vertex *quad = &vertices[quad_count * 4];
+      quad[0] = (render_vertex){.pos = {x1, y1, 0.0f}, .uv = {uv1.x, uv0.y}}; // top right
+      quad[1] = (render_vertex){.pos = {x1, y0, 0.0f}, .uv = {uv1.x, uv1.y}}; // bottom right
+      quad[2] = (render_vertex){.pos = {x0, y0, 0.0f}, .uv = {uv0.x, uv1.y}}; // bottom left
+      quad[3] = (render_vertex){.pos = {x0, y1, 0.0f}, .uv = {uv0.x, uv0.y}}; // top left
+      quad_count++;
+    }
+  }
+
+  // empty chunks don't hold on to a mesh slot
+  if (quad_count == 0) {
+    renderer_delete_mesh(renderer, (render_cmd_delete_mesh){.mesh_id = &chunk->mesh_id});
+  } else {
+    renderer_load_mesh(renderer, (render_cmd_load_mesh){
+                                     .mesh_id = &chunk->mesh_id,
+                                     .vertices = vertices,
+                                     .quad_count = quad_count,
+                                 });
+  }
+  chunk->dirty = false;
+}
+
+void tilemap_render(tilemap *map, struct renderer *renderer, mem_allocator *temp_allocator) {
+  glm::vec2 view_min, view_max;
+  renderer_get_view_bounds(renderer, &view_min, &view_max);
+
+  // clamp the visible area to the chunk grid
+  float chunk_extent = TILEMAP_CHUNK_SIZE * map->tile_size;
+  glm::vec2 local_min = (view_min - glm::vec2(map->pos)) / chunk_extent;
+  glm::vec2 local_max = (view_max - glm::vec2(map->pos)) / chunk_extent;
+  if (local_max.x < 0.0f || local_max.y < 0.0f || local_min.x >= (float)map->chunks_x ||
+      local_min.y >= (float)map->chunks_y) {
+    return;
+  }
+  uint32_t cx0 = (uint32_t)glm::max(local_min.x, 0.0f);
+  uint32_t cy0 = (uint32_t)glm::max(local_min.y, 0.0f);
+  uint32_t cx1 = glm::min((uint32_t)local_max.x, map->chunks_x - 1);
+  uint32_t cy1 = glm::min((uint32_t)local_max.y, map->chunks_y - 1);
+
+  for (uint32_t cy = cy0; cy <= cy1; cy++) {
+    for (uint32_t cx = cx0; cx <= cx1; cx++) {
+      tilemap_chunk *chunk = &map->chunks[cy * map->chunks_x + cx];
+      if (chunk->dirty || (chunk->mesh_id != 0 && renderer_is_mesh_lost(renderer, chunk->mesh_id))) {
+        rebuild_chunk(map, cx, cy, renderer, temp_allocator);
+      }
+      if (chunk->mesh_id == 0) {
+        continue;
+      }
+      glm::vec3 chunk_pos = map->pos + glm::vec3(cx * chunk_extent, cy * chunk_extent, 0.0f);
+      renderer_render_mesh(renderer, (render_cmd_mesh){
+                                         .mesh_id = chunk->mesh_id,
+                                         .texture_id = map->tileset.texture_id,
+                                         .pos = chunk_pos,
+                                         .color = {255, 255, 255, 255},
+                                     });
+    }
+  }
+}
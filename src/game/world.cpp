@@ -0,0 +1,238 @@
+#include "game/world.hpp"
+#include <string.h>
+
+static uint64_t cell_key(uint32_t x, uint32_t y) { return ((uint64_t)x << 32) | y; }
+
+void world_init(world *world, world_config config, platform_jobs *jobs, mem_allocator *allocator) {
+  assert(config.max_resident_cells > 0 && config.max_resident_cells <= WORLD_MAX_RESIDENT_CELLS);
+  *world = {};
+  world->config = config;
+  world->jobs = jobs;
+  world->allocator = allocator;
+
+  // cells are read on the workers long after init, and the caller's path may live in the game library
+  size_t path_length = strlen(config.path);
+  char *path = allocator_alloc(allocator, char, path_length + 1);
+  assert(path != NULL);
+  memcpy(path, config.path, path_length + 1);
+  world->config.path = path;
+
+  platform_read_file_range(config.path, 0, sizeof(world_file_header), &world->header);
+  world_file_header *header = &world->header;
+  assert(header->magic == WORLD_FILE_MAGIC && "Not a world file");
+  uint32_t cell_count = header->cells_x * header->cells_y;
+  world->table = allocator_alloc(allocator, world_file_cell, cell_count);
+  assert(world->table != NULL);
+  platform_read_file_range(config.path, sizeof(world_file_header), sizeof(world_file_cell) * cell_count,
+                           world->table);
+
+  // what a cell's tilemap takes, with room for aligning each of its two allocations
+  uint32_t chunks_per_side = (header->cell_tiles + TILEMAP_CHUNK_SIZE - 1) / TILEMAP_CHUNK_SIZE;
+  uintptr_t needed = sizeof(uint16_t) * header->cell_tiles * header->cell_tiles +
+                     sizeof(tilemap_chunk) * chunks_per_side * chunks_per_side + 2 * alignof(max_align_t);
+  assert(config.cell_arena_size >= needed && "Cell arenas are too small for the world's cells");
+
+  world->resident = hash_map_init<uint64_t, uint32_t>(allocator, config.max_resident_cells);
+  for (uint32_t i = 0; i < config.max_resident_cells; i++) {
+    world->cells[i].arena = allocator_arena_init(config.cell_arena_size);
+    world->cells[i].world = world;
+  }
+  platform_log_info("World %s: %ux%u cells of %u tiles", config.path, header->cells_x, header->cells_y,
+                    header->cell_tiles);
+}
+
+static void load_cell_job(void *data, mem_allocator *scratch) {
+  world_cell *cell = (world_cell *)data;
+  world *world = cell->world;
+  uint32_t tiles = world->header.cell_tiles;
+  float extent = tiles * world->config.tile_size;
+  cell->map = tilemap_init(tiles, tiles, world->config.tile_size, world->config.tileset, &cell->arena);
+  cell->map.pos = glm::vec3(cell->x * extent, cell->y * extent, 0.0f);
+  world_file_cell *entry = &world->table[cell->y * world->header.cells_x + cell->x];
+  assert(entry->size == sizeof(uint16_t) * tiles * tiles);
+  platform_read_file_range(world->config.path, entry->offset, entry->size, cell->map.tiles);
+  __atomic_store_n(&cell->state, WORLD_CELL_LOADED, __ATOMIC_RELEASE);
+}
+
+static uint32_t get_state(world_cell *cell) { return __atomic_load_n(&cell->state, __ATOMIC_ACQUIRE); }
+
+// Everything the cell loaded lives in its arena, so clearing that is the whole unload.
+static void unload_cell(world *world, world_cell *cell, struct renderer *renderer) {
+  tilemap_destroy(&cell->map, renderer, &cell->arena);
+  allocator_clear(&cell->arena);
+  hash_map_remove(&world->resident, cell_key(cell->x, cell->y));
+  cell->state = WORLD_CELL_FREE;
+  world->stats.unloaded_count++;
+}
+
+void world_destroy(world *world, struct renderer *renderer) {
+  platform_jobs_wait(world->jobs);
+  for (uint32_t i = 0; i < world->config.max_resident_cells; i++) {
+    world_cell *cell = &world->cells[i];
+    if (cell->state == WORLD_CELL_LOADED) {
+      unload_cell(world, cell, renderer);
+    }
+    allocator_destroy(&cell->arena);
+  }
+  hash_map_destroy(&world->resident);
+  allocator_dealloc(world->allocator, world->table);
+  allocator_dealloc(world->allocator, (void *)world->config.path);
+  *world = {};
+}
+
+// A free slot, or else the loaded cell that was wanted longest ago, as long as it isn't wanted now.
+static world_cell *find_slot(world *world, struct renderer *renderer) {
+  world_cell *oldest = NULL;
+  for (uint32_t i = 0; i < world->config.max_resident_cells; i++) {
+    world_cell *cell = &world->cells[i];
+    uint32_t state = get_state(cell);
+    if (state == WORLD_CELL_FREE) {
+      return cell;
+    }
+    if (state == WORLD_CELL_LOADED && cell->wanted_frame != world->frame &&
+        (oldest == NULL || cell->wanted_frame < oldest->wanted_frame)) {
+      oldest = cell;
+    }
+  }
+  if (oldest != NULL) {
+    unload_cell(world, oldest, renderer);
+  }
+  return oldest;
+}
+
+struct world_wanted_cell {
+  uint32_t x;
+  uint32_t y;
+  float distance;
+};
+
+void world_update(world *world, struct renderer *renderer, float dt) {
+  world->frame++;
+  glm::vec2 view_min, view_max;
+  renderer_get_view_bounds(renderer, &view_min, &view_max);
+  glm::vec2 center = (view_min + view_max) * 0.5f;
+  if (world->has_center && dt > 0.0f) {
+    glm::vec2 velocity = (center - world->last_center) / dt;
+    world->velocity = glm::mix(world->velocity, velocity, WORLD_VELOCITY_SMOOTHING);
+  }
+  world->last_center = center;
+  world->has_center = true;
+
+  // the view, stretched to where the camera is headed and grown by the margin, in cells
+  glm::vec2 ahead = world->velocity * world->config.lookahead_seconds;
+  glm::vec2 wanted_min = glm::min(view_min, view_min + ahead) - world->config.prefetch_margin;
+  glm::vec2 wanted_max = glm::max(view_max, view_max + ahead) + world->config.prefetch_margin;
+  float extent = world->header.cell_tiles * world->config.tile_size;
+  glm::ivec2 last_cell = glm::ivec2(world->header.cells_x, world->header.cells_y) - 1;
+  // clamped a little past the grid, far enough that a view beyond the edge lets the edge cells go
+  glm::ivec2 low = glm::ivec2(-2);
+  glm::ivec2 cell_min = glm::clamp(glm::ivec2(glm::floor(wanted_min / extent)), low, last_cell + 2);
+  glm::ivec2 cell_max = glm::clamp(glm::ivec2(glm::floor(wanted_max / extent)), low, last_cell + 2);
+
+  // nearest first, only as many as there are slots
+  world_wanted_cell wanted[WORLD_MAX_RESIDENT_CELLS];
+  uint32_t wanted_count = 0;
+  glm::vec2 target = center + ahead;
+  for (int32_t y = glm::max(cell_min.y, 0); y <= glm::min(cell_max.y, last_cell.y); y++) {
+    for (int32_t x = glm::max(cell_min.x, 0); x <= glm::min(cell_max.x, last_cell.x); x++) {
+      uint32_t *slot = hash_map_get(&world->resident, cell_key(x, y));
+      if (slot != NULL) {
+        world->cells[*slot].wanted_frame = world->frame;
+        continue;
+      }
+      float distance = glm::length((glm::vec2(x, y) + 0.5f) * extent - target);
+      uint32_t i = wanted_count;
+      if (wanted_count < world->config.max_resident_cells) {
+        wanted_count++;
+      } else if (distance >= wanted[i - 1].distance) {
+        continue;
+      } else {
+        i--;
+      }
+      while (i > 0 && wanted[i - 1].distance > distance) {
+        wanted[i] = wanted[i - 1];
+        i--;
+      }
+      wanted[i] = (world_wanted_cell){.x = (uint32_t)x, .y = (uint32_t)y, .distance = distance};
+    }
+  }
+
+  // cells only go once they are more than a cell outside of the wanted area, so a camera hovering over a
+  // border doesn't load and unload the same cells over and over
+  for (uint32_t i = 0; i < world->config.max_resident_cells; i++) {
+    world_cell *cell = &world->cells[i];
+    if (get_state(cell) != WORLD_CELL_LOADED || cell->wanted_frame == world->frame) {
+      continue;
+    }
+    if ((int32_t)cell->x < cell_min.x - 1 || (int32_t)cell->x > cell_max.x + 1 ||
+        (int32_t)cell->y < cell_min.y - 1 || (int32_t)cell->y > cell_max.y + 1) {
+      unload_cell(world, cell, renderer);
+    }
+  }
+
+  for (uint32_t i = 0; i < wanted_count; i++) {
+    world_cell *cell = find_slot(world, renderer);
+    if (cell == NULL) {
+      world->stats.skipped_count += wanted_count - i;
+      break;
+    }
+    cell->x = wanted[i].x;
+    cell->y = wanted[i].y;
+    cell->wanted_frame = world->frame;
+    cell->state = WORLD_CELL_LOADING;
+    hash_map_put(&world->resident, cell_key(cell->x, cell->y), (uint32_t)(cell - world->cells));
+    world->stats.loaded_count++;
+    platform_jobs_push(world->jobs, load_cell_job, cell);
+  }
+}
+
+void world_render(world *world, struct renderer *renderer, mem_allocator *temp_allocator) {
+  for (uint32_t i = 0; i < world->config.max_resident_cells; i++) {
+    world_cell *cell = &world->cells[i];
+    if (get_state(cell) == WORLD_CELL_LOADED) {
+      tilemap_render(&cell->map, renderer, temp_allocator);
+    }
+  }
+}
+
+world_stats world_get_stats(world *world) {
+  world_stats stats = world->stats;
+  for (uint32_t i = 0; i < world->config.max_resident_cells; i++) {
+    uint32_t state = get_state(&world->cells[i]);
+    stats.resident_count += state != WORLD_CELL_FREE;
+    stats.loading_count += state == WORLD_CELL_LOADING;
+  }
+  return stats;
+}
+
+void world_write_file(const char *path, const uint16_t *tiles, uint32_t width, uint32_t height,
+                      uint32_t cell_tiles, mem_allocator *temp_allocator) {
+  assert(cell_tiles > 0 && width % cell_tiles == 0 && height % cell_tiles == 0);
+  world_file_header header = {
+      .magic = WORLD_FILE_MAGIC,
+      .cells_x = width / cell_tiles,
+      .cells_y = height / cell_tiles,
+      .cell_tiles = cell_tiles,
+  };
+  uint32_t cell_count = header.cells_x * header.cells_y;
+  uint64_t cell_size = sizeof(uint16_t) * cell_tiles * cell_tiles;
+  uint64_t cells_offset = sizeof(world_file_header) + sizeof(world_file_cell) * cell_count;
+  uint64_t file_size = cells_offset + cell_size * cell_count;
+  uint8_t *file = allocator_alloc(temp_allocator, uint8_t, file_size);
+  assert(file != NULL);
+  memcpy(file, &header, sizeof(header));
+
+  world_file_cell *table = (world_file_cell *)(file + sizeof(world_file_header));
+  for (uint32_t cy = 0; cy < header.cells_y; cy++) {
+    for (uint32_t cx = 0; cx < header.cells_x; cx++) {
+      uint32_t index = cy * header.cells_x + cx;
+      table[index] = (world_file_cell){.offset = cells_offset + cell_size * index, .size = cell_size};
+      uint16_t *cell = (uint16_t *)(file + table[index].offset);
+      for (uint32_t y = 0; y < cell_tiles; y++) {
+        const uint16_t *row = tiles + (uint64_t)(cy * cell_tiles + y) * width + cx * cell_tiles;
+        memcpy(cell + y * cell_tiles, row, sizeof(uint16_t) * cell_tiles);
+      }
+    }
+  }
+  platform_write_file(path, file_size, file);
+}
@@ -0,0 +1,87 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "mem.hpp"
+#include "renderer.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+#define ATLAS_MAX_PAGES 8
+#define ATLAS_MAX_SKYLINE_NODES 512
+#define ATLAS_MAX_SPRITES 4096
+
+/** Pages start at `page_size` and double until `max_page_size` before another page is added. Every sprite
+ * is surrounded by `padding` pixels, with `extrude` they repeat the sprite's edge pixels so filtering at the
+ * border never samples a neighbour.
+ */
+struct atlas_config {
+  uint32_t page_size;
+  uint32_t max_page_size;
+  uint32_t padding;
+  bool extrude;
+};
+
+struct atlas_skyline_node {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+};
+
+struct atlas_page {
+  uint32_t texture_id;
+  uint32_t size;
+  uint8_t *pixels;
+  // the pixels from before the page grew, kept until the uploads that read them are cancelled
+  uint8_t *retired_pixels;
+  atlas_skyline_node nodes[ATLAS_MAX_SKYLINE_NODES];
+  uint32_t node_count;
+  bool dirty;
+  bool resized;
+};
+
+struct atlas_rect {
+  uint32_t page;
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+/** Loose RGBA images packed into shared pages with a skyline packer, so sprites that share a page draw in a
+ * single batch. Pixels stay on the CPU side to grow pages and to reload them if the renderer evicts a page.
+ * Sprites are handles rather than uv rects since growing a page moves every uv on it.
+ */
+struct atlas {
+  atlas_config config;
+  atlas_page pages[ATLAS_MAX_PAGES];
+  uint32_t page_count;
+  atlas_rect sprites[ATLAS_MAX_SPRITES];
+  uint32_t sprite_count;
+};
+
+// 0 is never a valid sprite.
+typedef uint32_t atlas_sprite;
+
+struct atlas_region {
+  uint32_t texture_id;
+  glm::vec4 uv_rect;
+};
+
+void atlas_init(atlas *atlas, atlas_config config);
+void atlas_destroy(atlas *atlas, struct renderer *renderer, mem_allocator *allocator);
+atlas_sprite atlas_add(atlas *atlas, const uint8_t *pixels, uint32_t width, uint32_t height,
+                       mem_allocator *allocator);
+
+/** Overwrites a sprite's pixels in place, keeping its handle and texture. Returns false when the size
+ * changed, since the sprite can't grow in place.
+ */
+bool atlas_replace(atlas *atlas, atlas_sprite sprite, const uint8_t *pixels, uint32_t width,
+                   uint32_t height);
+
+/** Sends every page that changed since the last call to the renderer, call it once after a round of adds.
+ * Pixels a page outgrew are freed here rather than when it grows, since an upload may still read them.
+ */
+void atlas_upload(atlas *atlas, struct renderer *renderer, mem_allocator *allocator);
+atlas_region atlas_get_region(atlas *atlas, atlas_sprite sprite);
+
+#endif
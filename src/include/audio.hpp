@@ -0,0 +1,157 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include "mem.hpp"
+#include "miniaudio.h"
+#include "platform.hpp"
+#include <stddef.h>
+#include <stdint.h>
+
+// The mix format is fixed so sounds can be decoded before the device is even opened.
+#define AUDIO_CHANNELS 2
+#define AUDIO_SAMPLE_RATE 48000
+#define AUDIO_MAX_VOICES 32
+#define AUDIO_COMMAND_CAPACITY 256
+#define AUDIO_STREAM_POLL_MS 5
+
+/** A voice plays decoded frames it doesn't own, so any number of voices can share the same sound. Voices are
+ * only touched by the audio thread.
+ */
+struct audio_voice {
+  ma_audio_buffer_ref buffer;
+  ma_sound sound;
+  uint32_t play_id;
+  int32_t priority;
+  bool active;
+};
+
+/** Frames must be interleaved f32 in the engine's channel count and sample rate and stay alive while they
+ * play. When every voice is busy the oldest voice with the lowest priority is stolen, as long as its priority
+ * is not higher than the new sound's.
+ */
+struct audio_cmd_play {
+  const float *frames;
+  uint64_t frame_count;
+  int32_t priority;
+};
+
+enum audio_command_type {
+  AUDIO_COMMAND_PLAY,
+  AUDIO_COMMAND_STOP,
+  AUDIO_COMMAND_STOP_ALL,
+  AUDIO_COMMAND_SET_VOLUME,
+  AUDIO_COMMAND_SET_PITCH,
+  AUDIO_COMMAND_STREAM_START,
+  AUDIO_COMMAND_STREAM_STOP,
+};
+
+struct audio_command {
+  audio_command_type type;
+  uint32_t play_id;
+  float value;
+  audio_cmd_play play;
+  struct audio_stream *stream;
+};
+
+/** Single producer, single consumer ring: the game thread only moves `write_index` and the audio thread only
+ * moves `read_index`, each on its own cache line. Commands pushed while the ring is full are dropped.
+ */
+struct audio_command_queue {
+  audio_command commands[AUDIO_COMMAND_CAPACITY];
+  alignas(64) uint32_t write_index;
+  alignas(64) uint32_t read_index;
+  uint32_t dropped;
+};
+
+/** Owns the miniaudio engine, its device and a fixed pool of voices that are created once at init, so
+ * playing a sound never allocates. The game thread never calls into miniaudio after init: every control call
+ * becomes a command that the audio thread applies at the start of its next mix. The device hands the
+ * player to its callback and every voice's sound points at the engine inside it, so it can't move after
+ * `audio_init`.
+ */
+struct audio_player {
+  ma_device device;
+  ma_engine engine;
+  audio_voice voices[AUDIO_MAX_VOICES];
+  uint32_t max_voices;
+  uint32_t next_play_id;
+  audio_command_queue queue;
+  uint32_t active_voice_count;
+  uint32_t playing_ids[AUDIO_MAX_VOICES];
+  uint32_t applied_play_id;
+  uint32_t published_play_id;
+  uint64_t callback_last_ns;
+  uint64_t callback_max_ns;
+};
+
+void audio_init(audio_player *audio, uint32_t max_voices);
+void audio_destroy(audio_player *audio);
+uint32_t audio_get_channels(audio_player *audio);
+uint32_t audio_get_sample_rate(audio_player *audio);
+
+/** Returns an id for the new playback, or 0 when the command queue was full and the sound was dropped. The
+ * sound may still be dropped on the audio thread if every voice plays something more important, in which
+ * case later commands for that id do nothing.
+ */
+uint32_t audio_play(audio_player *audio, audio_cmd_play play);
+void audio_stop(audio_player *audio, uint32_t play_id);
+void audio_stop_all(audio_player *audio);
+void audio_set_volume(audio_player *audio, uint32_t play_id, float volume);
+void audio_set_pitch(audio_player *audio, uint32_t play_id, float pitch);
+
+// Stats published by the audio thread, they lag the commands by up to one callback.
+uint32_t audio_get_active_voice_count(audio_player *audio);
+// True until the playback ended, was stopped or stolen, or was dropped for lack of a voice.
+bool audio_is_playing(audio_player *audio, uint32_t play_id);
+void audio_get_callback_stats(audio_player *audio, uint64_t *last_ns, uint64_t *max_ns, uint32_t *dropped);
+
+/** Streams decode from a file, or from a region already in memory such as a mapped pack, on a background
+ * thread into a ring of `budget_frames` frames, which is all the memory they ever hold. When looping,
+ * playback jumps from `loop_end` (0 means the end of the file) back to `loop_start` without touching disk
+ * beyond the decoder's own reads. A loop that can't seek back, or that decodes nothing after the jump, ends
+ * like a stream that doesn't loop.
+ */
+struct audio_cmd_stream {
+  const char *path;
+  const void *data;
+  size_t size;
+  uint32_t budget_frames;
+  bool loop;
+  uint64_t loop_start;
+  uint64_t loop_end;
+};
+
+/** The decoder thread owns `decoder`, the audio thread only reads `ring`. Seeks are handed over through
+ * generation counters: the decoder thread seeks and asks the audio thread to drop whatever it had queued,
+ * then waits for the acknowledgement before it refills the ring.
+ */
+struct audio_stream {
+  ma_data_source_base base;
+  ma_decoder decoder;
+  ma_pcm_rb ring;
+  ma_sound sound;
+  void *ring_memory;
+  platform_thread thread;
+  uint32_t channels;
+  uint32_t sample_rate;
+  uint32_t chunk_frames;
+  uint64_t loop_start;
+  uint64_t loop_end;
+  uint32_t loop;
+  uint32_t running;
+  uint32_t decode_finished;
+  uint64_t seek_target;
+  uint32_t seek_generation;
+  uint32_t flush_generation;
+  uint32_t consumer_generation;
+};
+
+void audio_stream_init(audio_stream *stream, audio_player *audio, audio_cmd_stream cmd,
+                       mem_allocator *allocator);
+void audio_stream_destroy(audio_stream *stream, audio_player *audio, mem_allocator *allocator);
+void audio_stream_start(audio_player *audio, audio_stream *stream);
+void audio_stream_stop(audio_player *audio, audio_stream *stream);
+void audio_stream_seek(audio_stream *stream, uint64_t frame);
+void audio_stream_set_loop(audio_stream *stream, bool loop);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include "mem.hpp"
+#include "platform.hpp"
+#include "renderer.hpp"
+#include <stdint.h>
+
+#define CAPTURE_MAX_JOBS 8
+#define CAPTURE_PATH_SIZE 256
+#define CAPTURE_SETTLE_FRAMES 2
+
+/** `record_dir` gets every frame as a binary PPM, leave it NULL to not record. `golden_path` is a reference
+ * image in any format stb_image reads, compared against frame `golden_frame`. Frames are only counted once
+ * streaming settled, that is after CAPTURE_SETTLE_FRAMES frames in a row ended with no jobs but the
+ * capture's own and no texture uploads left, so the frame doesn't depend on how long loads took. Channels
+ * may differ by `golden_tolerance` and still count as equal, alpha is ignored.
+ */
+struct capture_config {
+  const char *record_dir;
+  const char *golden_path;
+  uint32_t golden_frame;
+  uint32_t golden_tolerance;
+};
+
+enum capture_golden_state {
+  CAPTURE_GOLDEN_NONE,
+  CAPTURE_GOLDEN_PENDING,
+  CAPTURE_GOLDEN_PASSED,
+  CAPTURE_GOLDEN_FAILED,
+};
+
+struct capture_golden_result {
+  uint32_t state;
+  uint32_t mismatch_count;
+  uint32_t max_difference;
+};
+
+struct capture_job {
+  struct frame_capture *capture;
+  render_capture frame;
+  char path[CAPTURE_PATH_SIZE];
+  bool golden;
+  bool busy;
+};
+
+/** Frames are read back through the renderer's fenced pixel buffers and handed to the job pool, which
+ * writes them out or compares them, so the frame loop never waits on the GPU or the disk. When the workers
+ * fall behind, the readbacks pile up on the GPU side until the renderer runs out of buffers and frames are
+ * dropped and counted instead of stalling.
+ */
+struct frame_capture {
+  capture_config config;
+  capture_job jobs_data[CAPTURE_MAX_JOBS];
+  uint32_t idle_frames;
+  // frames since streaming settled
+  uint32_t frame_count;
+  uint32_t captured_count;
+  uint32_t read_count;
+  uint32_t golden_sequence;
+  uint32_t dropped_count;
+  capture_golden_result golden;
+  platform_jobs *jobs;
+  mem_allocator *allocator;
+};
+
+void capture_init(frame_capture *capture, capture_config config, platform_jobs *jobs,
+                  mem_allocator *allocator);
+// Waits for the frames still being read back and written, the job pool must outlive it.
+void capture_destroy(frame_capture *capture, struct renderer *renderer);
+// Call after `renderer_end_frame` and before the swap.
+void capture_end_frame(frame_capture *capture, struct renderer *renderer);
+/** Call after `renderer_handle_context_lost`. Frames still being read back went with the context and count
+ * as dropped. A golden frame among them fails the run, otherwise the golden count starts over once the new
+ * context settled.
+ */
+void capture_handle_context_lost(frame_capture *capture);
+capture_golden_result capture_get_golden_result(frame_capture *capture);
+
+#endif
@@ -0,0 +1,341 @@
+#ifndef CONTAINERS_H
+#define CONTAINERS_H
+
+#include "mem.hpp"
+#include <assert.h>
+#include <emmintrin.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+/** Containers take their allocator at init and keep it, so growing never reaches for the global heap. Items
+ * are moved with memcpy and never constructed or destroyed, so only trivially copyable types are allowed,
+ * which is what the engine stores anyway. Pointers into a container are invalidated when it grows.
+ */
+
+#define CONTAINERS_MIN_CAPACITY 8
+
+template <typename T> struct dyn_array {
+  T *data;
+  uint32_t count;
+  uint32_t capacity;
+  mem_allocator *allocator;
+};
+
+template <typename T> dyn_array<T> dyn_array_init(mem_allocator *allocator, uint32_t capacity) {
+  static_assert(std::is_trivially_copyable_v<T>);
+  dyn_array<T> array = {
+      .data = NULL,
+      .count = 0,
+      .capacity = capacity,
+      .allocator = allocator,
+  };
+  if (capacity > 0) {
+    array.data = allocator_alloc(allocator, T, capacity);
+    assert(array.data != NULL);
+  }
+  return array;
+}
+
+template <typename T> void dyn_array_destroy(dyn_array<T> *array) {
+  allocator_dealloc(array->allocator, array->data);
+  *array = {};
+}
+
+template <typename T> void dyn_array_reserve(dyn_array<T> *array, uint32_t capacity) {
+  if (capacity <= array->capacity) {
+    return;
+  }
+  array->data = allocator_realloc(array->allocator, T, array->data, array->capacity, capacity);
+  assert(array->data != NULL);
+  array->capacity = capacity;
+}
+
+inline uint32_t containers_grow_capacity(uint32_t capacity, uint32_t needed) {
+  uint32_t grown = capacity < CONTAINERS_MIN_CAPACITY ? CONTAINERS_MIN_CAPACITY : capacity * 2;
+  return grown < needed ? needed : grown;
+}
+
+template <typename T> T *dyn_array_push(dyn_array<T> *array, std::type_identity_t<T> item) {
+  if (array->count == array->capacity) {
+    dyn_array_reserve(array, containers_grow_capacity(array->capacity, array->count + 1));
+  }
+  array->data[array->count] = item;
+  return &array->data[array->count++];
+}
+
+template <typename T> T dyn_array_pop(dyn_array<T> *array) {
+  assert(array->count > 0);
+  return array->data[--array->count];
+}
+
+// Moves the last item into the removed slot, so the order is not kept.
+template <typename T> void dyn_array_remove_swap(dyn_array<T> *array, uint32_t index) {
+  assert(index < array->count);
+  array->data[index] = array->data[--array->count];
+}
+
+template <typename T> void dyn_array_clear(dyn_array<T> *array) { array->count = 0; }
+
+/** Keeps up to N items inside the struct and only allocates once it holds more, for the many short lists that
+ * rarely outgrow a handful of items. It doesn't point into itself, so it can be copied while it is inline.
+ */
+template <typename T, uint32_t N> struct small_array {
+  T items[N];
+  T *heap;
+  uint32_t count;
+  uint32_t capacity;
+  mem_allocator *allocator;
+};
+
+template <typename T, uint32_t N> void small_array_init(small_array<T, N> *array, mem_allocator *allocator) {
+  static_assert(std::is_trivially_copyable_v<T> && N > 0);
+  array->heap = NULL;
+  array->count = 0;
+  array->capacity = N;
+  array->allocator = allocator;
+}
+
+template <typename T, uint32_t N> void small_array_destroy(small_array<T, N> *array) {
+  allocator_dealloc(array->allocator, array->heap);
+  small_array_init(array, array->allocator);
+}
+
+template <typename T, uint32_t N> T *small_array_data(small_array<T, N> *array) {
+  return array->heap != NULL ? array->heap : array->items;
+}
+
+template <typename T, uint32_t N> void small_array_reserve(small_array<T, N> *array, uint32_t capacity) {
+  if (capacity <= array->capacity) {
+    return;
+  }
+  if (array->heap == NULL) {
+    array->heap = allocator_alloc(array->allocator, T, capacity);
+    assert(array->heap != NULL);
+    memcpy(array->heap, array->items, sizeof(T) * array->count);
+  } else {
+    array->heap = allocator_realloc(array->allocator, T, array->heap, array->capacity, capacity);
+    assert(array->heap != NULL);
+  }
+  array->capacity = capacity;
+}
+
+template <typename T, uint32_t N>
+T *small_array_push(small_array<T, N> *array, std::type_identity_t<T> item) {
+  if (array->count == array->capacity) {
+    small_array_reserve(array, containers_grow_capacity(array->capacity, array->count + 1));
+  }
+  T *data = small_array_data(array);
+  data[array->count] = item;
+  return &data[array->count++];
+}
+
+template <typename T, uint32_t N> T small_array_pop(small_array<T, N> *array) {
+  assert(array->count > 0);
+  return small_array_data(array)[--array->count];
+}
+
+template <typename T, uint32_t N> void small_array_remove_swap(small_array<T, N> *array, uint32_t index) {
+  assert(index < array->count);
+  T *data = small_array_data(array);
+  data[index] = data[--array->count];
+}
+
+template <typename T, uint32_t N> void small_array_clear(small_array<T, N> *array) { array->count = 0; }
+
+inline uint64_t hash_u64(uint64_t x) {
+  // splitmix64 finalizer, every input bit reaches both the group index and the tag
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ull;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBull;
+  return x ^ (x >> 31);
+}
+
+uint64_t hash_bytes(const void *data, size_t size);
+
+// Keys of other types need their own `hash_key` overload, declared before the map is used.
+inline uint64_t hash_key(uint32_t key) { return hash_u64(key); }
+inline uint64_t hash_key(int32_t key) { return hash_u64((uint32_t)key); }
+inline uint64_t hash_key(uint64_t key) { return hash_u64(key); }
+inline uint64_t hash_key(const void *key) { return hash_u64((uintptr_t)key); }
+
+#define HASH_MAP_GROUP_WIDTH 16
+#define HASH_MAP_EMPTY ((int8_t)0x80)
+#define HASH_MAP_DELETED ((int8_t)0xFE)
+#define HASH_MAP_NOT_FOUND UINT32_MAX
+
+/** Open addressing in the style of SwissTable. Every slot has a control byte that is either empty, deleted
+ * or the low 7 bits of its key's hash, and lookups compare a whole group of 16 control bytes against the tag
+ * with one SSE2 compare, only touching keys whose tag matched. Probing jumps between groups in a triangular
+ * sequence, which visits every group since the capacity is a power of two. The first group's control bytes
+ * are mirrored after the last one so a group starting near the end can be loaded without wrapping.
+ *
+ * Removing leaves a deleted marker so later probes keep going. The map is rebuilt once empty slots run out,
+ * at the same size when most of them were taken by deleted markers, otherwise at twice the size.
+ */
+template <typename K, typename V> struct hash_map {
+  int8_t *ctrl;
+  K *keys;
+  V *values;
+  uint32_t capacity;
+  uint32_t count;
+  uint32_t growth_left;
+  mem_allocator *allocator;
+};
+
+inline uint32_t hash_group_match(const int8_t *group, int8_t tag) {
+  __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+  return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+}
+
+inline uint32_t hash_group_match_free(const int8_t *group) {
+  // empty and deleted are the only control bytes with the sign bit set
+  return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+
+inline void hash_map_set_ctrl(int8_t *ctrl, uint32_t capacity, uint32_t index, int8_t value) {
+  ctrl[index] = value;
+  if (index < HASH_MAP_GROUP_WIDTH) {
+    ctrl[capacity + index] = value;
+  }
+}
+
+template <typename K, typename V> void hash_map_allocate(hash_map<K, V> *map, uint32_t capacity) {
+  static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>);
+  assert(capacity >= HASH_MAP_GROUP_WIDTH && (capacity & (capacity - 1)) == 0);
+  // control bytes, keys and values share one block
+  size_t keys_offset = (capacity + HASH_MAP_GROUP_WIDTH + alignof(K) - 1) & ~(alignof(K) - 1);
+  size_t values_offset = (keys_offset + sizeof(K) * capacity + alignof(V) - 1) & ~(alignof(V) - 1);
+  size_t alignment = alignof(K) > alignof(V) ? alignof(K) : alignof(V);
+  alignment = alignment > HASH_MAP_GROUP_WIDTH ? alignment : HASH_MAP_GROUP_WIDTH;
+  uint8_t *block = (uint8_t *)allocator_alloc_impl(map->allocator, values_offset + sizeof(V) * capacity,
+                                                   alignment);
+  assert(block != NULL);
+  memset(block, (uint8_t)HASH_MAP_EMPTY, capacity + HASH_MAP_GROUP_WIDTH);
+  map->ctrl = (int8_t *)block;
+  map->keys = (K *)(block + keys_offset);
+  map->values = (V *)(block + values_offset);
+  map->capacity = capacity;
+  map->count = 0;
+  map->growth_left = capacity - capacity / 8;
+}
+
+// Sized so `count` items fit without rebuilding.
+template <typename K, typename V> hash_map<K, V> hash_map_init(mem_allocator *allocator, uint32_t count) {
+  uint32_t capacity = HASH_MAP_GROUP_WIDTH;
+  while (capacity - capacity / 8 < count) {
+    capacity *= 2;
+  }
+  hash_map<K, V> map = {.allocator = allocator};
+  hash_map_allocate(&map, capacity);
+  return map;
+}
+
+template <typename K, typename V> void hash_map_destroy(hash_map<K, V> *map) {
+  allocator_dealloc(map->allocator, map->ctrl);
+  *map = {};
+}
+
+template <typename K, typename V> void hash_map_clear(hash_map<K, V> *map) {
+  memset(map->ctrl, (uint8_t)HASH_MAP_EMPTY, map->capacity + HASH_MAP_GROUP_WIDTH);
+  map->count = 0;
+  map->growth_left = map->capacity - map->capacity / 8;
+}
+
+template <typename K, typename V> bool hash_map_is_slot_full(hash_map<K, V> *map, uint32_t index) {
+  return map->ctrl[index] >= 0;
+}
+
+template <typename K, typename V>
+uint32_t hash_map_find_index(hash_map<K, V> *map, const K &key, uint64_t hash) {
+  int8_t tag = (int8_t)(hash & 0x7F);
+  uint32_t mask = map->capacity - 1;
+  uint32_t pos = (uint32_t)(hash >> 7) & mask;
+  for (uint32_t step = HASH_MAP_GROUP_WIDTH;; step += HASH_MAP_GROUP_WIDTH) {
+    const int8_t *group = map->ctrl + pos;
+    for (uint32_t match = hash_group_match(group, tag); match != 0; match &= match - 1) {
+      uint32_t index = (pos + __builtin_ctz(match)) & mask;
+      if (map->keys[index] == key) {
+        return index;
+      }
+    }
+    // the key would have been placed in the first free slot, so an empty one ends the search
+    if (hash_group_match(group, HASH_MAP_EMPTY) != 0) {
+      return HASH_MAP_NOT_FOUND;
+    }
+    pos = (pos + step) & mask;
+  }
+}
+
+template <typename K, typename V> uint32_t hash_map_find_free(hash_map<K, V> *map, uint64_t hash) {
+  uint32_t mask = map->capacity - 1;
+  uint32_t pos = (uint32_t)(hash >> 7) & mask;
+  for (uint32_t step = HASH_MAP_GROUP_WIDTH;; step += HASH_MAP_GROUP_WIDTH) {
+    uint32_t match = hash_group_match_free(map->ctrl + pos);
+    if (match != 0) {
+      return (pos + __builtin_ctz(match)) & mask;
+    }
+    pos = (pos + step) & mask;
+  }
+}
+
+template <typename K, typename V> void hash_map_rebuild(hash_map<K, V> *map, uint32_t capacity) {
+  hash_map<K, V> old = *map;
+  hash_map_allocate(map, capacity);
+  for (uint32_t i = 0; i < old.capacity; i++) {
+    if (!hash_map_is_slot_full(&old, i)) {
+      continue;
+    }
+    // keys are unique, so they go straight into the first free slot
+    uint64_t hash = hash_key(old.keys[i]);
+    uint32_t index = hash_map_find_free(map, hash);
+    hash_map_set_ctrl(map->ctrl, map->capacity, index, (int8_t)(hash & 0x7F));
+    map->keys[index] = old.keys[i];
+    map->values[index] = old.values[i];
+  }
+  map->count = old.count;
+  map->growth_left -= old.count;
+  allocator_dealloc(map->allocator, old.ctrl);
+}
+
+template <typename K, typename V> V *hash_map_get(hash_map<K, V> *map, std::type_identity_t<K> key) {
+  uint32_t index = hash_map_find_index(map, key, hash_key(key));
+  return index == HASH_MAP_NOT_FOUND ? NULL : &map->values[index];
+}
+
+// Inserts the key or overwrites its value, returning where the value lives until the map next grows.
+template <typename K, typename V>
+V *hash_map_put(hash_map<K, V> *map, std::type_identity_t<K> key, std::type_identity_t<V> value) {
+  uint64_t hash = hash_key(key);
+  uint32_t index = hash_map_find_index(map, key, hash);
+  if (index == HASH_MAP_NOT_FOUND) {
+    if (map->growth_left == 0) {
+      bool mostly_deleted = map->count <= (map->capacity - map->capacity / 8) / 2;
+      hash_map_rebuild(map, mostly_deleted ? map->capacity : map->capacity * 2);
+    }
+    index = hash_map_find_free(map, hash);
+    // reusing a deleted slot doesn't use up an empty one
+    if (map->ctrl[index] == HASH_MAP_EMPTY) {
+      map->growth_left--;
+    }
+    hash_map_set_ctrl(map->ctrl, map->capacity, index, (int8_t)(hash & 0x7F));
+    map->keys[index] = key;
+    map->count++;
+  }
+  map->values[index] = value;
+  return &map->values[index];
+}
+
+template <typename K, typename V> bool hash_map_remove(hash_map<K, V> *map, std::type_identity_t<K> key) {
+  uint32_t index = hash_map_find_index(map, key, hash_key(key));
+  if (index == HASH_MAP_NOT_FOUND) {
+    return false;
+  }
+  hash_map_set_ctrl(map->ctrl, map->capacity, index, HASH_MAP_DELETED);
+  map->count--;
+  return true;
+}
+
+#endif
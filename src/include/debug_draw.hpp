@@ -0,0 +1,98 @@
+#ifndef DEBUG_DRAW_H
+#define DEBUG_DRAW_H
+
+#include "containers.hpp"
+#include "mem.hpp"
+#include "renderer.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+// What the streams reserve every frame, so the common case never grows them inside the temp allocator.
+#define DEBUG_DRAW_RESERVED_VERTICES 4096
+#define DEBUG_DRAW_MIN_CIRCLE_SEGMENTS 12
+#define DEBUG_DRAW_MAX_CIRCLE_SEGMENTS 64
+#define DEBUG_DRAW_ARROW_HEAD_SIZE 12.0f
+
+/** Every shape takes its color in 0..255 like the render commands, and is drawn for `duration` seconds, or
+ * only in the current frame when that is zero.
+ */
+struct debug_cmd_line {
+  glm::vec3 from;
+  glm::vec3 to;
+  glm::vec4 color;
+  float duration;
+};
+
+struct debug_cmd_rect {
+  glm::vec3 min;
+  glm::vec2 size;
+  glm::vec4 color;
+  bool filled;
+  float duration;
+};
+
+struct debug_cmd_circle {
+  glm::vec3 center;
+  float radius;
+  glm::vec4 color;
+  bool filled;
+  float duration;
+};
+
+// Zero `head_size` uses DEBUG_DRAW_ARROW_HEAD_SIZE, shrunk for arrows too short to fit it.
+struct debug_cmd_arrow {
+  glm::vec3 from;
+  glm::vec3 to;
+  glm::vec4 color;
+  float head_size;
+  float duration;
+};
+
+enum debug_shape_kind {
+  DEBUG_SHAPE_LINE,
+  DEBUG_SHAPE_RECT,
+  DEBUG_SHAPE_CIRCLE,
+  DEBUG_SHAPE_ARROW,
+};
+
+// A shape that outlives its frame, emitted again every frame until its time runs out.
+struct debug_shape {
+  debug_shape_kind kind;
+  float time_left;
+  union {
+    debug_cmd_line line;
+    debug_cmd_rect rect;
+    debug_cmd_circle circle;
+    debug_cmd_arrow arrow;
+  };
+};
+
+/** Immediate mode debug geometry. Shapes are turned into vertices as they are added, into a line stream and
+ * a triangle stream that live in the temp allocator for one frame, and `debug_draw_flush` hands both to the
+ * renderer in one call, which costs two draws no matter how many shapes there are. Shapes with a duration
+ * are also kept in a list from the persistent allocator and emitted again by every `debug_draw_begin_frame`
+ * until they expire.
+ *
+ * Nothing is recorded while `enabled` is off, so calls can stay in the code at the cost of a branch.
+ */
+struct debug_draw {
+  bool enabled;
+  dyn_array<render_debug_vertex> lines;
+  dyn_array<render_debug_vertex> triangles;
+  dyn_array<debug_shape> timed;
+  mem_allocator *temp_allocator;
+};
+
+void debug_draw_init(debug_draw *draw, mem_allocator *allocator, mem_allocator *temp_allocator);
+void debug_draw_destroy(debug_draw *draw);
+
+// Starts new streams in the temp allocator, call it every frame before adding shapes. Ages the timed shapes.
+void debug_draw_begin_frame(debug_draw *draw, float dt);
+void debug_draw_flush(debug_draw *draw, struct renderer *renderer);
+
+void debug_draw_line(debug_draw *draw, debug_cmd_line line);
+void debug_draw_rect(debug_draw *draw, debug_cmd_rect rect);
+void debug_draw_circle(debug_draw *draw, debug_cmd_circle circle);
+void debug_draw_arrow(debug_draw *draw, debug_cmd_arrow arrow);
+
+#endif
@@ -1,8 +1,10 @@
 #ifndef GAME_H
 #define GAME_H
 
+#include "audio.hpp"
 #include "game/asset.hpp"
 #include "mem.hpp"
+#include "platform.hpp"
 #include "renderer.hpp"
 #include <stdbool.h>
 #include <stdint.h>
@@ -146,9 +148,30 @@ static inline void game_reset_input(game_input *input) {
   }
 }
 
-void game_init(game_memory *memory, renderer *renderer, ma_engine *audio_player);
+/** The game is built as its own shared library that the platform layer loads by these names and swaps when
+ * it changes on disk. Everything that has to survive a swap lives in `game_memory` or in the engine, so the
+ * game must not keep globals, and a pointer into the library, such as a function registered as a callback or
+ * a string literal, dangles after the swap. Changing the layout of the game state needs a restart.
+ *
+ * `game_load` pushes the jobs that read and decode every asset, it only touches the game state and the
+ * shared allocator so it can run before the window and GL context exist. `game_init` runs on the context
+ * thread once the jobs have finished and uploads what they decoded.
+ */
+extern "C" {
+void game_load(game_memory *memory, platform_jobs *jobs);
+void game_init(game_memory *memory, renderer *renderer, audio_player *audio_player);
 void game_update(const game_input *input, const float dt, game_memory *memory, struct renderer *renderer,
-                 ma_engine *audio_player);
+                 audio_player *audio_player);
 void game_deinit(game_memory *memory, struct renderer *renderer);
+// Called for every watched file written on disk, with the time the watcher saw the change.
+void game_file_changed(game_memory *memory, const char *path, uint64_t changed_ns);
+}
+
+typedef void (*game_load_fn)(game_memory *memory, platform_jobs *jobs);
+typedef void (*game_init_fn)(game_memory *memory, renderer *renderer, audio_player *audio_player);
+typedef void (*game_update_fn)(const game_input *input, const float dt, game_memory *memory,
+                               struct renderer *renderer, audio_player *audio_player);
+typedef void (*game_deinit_fn)(game_memory *memory, struct renderer *renderer);
+typedef void (*game_file_changed_fn)(game_memory *memory, const char *path, uint64_t changed_ns);
 
 #endif
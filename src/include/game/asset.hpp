@@ -1,25 +1,32 @@
 #ifndef ASSET_H
 #define ASSET_H
 
+#include "audio.hpp"
 #include "mem.hpp"
-#include "miniaudio.h"
 #include <glm/glm.hpp>
 
+/** A copy of `path` is kept so the pixels can be decoded again from disk after `asset_drop_image_data`. An
+ * image that fails to decode has no data and a zero size.
+ */
 struct asset_image {
+  const char *path;
   glm::vec2 size;
   unsigned char *data;
   uint32_t texture_id;
 };
 asset_image asset_load_image(const char *path, mem_allocator *allocator, mem_allocator *temp_allocator);
+void asset_drop_image_data(asset_image *image, mem_allocator *allocator);
 void asset_delete_image(asset_image *image, mem_allocator *allocator);
 
+/** Sounds are decoded once at load into the audio mix format, and every voice playing them reads the same
+ * frames. A sound that fails to decode has no frames.
+ */
 struct asset_sound {
-  unsigned char *data;
-  ma_sound *sound;
-  ma_decoder *decoder;
+  float *frames;
+  uint64_t frame_count;
 };
-asset_sound asset_load_sound(const char *path, ma_engine *audio_player, mem_allocator *allocator);
-void asset_delete_sound(asset_sound *wav, mem_allocator *allocator);
+asset_sound asset_load_sound(const char *path, mem_allocator *allocator, mem_allocator *temp_allocator);
+void asset_delete_sound(asset_sound *sound, mem_allocator *allocator);
 
 #define ASSET_FONT_NUM_CHARS 128
 struct asset_font_char {
@@ -28,12 +35,24 @@ struct asset_font_char {
   glm::vec2 bearing;
   uint32_t advance;
   unsigned char *data;
+  glm::vec4 page_uv;
 };
 
+/** Like images, fonts keep a copy of their path so a single glyph can be rendered again after the CPU copies
+ * were dropped. `asset_reload_font_glyph` takes the font as user data and the character as the index.
+ * Glyphs either get a texture each or share one page, see `text_load_font_page`. A font that fails to decode
+ * has no glyphs and a zero height.
+ */
 struct asset_font {
+  const char *path;
+  float height;
   asset_font_char characters[ASSET_FONT_NUM_CHARS];
+  uint32_t page_texture_id;
+  glm::vec4 page_solid_uv;
 };
 asset_font asset_load_font(const char *path, float height, mem_allocator *allocator,
                            mem_allocator *temp_allocator);
+uint8_t *asset_reload_font_glyph(void *font, uint32_t index, mem_allocator *temp_allocator);
+void asset_drop_font_data(asset_font *font, mem_allocator *allocator);
 void asset_delete_font(asset_font *font, mem_allocator *allocator);
 #endif
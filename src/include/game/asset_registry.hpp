@@ -0,0 +1,116 @@
+#ifndef ASSET_REGISTRY_H
+#define ASSET_REGISTRY_H
+
+#include "containers.hpp"
+#include "game/asset.hpp"
+#include "platform.hpp"
+#include "renderer.hpp"
+#include <stdint.h>
+
+// Frames an asset stays resident after its last reference is released, so a quick re-request is free.
+#define ASSET_REGISTRY_GRACE_FRAMES 120
+#define ASSET_NULL UINT32_MAX
+
+// 64 bit FNV-1a, usable at compile time so ids for known paths can be constants.
+constexpr uint64_t asset_hash_path(const char *path) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (; *path != '\0'; path++) {
+    hash = (hash ^ (uint8_t)*path) * 0x100000001B3ull;
+  }
+  return hash;
+}
+
+enum asset_type {
+  ASSET_TYPE_IMAGE,
+  ASSET_TYPE_FONT,
+  ASSET_TYPE_SOUND,
+};
+
+enum asset_state {
+  ASSET_STATE_LOADING,
+  ASSET_STATE_LOADED,
+  ASSET_STATE_FAILED,
+};
+
+// The generation tells a handle apart from a later asset that reused its slot.
+struct asset_handle {
+  uint32_t index;
+  uint32_t generation;
+};
+
+struct asset_entry {
+  uint64_t id;
+  asset_type type;
+  uint32_t state;
+  uint32_t ref_count;
+  uint32_t generation;
+  uint64_t released_frame;
+  bool pending_free;
+  const char *path;
+  float font_height;
+  struct asset_registry *registry;
+  union {
+    asset_image image;
+    asset_font font;
+    asset_sound sound;
+  };
+};
+
+struct asset_registry_stats {
+  uint32_t request_count;
+  uint32_t shared_count;
+  uint32_t decode_count;
+  uint32_t freed_count;
+};
+
+/** Every asset is loaded once, however many places ask for it. Requests look the path's hash up in a hash
+ * map, so a repeated request only bumps a reference count and returns the same handle, while a new one
+ * queues a decode on the job pool and returns right away with the asset still loading. Released assets are
+ * freed by `asset_registry_collect` once they went unreferenced for ASSET_REGISTRY_GRACE_FRAMES frames,
+ * along with any texture they still hold. A sound must not be playing anymore when that happens.
+ *
+ * Entries never move, so pointers from the getters, such as a font given to the renderer as reload user
+ * data, stay valid until the asset is freed. Requests, releases and collection happen on one thread, only
+ * the decode runs on the workers. Every entry points back at the registry for its decode job, so it is
+ * initialized in place and can't move while loads are in flight.
+ */
+struct asset_registry {
+  asset_entry *entries;
+  uint32_t capacity;
+  uint32_t used;
+  dyn_array<uint32_t> free_slots;
+  dyn_array<uint32_t> released;
+  hash_map<uint64_t, uint32_t> slots;
+  uint64_t frame;
+  uint32_t pending_count;
+  platform_jobs *jobs;
+  mem_allocator *allocator;
+  asset_registry_stats stats;
+};
+
+void asset_registry_init(asset_registry *registry, uint32_t capacity, platform_jobs *jobs,
+                         mem_allocator *allocator);
+// Waits for loads still in flight, then frees every asset whether it is referenced or not.
+void asset_registry_destroy(asset_registry *registry, struct renderer *renderer);
+// Advances the frame count and frees assets whose grace period ran out.
+void asset_registry_collect(asset_registry *registry, struct renderer *renderer);
+
+asset_handle asset_request_image(asset_registry *registry, const char *path);
+// A font is registered at one height, requesting it again at another one is an error.
+asset_handle asset_request_font(asset_registry *registry, const char *path, float height);
+asset_handle asset_request_sound(asset_registry *registry, const char *path);
+// Finds an asset without taking a reference, the index is ASSET_NULL when it isn't registered.
+asset_handle asset_lookup(asset_registry *registry, uint64_t id);
+void asset_release(asset_registry *registry, asset_handle handle);
+
+// Loads queued or decoding on the workers.
+uint32_t asset_registry_get_pending_count(asset_registry *registry);
+
+asset_state asset_get_state(asset_registry *registry, asset_handle handle);
+const char *asset_get_path(asset_registry *registry, asset_handle handle);
+// The getters return NULL until the asset has loaded.
+asset_image *asset_get_image(asset_registry *registry, asset_handle handle);
+asset_font *asset_get_font(asset_registry *registry, asset_handle handle);
+asset_sound *asset_get_sound(asset_registry *registry, asset_handle handle);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef PERF_HUD_H
+#define PERF_HUD_H
+
+#include "game/asset.hpp"
+#include "mem.hpp"
+#include "renderer.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+#define PERF_HUD_FRAMES 128
+// Frame times at or above this fill the whole graph.
+#define PERF_HUD_GRAPH_MS 33.3f
+
+// Counters the caller gathers from the subsystems, the HUD only draws them.
+struct perf_hud_stats {
+  render_state_stats render;
+  mem_allocator_usage allocator;
+  mem_allocator_usage temp_allocator;
+  uint32_t voice_count;
+  uint32_t pending_asset_count;
+};
+
+/** Keeps the last PERF_HUD_FRAMES frame times in a ring for the graph and the p99. The overlay is text and
+ * solid rects from one font page, so it costs a single draw as long as nothing with another texture is drawn
+ * between its text and its rects. It also shows what building itself took on the previous frame.
+ */
+struct perf_hud {
+  float frame_ms[PERF_HUD_FRAMES];
+  uint32_t next_frame;
+  uint32_t frame_count;
+  bool visible;
+  float build_ms;
+};
+
+void perf_hud_init(perf_hud *hud);
+void perf_hud_record_frame(perf_hud *hud, float dt);
+// The frame time that 99% of the recorded frames stayed under.
+float perf_hud_get_p99_ms(perf_hud *hud);
+// Draws the overlay with its top left corner at `pos` in UI coordinates, does nothing while hidden.
+void perf_hud_render(perf_hud *hud, struct renderer *renderer, asset_font *font, glm::vec2 pos,
+                     perf_hud_stats stats);
+
+#endif
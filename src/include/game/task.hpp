@@ -0,0 +1,157 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "audio.hpp"
+#include "containers.hpp"
+#include "game/asset_registry.hpp"
+#include "mem.hpp"
+#include <assert.h>
+#include <coroutine>
+#include <stddef.h>
+#include <stdint.h>
+
+// Frames up to this size, header included, are recycled through the scheduler's pool.
+#define TASK_FRAME_BLOCK_SIZE 512
+#define TASK_POOL_CHUNK_BLOCKS 64
+
+// Sits in front of every coroutine frame, links the live frames so they can be dropped without running them.
+struct alignas(16) task_frame {
+  task_frame *prev;
+  task_frame *next;
+  struct task_scheduler *scheduler;
+  uint32_t size;
+};
+
+struct task_timer {
+  double wake_time;
+  std::coroutine_handle<> handle;
+};
+
+struct task_asset_wait {
+  std::coroutine_handle<> handle;
+  asset_registry *registry;
+  asset_handle asset;
+};
+
+struct task_sound_wait {
+  std::coroutine_handle<> handle;
+  audio_player *audio;
+  uint32_t play_id;
+};
+
+struct task_scheduler_stats {
+  uint32_t live_count;
+  uint32_t resumed_count;
+  uint32_t pooled_block_count;
+};
+
+/** Gameplay behaviors written as coroutines instead of state machines. A task runs as soon as it is called,
+ * until its first `co_await`, and is only resumed once what it waits for happened: the next frame, a
+ * duration of game time, an asset finishing its load or a sound finishing its playback. Tasks waiting on
+ * time sit in a heap, so a sleeping task costs nothing until it wakes. Asset and sound waits are checked
+ * once per frame each.
+ *
+ * Frames come from the scheduler's allocator, with the common small ones recycled through a pool, and a
+ * finished task frees its own frame. Every task function takes the scheduler as its first parameter, which
+ * is where the frame allocation finds it.
+ *
+ * `task_scheduler_reset` drops every suspended task without running its destructors, since after a game
+ * library reload the code they would run is gone. Tasks hold plain data for that reason, like the rest of
+ * the game state. Every frame keeps a pointer to its scheduler, so it must not move while tasks are alive.
+ */
+struct task_scheduler {
+  double time;
+  dyn_array<std::coroutine_handle<>> next_frame;
+  dyn_array<std::coroutine_handle<>> ready;
+  dyn_array<task_timer> timers;
+  dyn_array<task_asset_wait> asset_waits;
+  dyn_array<task_sound_wait> sound_waits;
+  task_frame *live;
+  task_frame *free_blocks;
+  dyn_array<uint8_t *> chunks;
+  uint32_t live_count;
+  uint32_t pooled_block_count;
+  uint32_t resumed_count;
+  mem_allocator *allocator;
+};
+
+void task_scheduler_init(task_scheduler *scheduler, mem_allocator *allocator);
+void task_scheduler_destroy(task_scheduler *scheduler);
+// Advances game time by `dt` seconds and resumes the tasks whose wait is over.
+void task_scheduler_update(task_scheduler *scheduler, float dt);
+// Frees every suspended task without resuming or destroying it, call it outside of `task_scheduler_update`.
+void task_scheduler_reset(task_scheduler *scheduler);
+task_scheduler_stats task_scheduler_get_stats(task_scheduler *scheduler);
+
+void *task_alloc_frame(task_scheduler *scheduler, size_t size);
+void task_free_frame(void *frame);
+
+/** The return type of task functions. Tasks aren't awaited or joined, so it carries nothing, and a task
+ * that wants to hand something back writes it wherever its caller told it to.
+ */
+struct task {
+  struct promise_type {
+    template <typename... Args> static void *operator new(size_t size, task_scheduler *scheduler, Args &...) {
+      return task_alloc_frame(scheduler, size);
+    }
+    static void operator delete(void *frame) { task_free_frame(frame); }
+
+    task get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { assert(false && "Task threw"); }
+  };
+};
+
+struct task_frame_awaiter {
+  task_scheduler *scheduler;
+  bool await_ready() { return false; }
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume() {}
+};
+
+struct task_time_awaiter {
+  task_scheduler *scheduler;
+  double wake_time;
+  bool await_ready() { return wake_time <= scheduler->time; }
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume() {}
+};
+
+struct task_asset_awaiter {
+  task_scheduler *scheduler;
+  asset_registry *registry;
+  asset_handle asset;
+  bool await_ready() { return asset_get_state(registry, asset) != ASSET_STATE_LOADING; }
+  void await_suspend(std::coroutine_handle<> handle);
+  // Whether the asset loaded or failed.
+  asset_state await_resume() { return asset_get_state(registry, asset); }
+};
+
+struct task_sound_awaiter {
+  task_scheduler *scheduler;
+  audio_player *audio;
+  uint32_t play_id;
+  // 0 is a play that was dropped before it was queued
+  bool await_ready() { return play_id == 0 || !audio_is_playing(audio, play_id); }
+  void await_suspend(std::coroutine_handle<> handle);
+  void await_resume() {}
+};
+
+inline task_frame_awaiter task_next_frame(task_scheduler *scheduler) { return {.scheduler = scheduler}; }
+
+inline task_time_awaiter task_wait_seconds(task_scheduler *scheduler, float seconds) {
+  return {.scheduler = scheduler, .wake_time = scheduler->time + seconds};
+}
+
+inline task_asset_awaiter task_wait_asset(task_scheduler *scheduler, asset_registry *registry,
+                                          asset_handle asset) {
+  return {.scheduler = scheduler, .registry = registry, .asset = asset};
+}
+
+inline task_sound_awaiter task_wait_sound(task_scheduler *scheduler, audio_player *audio, uint32_t play_id) {
+  return {.scheduler = scheduler, .audio = audio, .play_id = play_id};
+}
+
+#endif
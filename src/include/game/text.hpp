@@ -5,7 +5,19 @@
 #include "renderer.hpp"
 #include <glm/glm.hpp>
 
+#define TEXT_PAGE_WIDTH 512
+#define TEXT_PAGE_PADDING 1
+#define TEXT_PAGE_SOLID_SIZE 4
+
 void text_load_font_glyphs(struct renderer *renderer, asset_font *font);
+/** Packs every glyph into one coverage texture next to a small solid block, so all text drawn with the font,
+ * and rects from `text_render_rect`, batch into a single draw instead of one per glyph texture. It needs the
+ * glyph pixels, so it runs before `asset_drop_font_data`. The page is built in `temp_allocator`, so uploads
+ * must be flushed before that is cleared. Like single glyphs it reloads by decoding the font from disk again,
+ * so it comes back after an eviction or a lost context.
+ */
+void text_load_font_page(struct renderer *renderer, asset_font *font, mem_allocator *temp_allocator);
+// Deletes the glyph textures and the page, whichever were loaded.
 void text_delete_font_glyphs(struct renderer *renderer, asset_font *font);
 
 struct text_cmd_render {
@@ -16,5 +28,8 @@ struct text_cmd_render {
   float scale;
 };
 void text_render_text(struct renderer *renderer, text_cmd_render cmd);
+// A solid rect centered on `pos`, drawn from the font's page so it lands in the same batch as its text.
+void text_render_rect(struct renderer *renderer, asset_font *font, glm::vec3 pos, glm::vec2 size,
+                      glm::vec4 color);
 
 #endif
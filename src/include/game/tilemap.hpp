@@ -0,0 +1,49 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include "mem.hpp"
+#include "renderer.hpp"
+#include <glm/glm.hpp>
+
+#define TILEMAP_CHUNK_SIZE 32
+#define TILEMAP_EMPTY 0
+
+/** A tileset is a single texture cut into a grid of equally sized tiles. Tile `n` in a map refers to the
+ * `n - 1`th tile of the set, counting left to right, top to bottom, so that 0 can mean an empty tile.
+ */
+struct tilemap_tileset {
+  uint32_t texture_id;
+  glm::vec2 texture_size;
+  glm::vec2 tile_size;
+};
+
+struct tilemap_chunk {
+  uint32_t mesh_id;
+  bool dirty;
+};
+
+struct tilemap {
+  uint32_t width;
+  uint32_t height;
+  uint32_t chunks_x;
+  uint32_t chunks_y;
+  float tile_size;
+  glm::vec3 pos;
+  tilemap_tileset tileset;
+  uint16_t *tiles;
+  tilemap_chunk *chunks;
+};
+
+tilemap tilemap_init(uint32_t width, uint32_t height, float tile_size, tilemap_tileset tileset,
+                     mem_allocator *allocator);
+void tilemap_destroy(tilemap *map, struct renderer *renderer, mem_allocator *allocator);
+void tilemap_set_tile(tilemap *map, uint32_t x, uint32_t y, uint16_t tile);
+uint16_t tilemap_get_tile(tilemap *map, uint32_t x, uint32_t y);
+
+/** Draws every chunk that intersects the camera, one draw per chunk. Chunks whose tiles changed, or whose
+ * mesh went with a lost context, are rebuilt right before they are drawn, so edits to chunks that are off
+ * screen cost nothing until they come into view.
+ */
+void tilemap_render(tilemap *map, struct renderer *renderer, mem_allocator *temp_allocator);
+
+#endif
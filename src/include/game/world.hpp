@@ -0,0 +1,111 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include "containers.hpp"
+#include "game/tilemap.hpp"
+#include "mem.hpp"
+#include "platform.hpp"
+#include "renderer.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+#define WORLD_FILE_MAGIC 0x444C5257
+#define WORLD_MAX_RESIDENT_CELLS 64
+// How quickly the tracked camera velocity follows the real one, per frame.
+#define WORLD_VELOCITY_SMOOTHING 0.2f
+
+/** A world file starts with this header, followed by one `world_file_cell` per cell, row by row from the
+ * bottom left, and then the cells themselves. A cell is `cell_tiles` rows of `cell_tiles` uint16 tiles, so
+ * loading one is a single read straight into its tilemap.
+ */
+struct world_file_header {
+  uint32_t magic;
+  uint32_t cells_x;
+  uint32_t cells_y;
+  uint32_t cell_tiles;
+};
+
+struct world_file_cell {
+  uint64_t offset;
+  uint64_t size;
+};
+
+/** `prefetch_margin` is how far around the view, in world units, cells are loaded ahead of being seen, and
+ * the view is also stretched `lookahead_seconds` along the camera's velocity. Every resident cell owns an
+ * arena of `cell_arena_size` bytes that everything the cell loads lives in. The world keeps its own copy of
+ * `path`.
+ */
+struct world_config {
+  const char *path;
+  float tile_size;
+  tilemap_tileset tileset;
+  uint32_t max_resident_cells;
+  uintptr_t cell_arena_size;
+  float prefetch_margin;
+  float lookahead_seconds;
+};
+
+enum world_cell_state {
+  WORLD_CELL_FREE,
+  WORLD_CELL_LOADING,
+  WORLD_CELL_LOADED,
+};
+
+struct world_cell {
+  uint32_t x;
+  uint32_t y;
+  uint32_t state;
+  uint64_t wanted_frame;
+  mem_allocator arena;
+  tilemap map;
+  struct world *world;
+};
+
+struct world_stats {
+  uint32_t resident_count;
+  uint32_t loading_count;
+  uint32_t loaded_count;
+  uint32_t unloaded_count;
+  // cells that were wanted while every slot held a cell that was wanted too
+  uint32_t skipped_count;
+};
+
+/** Streams a world that is too big to keep in memory in cells around the camera. Only the header and the
+ * cell table are read up front. Every frame the cells under the view, grown by the prefetch margin and
+ * stretched along the camera's velocity, are wanted: missing ones are loaded on the job pool nearest first,
+ * and loaded ones that drifted more than a cell outside of that area are unloaded by clearing their arena,
+ * so memory and load time follow the neighbourhood of the camera instead of the size of the world.
+ *
+ * Cell slots and their arenas are allocated once at init. When all of them are taken, the cell wanted
+ * longest ago makes room. Cells point back at the world so their load jobs can read its table, which is
+ * why it is initialized in place.
+ */
+struct world {
+  world_config config;
+  world_file_header header;
+  world_file_cell *table;
+  world_cell cells[WORLD_MAX_RESIDENT_CELLS];
+  hash_map<uint64_t, uint32_t> resident;
+  glm::vec2 last_center;
+  glm::vec2 velocity;
+  bool has_center;
+  uint64_t frame;
+  world_stats stats;
+  platform_jobs *jobs;
+  mem_allocator *allocator;
+};
+
+void world_init(world *world, world_config config, platform_jobs *jobs, mem_allocator *allocator);
+// Waits for the loads still in flight.
+void world_destroy(world *world, struct renderer *renderer);
+void world_update(world *world, struct renderer *renderer, float dt);
+void world_render(world *world, struct renderer *renderer, mem_allocator *temp_allocator);
+world_stats world_get_stats(world *world);
+
+/** Cuts a whole level of `width` by `height` tiles into cells and writes them as a world file. Both sizes
+ * must be multiples of `cell_tiles`.
+ */
+void world_write_file(const char *path, const uint16_t *tiles, uint32_t width, uint32_t height,
+                      uint32_t cell_tiles, mem_allocator *temp_allocator);
+
+#endif
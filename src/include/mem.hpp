@@ -12,6 +12,7 @@ struct arena {
   uintptr_t cursor;
   uintptr_t size;
   void *ptr;
+  uintptr_t cleared_cursor;
 };
 
 struct free_list_alloc_header {
@@ -36,8 +37,12 @@ enum allocator_type {
   ALLOCATOR_TYPE_ARENA,
 };
 
+/** Free lists can be shared between threads, every allocation and free takes a short spinlock. Arenas are
+ * meant to be owned by a single thread and take no lock.
+ */
 struct mem_allocator {
   allocator_type type;
+  uint32_t lock;
   union {
     arena arena;
     free_list free_list;
@@ -51,7 +56,29 @@ void *allocator_alloc_impl(mem_allocator *allocator, uintptr_t size, uintptr_t a
 void allocator_dealloc(mem_allocator *allocator, void *data);
 void allocator_clear(mem_allocator *allocator);
 
+/** `last_cleared_bytes` is how far an arena got before its last clear, which for a per-frame arena is what
+ * the previous frame used. Free lists don't clear and leave it zero.
+ */
+struct mem_allocator_usage {
+  uintptr_t used_bytes;
+  uintptr_t size_bytes;
+  uintptr_t last_cleared_bytes;
+};
+mem_allocator_usage allocator_get_usage(mem_allocator *allocator);
+
+/** Grows or shrinks `data`, keeping the first `old_size` bytes. An arena extends the block in place when it
+ * is the last thing allocated, so a growing array at the cursor never copies. Otherwise the data moves to a
+ * new block and the old one is freed. A NULL `data` is a plain allocation. Running out of room is fatal, like
+ * it is for `allocator_alloc_impl`, both allocators assert on it.
+ */
+void *allocator_realloc_impl(mem_allocator *allocator, void *data, uintptr_t old_size, uintptr_t new_size,
+                             uintptr_t alignment);
+
 #define allocator_alloc(allocator, type, count)                                                              \
   (type *)allocator_alloc_impl((allocator), sizeof(type) * (count), alignof(type))
 
+#define allocator_realloc(allocator, type, data, old_count, new_count)                                       \
+  (type *)allocator_realloc_impl((allocator), (data), sizeof(type) * (old_count),                            \
+                                 sizeof(type) * (new_count), alignof(type))
+
 #endif
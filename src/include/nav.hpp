@@ -0,0 +1,138 @@
+#ifndef NAV_H
+#define NAV_H
+
+#include "containers.hpp"
+#include "mem.hpp"
+#include "platform.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+#define NAV_BLOCKED 255
+#define NAV_UNREACHABLE UINT32_MAX
+#define NAV_DIRECTION_NONE 8
+#define NAV_MAX_FIELDS 16
+// Directions are recomputed in tiles of this many cells a side, which is also the unit of parallel work.
+#define NAV_TILE_SIZE 64
+// Past this many cost changes waiting to be repaired into the cached fields they are rebuilt instead.
+#define NAV_MAX_PENDING_CHANGES 4096
+// Edges cost at most 254, so a circular bucket queue of this size never wraps onto itself.
+#define NAV_COST_BUCKETS 256
+
+// Indexed by a cell's direction: the four sides first, then the diagonals, then none.
+inline const glm::vec2 nav_direction_vectors[NAV_DIRECTION_NONE + 1] = {
+    {1.0f, 0.0f},
+    {0.0f, 1.0f},
+    {-1.0f, 0.0f},
+    {0.0f, -1.0f},
+    {0.7071068f, 0.7071068f},
+    {-0.7071068f, 0.7071068f},
+    {-0.7071068f, -0.7071068f},
+    {0.7071068f, -0.7071068f},
+    {0.0f, 0.0f},
+};
+
+/** The way to one goal from every cell of the grid. `integration` is the cost of the cheapest path to the
+ * goal and `directions` points at the neighbour that path continues through, so steering an agent is a
+ * single lookup no matter how many agents share the goal.
+ */
+struct nav_field {
+  uint32_t goal;
+  uint32_t *integration;
+  uint8_t *directions;
+  // how far into the grid's change log this field is repaired
+  uint32_t change_cursor;
+  // missed changes that were dropped from the log, rebuilt the next time it is asked for
+  bool stale;
+  uint64_t last_used;
+};
+
+struct nav_config {
+  uint32_t width;
+  uint32_t height;
+  float cell_size;
+  glm::vec2 origin;
+  uint32_t max_fields;
+};
+
+struct nav_stats {
+  uint32_t field_count;
+  uint32_t built_count;
+  uint32_t repaired_count;
+  // cells whose cost to the goal was recomputed by repairs, against width * height for a build
+  uint32_t repaired_cell_count;
+  uint32_t evicted_count;
+};
+
+struct nav_seed {
+  uint32_t cost;
+  uint32_t cell;
+};
+
+struct nav_direction_job {
+  struct nav_grid *grid;
+  nav_field *field;
+  uint32_t tile_y;
+};
+
+/** Grid navigation for crowds. Every cell has a traversal cost from 1 to 254, or is NAV_BLOCKED. Instead of
+ * a path per agent there is a flow field per goal, built with a bucket queue Dijkstra from the goal outward,
+ * so any number of agents heading to the same cell share one field. The last `max_fields` goals asked for
+ * are cached and the least recently used one makes room for a new goal.
+ *
+ * Cost changes are logged and repaired into a cached field the next time it is asked for: only the cells
+ * whose cheapest path ran through a changed cell are reset and integrated again from the cells around them,
+ * and directions are only recomputed for the tiles those cells touch. With a job pool the direction pass
+ * runs one row of tiles per job. Fields are only touched by `nav_get_field`, so call it from one thread.
+ */
+struct nav_grid {
+  nav_config config;
+  uint32_t tiles_x;
+  uint32_t tiles_y;
+  uint8_t *costs;
+  nav_field fields[NAV_MAX_FIELDS];
+  uint32_t field_count;
+  hash_map<uint32_t, uint32_t> field_lookup;
+  dyn_array<uint32_t> changes;
+  uint64_t use_counter;
+
+  // scratch shared by every field
+  dyn_array<uint32_t> buckets[NAV_COST_BUCKETS];
+  dyn_array<nav_seed> seeds;
+  dyn_array<uint32_t> reset_cells;
+  uint8_t *reset_marks;
+  uint8_t *dirty_tiles;
+  nav_direction_job *direction_jobs;
+  uint32_t direction_jobs_pending;
+
+  nav_stats stats;
+  platform_jobs *jobs;
+  mem_allocator *allocator;
+};
+
+// `jobs` may be NULL, directions are then computed on the calling thread.
+void nav_grid_init(nav_grid *grid, nav_config config, platform_jobs *jobs, mem_allocator *allocator);
+void nav_grid_destroy(nav_grid *grid);
+
+void nav_set_cost(nav_grid *grid, uint32_t x, uint32_t y, uint8_t cost);
+uint8_t nav_get_cost(nav_grid *grid, uint32_t x, uint32_t y);
+// Returns false for positions outside of the grid.
+bool nav_get_cell(nav_grid *grid, glm::vec2 pos, uint32_t *x, uint32_t *y);
+
+/** The field toward the goal cell, built, repaired or straight from the cache. The goal itself counts as
+ * reachable even when it is blocked. Ask for the field again every frame instead of
+ * keeping the pointer, changes are only repaired in here and another goal may take its place.
+ */
+nav_field *nav_get_field(nav_grid *grid, uint32_t goal_x, uint32_t goal_y);
+nav_stats nav_get_stats(nav_grid *grid);
+
+// The unit direction an agent at `pos` should move in, zero at the goal and where the goal can't be reached.
+inline glm::vec2 nav_get_direction(nav_grid *grid, nav_field *field, glm::vec2 pos) {
+  glm::vec2 cell = (pos - grid->config.origin) / grid->config.cell_size;
+  if (cell.x < 0.0f || cell.y < 0.0f || cell.x >= grid->config.width || cell.y >= grid->config.height) {
+    return glm::vec2(0.0f);
+  }
+  uint32_t index = (uint32_t)cell.y * grid->config.width + (uint32_t)cell.x;
+  return nav_direction_vectors[field->directions[index]];
+}
+
+#endif
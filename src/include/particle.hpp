@@ -0,0 +1,55 @@
+#ifndef PARTICLE_H
+#define PARTICLE_H
+
+#include "mem.hpp"
+#include "renderer.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+// Particles are simulated in groups of this many, capacities are rounded up to a multiple of it.
+#define PARTICLE_LANES 8
+
+/** Size and color are linear curves over a particle's normalized lifetime, going from their start value at
+ * birth to their end value at death. Colors are 0..255 like the render commands.
+ */
+struct particle_emitter_config {
+  uint32_t texture_id;
+  glm::vec3 pos;
+  float spawn_rate;
+  float lifetime_min;
+  float lifetime_max;
+  glm::vec2 velocity_min;
+  glm::vec2 velocity_max;
+  glm::vec2 acceleration;
+  float size_start;
+  float size_end;
+  glm::vec4 color_start;
+  glm::vec4 color_end;
+};
+
+/** Particle state is stored as separate arrays so the update runs PARTICLE_LANES particles at a time. Dead
+ * particles are swapped with the last live one, keeping the live ones packed at the front.
+ */
+struct particle_emitter {
+  particle_emitter_config config;
+  uint32_t capacity;
+  uint32_t count;
+  float spawn_accumulator;
+  uint32_t rng_state;
+
+  float *pos_x;
+  float *pos_y;
+  float *vel_x;
+  float *vel_y;
+  float *age;
+  float *inv_lifetime;
+};
+
+particle_emitter particle_emitter_init(uint32_t capacity, particle_emitter_config config,
+                                       mem_allocator *allocator);
+void particle_emitter_destroy(particle_emitter *emitter, mem_allocator *allocator);
+void particle_emitter_burst(particle_emitter *emitter, uint32_t count);
+void particle_emitter_update(particle_emitter *emitter, float dt);
+void particle_emitter_render(particle_emitter *emitter, struct renderer *renderer);
+
+#endif
@@ -6,14 +6,112 @@
 #include <stdalign.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 void platform_get_file_size(const char *path, size_t *size);
 void platform_read_entire_file(const char *path, size_t size, void *out);
+void platform_read_file_range(const char *path, size_t offset, size_t size, void *out);
 void platform_write_file(const char *path, size_t size, void *out);
+bool platform_file_exists(const char *path);
+void platform_create_directory(const char *path);
+void *platform_gl_get_proc_address(const char *name);
+
+enum platform_log_level {
+  PLATFORM_LOG_DEBUG,
+  PLATFORM_LOG_INFO,
+  PLATFORM_LOG_ERROR,
+};
+
+/** Logging only copies the format pointer and the raw arguments into a ring owned by the calling thread, a
+ * background thread does the formatting and writes in batches. The format must be a string literal, since
+ * it is read after the call returns. Literals from a shared library stay valid because unloading a library
+ * flushes the log first. Before `platform_log_init` and after `platform_log_shutdown` messages
+ * are written directly. Messages logged while a thread's ring is full are dropped and counted.
+ */
+void platform_log_init();
+void platform_log_shutdown();
+// Blocks until everything logged so far is written, use it before a fatal assert.
+void platform_log_flush();
+void platform_log_set_level(platform_log_level level);
+uint32_t platform_log_get_dropped();
 void platform_log_info(const char *msg, ...);
 void platform_log_debug(const char *msg, ...);
 void platform_log_error(const char *msg, ...);
 
+struct platform_thread {
+  uint64_t handle;
+};
+typedef void (*platform_thread_fn)(void *data);
+platform_thread platform_thread_create(platform_thread_fn fn, void *data);
+void platform_thread_join(platform_thread thread);
+void platform_sleep_ms(uint32_t ms);
+uint64_t platform_get_time_ns();
+uint32_t platform_get_cpu_count();
+
+#define PLATFORM_LIBRARY_PATH_SIZE 256
+
+/** Shared libraries are opened from a numbered copy so the original can be rebuilt while the copy is still
+ * mapped, and so every load gets a fresh mapping. `platform_library_load` on a loaded library opens the new
+ * copy first and only closes the old one once that worked, so a broken build leaves the old code running.
+ * Symbols fetched before a reload point into the closed copy and must be fetched again.
+ */
+struct platform_library {
+  void *handle;
+  char path[PLATFORM_LIBRARY_PATH_SIZE];
+  char live_path[PLATFORM_LIBRARY_PATH_SIZE];
+  int64_t modified_ns;
+  uint32_t generation;
+};
+bool platform_library_load(platform_library *library, const char *path);
+void platform_library_unload(platform_library *library);
+void *platform_library_get_symbol(platform_library *library, const char *name);
+// True once the file on disk differs from the one last loaded, or last tried to load.
+bool platform_library_changed(platform_library *library);
+
+#define PLATFORM_JOBS_CAPACITY 256
+#define PLATFORM_JOBS_MAX_WORKERS 16
+
+/** Jobs run on a fixed set of worker threads, each with its own scratch arena that is cleared after every
+ * job, so anything a job returns must go to a shared allocator. Jobs may push more jobs, and
+ * `platform_jobs_wait` returns once every job pushed so far, including those, has finished. Waiting from a
+ * job deadlocks.
+ */
+typedef void (*platform_job_fn)(void *data, mem_allocator *scratch);
+struct platform_jobs;
+platform_jobs *platform_jobs_create(uint32_t worker_count, uintptr_t scratch_size);
+void platform_jobs_destroy(platform_jobs *jobs);
+void platform_jobs_push(platform_jobs *jobs, platform_job_fn fn, void *data);
+void platform_jobs_wait(platform_jobs *jobs);
+
+/** Counted jobs also raise `counter` until they finished, so `platform_jobs_wait_counter` waits for just that
+ * group instead of everything on the pool. The counter starts at zero, is only touched under the pool's lock
+ * and must outlive the jobs.
+ */
+void platform_jobs_push_counted(platform_jobs *jobs, platform_job_fn fn, void *data, uint32_t *counter);
+void platform_jobs_wait_counter(platform_jobs *jobs, uint32_t *counter);
+// Jobs pushed and not finished yet, queued or running.
+uint32_t platform_jobs_get_pending_count(platform_jobs *jobs);
+
+#define PLATFORM_WATCH_MAX_DIRS 8
+#define PLATFORM_WATCH_MAX_CHANGES 64
+#define PLATFORM_WATCH_PATH_SIZE 256
+
+struct platform_file_change {
+  char path[PLATFORM_WATCH_PATH_SIZE];
+  uint64_t time_ns;
+};
+
+/** Watches directories, not recursively, on a background thread and collects the files written or moved into
+ * them. Paths are the directory as given joined with the file name, and a file changed several times before
+ * a poll shows up once with the time of its latest change. Polling when nothing changed is a single atomic
+ * load, so it can run every frame.
+ */
+struct platform_watcher;
+platform_watcher *platform_watcher_create(const char **dirs, uint32_t dir_count);
+void platform_watcher_destroy(platform_watcher *watcher);
+// Writes at most `max_out` changes and returns how many were written, the rest wait for the next poll.
+uint32_t platform_watcher_poll(platform_watcher *watcher, platform_file_change *out, uint32_t max_out);
+
 /** This is a high-level helper on top of the low-level platform functions. If you need tighter control on
  * memory, prefer the low level functions.
  */
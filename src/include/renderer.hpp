@@ -8,47 +8,275 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <stdint.h>
 
+/** `uv_rect` is the part of the texture to draw as min uv in xy and max uv in zw, with v pointing down the
+ * image. Leaving it zero draws the whole texture. `basis` rotates and scales the quad around `pos`, its
+ * columns are the quad's x and y axes. Leaving it zero keeps the quad axis aligned.
+ */
 struct render_cmd_quad {
   uint32_t texture_id;
   glm::vec3 pos;
   glm::vec2 size;
   glm::vec4 color;
+  glm::vec4 uv_rect;
+  glm::mat2 basis;
 };
 
+// Glyph textures hold coverage only. `uv_rect` works like the quad's, so glyphs can come from a shared page.
 struct render_cmd_glyph {
   uint32_t texture_id;
   glm::vec3 pos;
   glm::vec2 size;
   glm::vec4 color;
+  glm::vec4 uv_rect;
 };
 
+#define RENDERER_MAX_TEXTURES 4096
+#define RENDERER_DEFAULT_TEXTURE_BUDGET (256 * MB)
+#define RENDERER_MAX_UPLOADS 256
+#define RENDERER_UPLOAD_BUFFERS 3
+#define RENDERER_DEFAULT_UPLOAD_BUDGET (4 * MB)
+
+/** Returns the pixels of a texture again, in the same size and format it was first loaded with, allocated
+ * from `temp_allocator`. Returning NULL leaves the texture empty.
+ */
+typedef uint8_t *(*render_texture_reload_fn)(void *user, uint32_t index, mem_allocator *temp_allocator);
+
 struct render_cmd_delete_texture {
   uint32_t *texture_id;
 };
 
+/** The renderer tracks the GPU bytes of every texture and the last frame it was drawn in. Textures with a
+ * `reload` callback can drop their pixels once they are ready: when the texture budget is exceeded the least
+ * recently used of them are evicted from the GPU and reloaded through the callback the next time they are
+ * drawn, and they survive a lost context the same way. Textures without one are never evicted.
+ *
+ * Texture pixels are uploaded in the background, a few rows at a time under a per-frame byte budget, so
+ * `data` must stay alive until `renderer_is_texture_ready`. Until then the texture draws as the empty one.
+ * Mipmaps are only generated, and only sampled, when `mipmaps` is set.
+ */
 struct render_cmd_load_texture {
   uint32_t *texture_id;
   uint8_t *data;
   glm::vec2 size;
+  bool mipmaps;
+  render_texture_reload_fn reload;
+  void *reload_user;
+  uint32_t reload_index;
+};
+
+/** Uploads new pixels for the whole texture through the upload queue, the old ones stay visible until the new
+ * rows land. The pixels are not copied when the update is queued, only as their rows are uploaded, so `data`
+ * must stay alive and unchanged until the upload went through. `renderer_flush_uploads` forces that.
+ */
+struct render_cmd_update_texture {
+  uint32_t texture_id;
+  uint8_t *data;
+};
+
+/** Points a texture at another reload callback. Callbacks from a shared library must be set again after the
+ * library was reloaded, the old code is gone and the texture would call into it on its next reload.
+ */
+struct render_cmd_set_texture_reload {
+  uint32_t texture_id;
+  render_texture_reload_fn reload;
+  void *reload_user;
+  uint32_t reload_index;
 };
 
 struct render_cmd_load_glyph {
   uint32_t *texture_id;
   uint8_t *data;
   glm::vec2 size;
+  render_texture_reload_fn reload;
+  void *reload_user;
+  uint32_t reload_index;
+};
+
+struct render_texture_stats {
+  uint64_t budget_bytes;
+  uint64_t resident_bytes;
+  uint32_t resident_count;
+  uint32_t evicted_count;
+  uint32_t reloaded_count;
+};
+
+// Quads and glyphs are batched on the CPU and drawn together until the texture changes.
+#define RENDERER_MAX_BATCH_QUADS 1024
+#define RENDERER_MAX_MESHES 4096
+#define RENDERER_MAX_MESH_QUADS 4096
+
+/** Meshes are lists of quads, four vertices each, wound like the built-in quad: top right, bottom right,
+ * bottom left, top left. They share one index buffer, so a mesh holds at most RENDERER_MAX_MESH_QUADS.
+ */
+struct render_vertex {
+  glm::vec3 pos;
+  glm::vec2 uv;
+};
+
+struct render_cmd_load_mesh {
+  uint32_t *mesh_id;
+  render_vertex *vertices;
+  uint32_t quad_count;
+};
+
+struct render_cmd_mesh {
+  uint32_t mesh_id;
+  uint32_t texture_id;
+  glm::vec3 pos;
+  glm::vec4 color;
+};
+
+struct render_cmd_delete_mesh {
+  uint32_t *mesh_id;
+};
+
+/** Per-instance data for instanced quads. `pos_size` holds the center in xyz and the quad size in w, colors
+ * are normalized to 0..1 and multiply the texture.
+ */
+struct render_instance {
+  glm::vec4 pos_size;
+  glm::vec4 color;
+};
+
+struct render_cmd_instances {
+  uint32_t texture_id;
+  uint32_t count;
+};
+
+// Debug geometry is untextured, colors are normalized to 0..1.
+struct render_debug_vertex {
+  glm::vec3 pos;
+  glm::vec4 color;
+};
+
+// Two vertices per line and three per triangle.
+struct render_cmd_debug {
+  render_debug_vertex *line_vertices;
+  uint32_t line_vertex_count;
+  render_debug_vertex *triangle_vertices;
+  uint32_t triangle_vertex_count;
+};
+
+/** The scene is drawn into an offscreen target at `scale` times the window resolution and stretched over the
+ * window when the UI layer begins. The scale follows the GPU time of the scene pass: it drops when the scene
+ * takes longer than `target_frame_ms` and creeps back up when there is headroom, staying between `min_scale`
+ * and `max_scale`. Setting both to the same value fixes the scale.
+ */
+struct render_resolution_config {
+  float target_frame_ms;
+  float min_scale;
+  float max_scale;
+};
+
+#define RENDERER_DEFAULT_TARGET_FRAME_MS 14.0f
+#define RENDERER_DEFAULT_MIN_SCALE 0.5f
+#define RENDERER_TIMER_QUERIES 4
+
+/** GL calls that went to the driver versus the ones skipped because the state was already set, along with the
+ * texture binds and draw calls among them, counted over the last full frame.
+ */
+struct render_state_stats {
+  uint32_t issued_count;
+  uint32_t elided_count;
+  uint32_t texture_bind_count;
+  uint32_t draw_call_count;
+};
+
+#define RENDERER_CAPTURE_BUFFERS 3
+
+// A frame read back from the window, RGBA with the top row first.
+struct render_capture {
+  uint8_t *pixels;
+  uint32_t width;
+  uint32_t height;
+  uint64_t frame_index;
 };
 
 struct renderer;
 struct renderer renderer_init(int framebuffer_width, int framebuffer_height, mem_allocator *temp_allocator);
 void renderer_destroy(struct renderer *renderer);
 
+void renderer_resize(struct renderer *renderer, int framebuffer_width, int framebuffer_height);
+
+/** Draws what would go to the window into an offscreen target of the same size instead, and captures read
+ * from there. The pixels of a hidden or covered window are undefined, so runs that compare captures use this.
+ * Nothing reaches the window while it is set.
+ */
+void renderer_set_offscreen(struct renderer *renderer, bool offscreen);
 void renderer_begin_frame(struct renderer *renderer);
+
+/** Ends the scene pass and upscales it to the window. Everything drawn after this lands at native resolution
+ * in screen space, ignoring the camera. `renderer_end_frame` begins the layer itself if nothing did.
+ */
+void renderer_begin_ui_layer(struct renderer *renderer);
+void renderer_end_frame(struct renderer *renderer);
+void renderer_set_resolution_config(struct renderer *renderer, render_resolution_config config);
+float renderer_get_render_scale(struct renderer *renderer);
+float renderer_get_scene_gpu_ms(struct renderer *renderer);
+uint32_t renderer_get_draw_call_count(struct renderer *renderer);
+render_state_stats renderer_get_state_stats(struct renderer *renderer);
 void renderer_render_clear(struct renderer *renderer, glm::vec4 clear);
 void renderer_render_quad(struct renderer *renderer, render_cmd_quad quad);
 void renderer_render_glyph(struct renderer *renderer, render_cmd_glyph glyph);
 void renderer_delete_texture(struct renderer *renderer, render_cmd_delete_texture delete_texture);
 void renderer_load_texture(struct renderer *renderer, render_cmd_load_texture load_texture);
+void renderer_update_texture(struct renderer *renderer, render_cmd_update_texture update_texture);
+void renderer_set_texture_reload(struct renderer *renderer, render_cmd_set_texture_reload set_reload);
 void renderer_load_glyph(struct renderer *renderer, render_cmd_load_glyph load_glyph);
+void renderer_load_mesh(struct renderer *renderer, render_cmd_load_mesh load_mesh);
+void renderer_render_mesh(struct renderer *renderer, render_cmd_mesh mesh);
+void renderer_delete_mesh(struct renderer *renderer, render_cmd_delete_mesh delete_mesh);
+// True for a mesh whose vertices went with a lost context, loading it again under the same id restores it.
+bool renderer_is_mesh_lost(struct renderer *renderer, uint32_t mesh_id);
+
+/** Maps GPU storage for `count` instances that must be filled before the matching
+ * `renderer_render_instances` call, which unmaps it and draws every instance in one call.
+ */
+render_instance *renderer_map_instances(struct renderer *renderer, uint32_t count);
+void renderer_render_instances(struct renderer *renderer, render_cmd_instances instances);
+
+/** Draws every triangle and then every line in one call each, on top of what was drawn so far in the
+ * current layer. The vertices are copied before this returns.
+ */
+void renderer_render_debug(struct renderer *renderer, render_cmd_debug debug);
+bool renderer_is_texture_ready(struct renderer *renderer, uint32_t texture_id);
+// Texture uploads queued and not fully on the GPU yet.
+uint32_t renderer_get_pending_upload_count(struct renderer *renderer);
+void renderer_set_upload_budget(struct renderer *renderer, uint64_t budget_bytes);
+// Blocks until every queued texture upload is done, for loading screens where a stall doesn't matter.
+void renderer_flush_uploads(struct renderer *renderer);
+void renderer_set_texture_budget(struct renderer *renderer, uint64_t budget_bytes);
+render_texture_stats renderer_get_texture_stats(struct renderer *renderer);
+
+// True once the driver reset the context. Only reported when the context was created with robust access.
+bool renderer_is_context_lost(struct renderer *renderer);
+
+/** Recreates every program, buffer, vertex array, the scene target and the queries on the current context,
+ * after the lost one was replaced. Texture and mesh ids stay valid. Textures with a reload callback come back
+ * the next time they are drawn, the rest draw as the empty texture until they are loaded again. Meshes draw
+ * nothing until they are loaded again, see `renderer_is_mesh_lost`.
+ */
+void renderer_handle_context_lost(struct renderer *renderer);
+
+/** Rebuilds every program that uses the shader at `path`, call it between frames. Returns false when no
+ * program uses it or the new version didn't build, in which case the old program keeps running.
+ */
+bool renderer_reload_shader(struct renderer *renderer, const char *path);
+
+/** Copies the finished window into a pixel buffer on the GPU, call it after `renderer_end_frame` and
+ * before the swap. Nothing waits for the copy, it is fenced and read with `renderer_read_capture` a few
+ * frames later. Returns false and drops the frame when every one of the RENDERER_CAPTURE_BUFFERS still
+ * holds a frame nobody has read.
+ */
+bool renderer_capture_frame(struct renderer *renderer);
+
+/** Hands out the oldest captured frame, copied into memory from `allocator` that the caller frees. Returns
+ * false when no capture is pending, or when the oldest one isn't done on the GPU yet unless `wait` is set.
+ */
+bool renderer_read_capture(struct renderer *renderer, mem_allocator *allocator, bool wait,
+                           render_capture *capture);
+
 void renderer_move_camera(struct renderer *renderer, glm::vec2 delta);
+void renderer_get_view_bounds(struct renderer *renderer, glm::vec2 *min, glm::vec2 *max);
 
 #endif
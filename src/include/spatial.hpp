@@ -0,0 +1,58 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "mem.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+#define SPATIAL_NULL UINT32_MAX
+
+struct spatial_aabb {
+  glm::vec2 min;
+  glm::vec2 max;
+};
+
+struct spatial_pair {
+  uint32_t a;
+  uint32_t b;
+};
+
+/** Uniform grid stored as a spatial hash. Every object is linked into the single bucket of the cell that
+ * contains its center, so moving an object is an O(1) unlink/link and the grid never allocates after init.
+ * Queries widen their range by one cell to catch objects that overlap in from neighbouring cells. Objects
+ * more than a cell in half extent go into one oversized list instead, which every query walks in full, so
+ * pick a cell size around the size of a typical object or a bit more and keep that list short.
+ */
+struct spatial_grid {
+  float cell_size;
+  float inv_cell_size;
+  uint32_t bucket_mask;
+  // one more than the mask covers, the last is the oversized list
+  uint32_t *buckets;
+
+  uint32_t capacity;
+  uint32_t count;
+  uint32_t free_head;
+  spatial_aabb *bounds;
+  uint32_t *next;
+  uint32_t *prev;
+  uint32_t *bucket;
+  uint32_t *stamp;
+  uint32_t query_stamp;
+};
+
+spatial_grid spatial_grid_init(uint32_t capacity, float cell_size, mem_allocator *allocator);
+void spatial_grid_destroy(spatial_grid *grid, mem_allocator *allocator);
+void spatial_grid_clear(spatial_grid *grid);
+
+uint32_t spatial_grid_insert(spatial_grid *grid, spatial_aabb aabb);
+void spatial_grid_update(spatial_grid *grid, uint32_t id, spatial_aabb aabb);
+void spatial_grid_remove(spatial_grid *grid, uint32_t id);
+
+// All queries write at most `max_out` results and return how many were written.
+uint32_t spatial_grid_query_aabb(spatial_grid *grid, spatial_aabb aabb, uint32_t *out, uint32_t max_out);
+uint32_t spatial_grid_query_radius(spatial_grid *grid, glm::vec2 center, float radius, uint32_t *out,
+                                   uint32_t max_out);
+uint32_t spatial_grid_query_pairs(spatial_grid *grid, spatial_pair *out, uint32_t max_out);
+
+#endif
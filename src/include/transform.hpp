@@ -0,0 +1,72 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include "mem.hpp"
+#include <glm/glm.hpp>
+#include <stdint.h>
+
+#define TRANSFORM_NULL UINT32_MAX
+
+/** 2D affine matrix as its two meaningful rows: x' = a*x + b*y + tx, y' = c*x + d*y + ty. The fourth lane of
+ * each row is padding so a row fits one SSE register.
+ */
+struct transform_affine {
+  alignas(16) float rows[2][4];
+};
+
+struct transform_local {
+  glm::vec3 pos;
+  float rotation;
+  glm::vec2 scale;
+};
+
+/** Transforms live in flat arrays where every parent sits before its children, so one forward pass computes
+ * world matrices without recursion. Only nodes whose local transform changed, and their descendants, are
+ * recomputed, and the pass starts at the first dirty node, so a hierarchy where nothing moved costs nothing.
+ * World depth is the parent's depth plus the local one and doesn't rotate.
+ *
+ * Ids are stable handles, indices move when a subtree is destroyed or reparented under a later node.
+ */
+struct transform_hierarchy {
+  uint32_t capacity;
+  uint32_t count;
+  uint32_t first_dirty;
+  uint32_t updated_count;
+
+  // by index
+  uint32_t *parent;
+  uint32_t *index_to_id;
+  transform_local *local;
+  transform_affine *world;
+  float *world_z;
+  uint8_t *dirty;
+
+  // by id, free ids link through `id_to_index`
+  uint32_t *id_to_index;
+  uint32_t free_head;
+
+  // scratch for reordering
+  uint32_t *order;
+  uint32_t *remap;
+  void *scratch;
+};
+
+transform_hierarchy transform_hierarchy_init(uint32_t capacity, mem_allocator *allocator);
+void transform_hierarchy_destroy(transform_hierarchy *hierarchy, mem_allocator *allocator);
+
+// Pass TRANSFORM_NULL as the parent for a root. New transforms start at the origin with a scale of one.
+uint32_t transform_create(transform_hierarchy *hierarchy, uint32_t parent_id);
+// Destroys the transform and all of its descendants.
+void transform_destroy(transform_hierarchy *hierarchy, uint32_t id);
+void transform_set_parent(transform_hierarchy *hierarchy, uint32_t id, uint32_t parent_id);
+void transform_set_local(transform_hierarchy *hierarchy, uint32_t id, transform_local local);
+transform_local transform_get_local(transform_hierarchy *hierarchy, uint32_t id);
+
+void transform_update(transform_hierarchy *hierarchy);
+
+// World results are only valid after `transform_update`.
+glm::vec3 transform_get_world_pos(transform_hierarchy *hierarchy, uint32_t id);
+// Columns are the transform's x and y axes in world space, ready for `render_cmd_quad::basis`.
+glm::mat2 transform_get_world_basis(transform_hierarchy *hierarchy, uint32_t id);
+
+#endif
@@ -1,9 +1,23 @@
-#include "game.cpp"
+#include "atlas.cpp"
+#include "audio.cpp"
+#include "capture.cpp"
+#include "containers.cpp"
+#include "debug_draw.cpp"
+#include "game.hpp"
 #include "game/asset.cpp"
+#include "game/asset_registry.cpp"
+#include "game/perf_hud.cpp"
+#include "game/task.cpp"
 #include "game/text.cpp"
+#include "game/tilemap.cpp"
+#include "game/world.cpp"
 #include "mem.cpp"
+#include "nav.cpp"
+#include "particle.cpp"
 #include "platform_linux.cpp"
 #include "renderer_gl.cpp"
+#include "spatial.cpp"
+#include "transform.cpp"
 #include <SDL2/SDL.h>
 #include <signal.h>
 
@@ -13,9 +27,85 @@ void parse_sdl_event(SDL_Window *window, SDL_Event *event, game_input *input, re
 static volatile bool sigterm_received = false;
 static void sigterm_handler(int sig) { sigterm_received = true; }
 
-int main() {
+// every worker holds one and only asset jobs load whole files into it, the largest is a font under 1 MB
+#define JOB_SCRATCH_SIZE (4 * MB)
+#define GAME_LIBRARY_PATH "build/libgame.so"
+#define GAME_RELOAD_CHECK_MS 250
+#define MAX_FILE_CHANGES_PER_FRAME 16
+#define GOLDEN_FRAME_DT (1.0 / 60.0)
+
+struct game_api {
+  game_load_fn load;
+  game_init_fn init;
+  game_update_fn update;
+  game_deinit_fn deinit;
+  game_file_changed_fn file_changed;
+};
+
+static bool load_game_api(platform_library *library, game_api *api) {
+  if (!platform_library_load(library, GAME_LIBRARY_PATH)) {
+    return false;
+  }
+  *api = (game_api){
+      .load = (game_load_fn)platform_library_get_symbol(library, "game_load"),
+      .init = (game_init_fn)platform_library_get_symbol(library, "game_init"),
+      .update = (game_update_fn)platform_library_get_symbol(library, "game_update"),
+      .deinit = (game_deinit_fn)platform_library_get_symbol(library, "game_deinit"),
+      .file_changed = (game_file_changed_fn)platform_library_get_symbol(library, "game_file_changed"),
+  };
+  assert(api->load != NULL && api->init != NULL && api->update != NULL && api->deinit != NULL &&
+         api->file_changed != NULL);
+  return true;
+}
+
+static void audio_init_job(void *data, mem_allocator *scratch) {
+  audio_init((audio_player *)data, AUDIO_MAX_VOICES);
+}
+
+/** `--record DIR` writes every frame into DIR. `--golden PATH FRAME` runs in a hidden window with a fixed
+ * timestep, full resolution and an offscreen target, compares frame FRAME after streaming settled against
+ * the image at PATH and exits with 0 when they match.
+ */
+static capture_config parse_capture_args(int argc, char **argv) {
+  capture_config config = {};
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      config.record_dir = argv[++i];
+    } else if (strcmp(argv[i], "--golden") == 0 && i + 2 < argc) {
+      config.golden_path = argv[++i];
+      config.golden_frame = (uint32_t)atoi(argv[++i]);
+    }
+  }
+  return config;
+}
+
+int main(int argc, char **argv) {
+  uint64_t startup_start = platform_get_time_ns();
+  capture_config capture_args = parse_capture_args(argc, argv);
+  bool golden_run = capture_args.golden_path != NULL;
   signal(SIGTERM, sigterm_handler);
   signal(SIGINT, sigterm_handler);
+  platform_log_init();
+
+  // audio and asset decoding don't need the window, so they run while SDL and GL are being set up
+  uint32_t worker_count = glm::clamp(platform_get_cpu_count() - 1, 1u, (uint32_t)PLATFORM_JOBS_MAX_WORKERS);
+  platform_jobs *jobs = platform_jobs_create(worker_count, JOB_SCRATCH_SIZE);
+
+  game_memory game_memory = {.game_state = malloc(1 * GB),
+                             .temp_allocator = allocator_arena_init(250 * MB),
+                             .allocator = allocator_free_list_init(250 * MB)};
+  assert(game_memory.game_state != NULL);
+
+  platform_library game_library = {};
+  game_api game = {};
+  if (!load_game_api(&game_library, &game)) {
+    platform_log_shutdown();
+    return -1;
+  }
+
+  audio_player audio_player;
+  platform_jobs_push(jobs, audio_init_job, &audio_player);
+  game.load(&game_memory, jobs);
 
   if (SDL_Init(SDL_INIT_VIDEO) < 0) {
     SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "[PLATFORM]: %s", SDL_GetError());
@@ -26,8 +116,11 @@ int main() {
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+  // a driver reset then shows up as a lost context the renderer can rebuild on, instead of undefined behavior
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_ROBUST_ACCESS_FLAG);
+  SDL_GL_SetAttribute(SDL_GL_CONTEXT_RESET_NOTIFICATION, SDL_GL_CONTEXT_RESET_LOSE_CONTEXT);
   SDL_Window *window = SDL_CreateWindow("hayal", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, 1920, 1080,
-                                        SDL_WINDOW_OPENGL);
+                                        SDL_WINDOW_OPENGL | (golden_run ? SDL_WINDOW_HIDDEN : 0));
   if (!window) {
     SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "[PLATFORM]: %s", SDL_GetError());
     return -1;
@@ -41,29 +134,43 @@ int main() {
     SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "[PLATFORM]: Failed to load OpenGL context");
     return -1;
   }
-  if (SDL_GL_SetSwapInterval(1) < 0) {
+  // golden runs go as fast as they can
+  if (SDL_GL_SetSwapInterval(golden_run ? 0 : 1) < 0) {
     SDL_LogWarn(SDL_LOG_CATEGORY_VIDEO, "[PLATFORM] Unable to enable VSYNC: %s", SDL_GetError());
   }
 
-  game_memory game_memory = {.game_state = malloc(1 * GB),
-                             .temp_allocator = allocator_arena_init(250 * MB),
-                             .allocator = allocator_free_list_init(250 * MB)};
-  assert(game_memory.game_state != NULL);
-
   const uint64_t perf_frequency = SDL_GetPerformanceFrequency();
   uint64_t last_perf_counter = SDL_GetPerformanceCounter();
 
   renderer renderer = renderer_init(1920, 1080, &game_memory.temp_allocator);
-  ma_engine audio_player;
-  ma_engine_init(NULL, &audio_player);
+  // a hidden window's pixels are undefined and a scale that follows the GPU time differs from run to run
+  if (golden_run) {
+    renderer_set_offscreen(&renderer, true);
+    renderer_set_resolution_config(&renderer, (render_resolution_config){
+                                                  .target_frame_ms = RENDERER_DEFAULT_TARGET_FRAME_MS,
+                                                  .min_scale = 1.0f,
+                                                  .max_scale = 1.0f,
+                                              });
+  }
+
+  // only the GL uploads are left for the context thread
+  platform_jobs_wait(jobs);
+  game.init(&game_memory, &renderer, &audio_player);
 
-  game_init(&game_memory, &renderer, &audio_player);
+  const char *watched_dirs[] = {"assets", "shaders"};
+  platform_watcher *watcher = platform_watcher_create(watched_dirs, 2);
+  frame_capture capture;
+  capture_init(&capture, capture_args, jobs, &game_memory.allocator);
 
   bool should_quit = false;
+  uint64_t last_reload_check = platform_get_time_ns();
   game_input input = {0};
   while (!should_quit && !sigterm_received) {
     uint64_t start_counter = SDL_GetPerformanceCounter();
     double dt = (double)(start_counter - last_perf_counter) / (double)perf_frequency;
+    if (golden_run) {
+      dt = GOLDEN_FRAME_DT;
+    }
     last_perf_counter = start_counter;
 
     game_reset_input(&input);
@@ -72,14 +179,80 @@ int main() {
       parse_sdl_event(window, &event, &input, &renderer, &should_quit);
     }
 
-    game_update(&input, dt, &game_memory, &renderer, &audio_player);
+    // the game state and every GPU resource live out here, so a rebuilt game picks up where the old one was
+    if (platform_get_time_ns() - last_reload_check > GAME_RELOAD_CHECK_MS * 1000000ull) {
+      last_reload_check = platform_get_time_ns();
+      if (platform_library_changed(&game_library)) {
+        uint64_t reload_start = platform_get_time_ns();
+        // jobs the game pushed may run its code, so none can be left when the library goes
+        platform_jobs_wait(jobs);
+        if (load_game_api(&game_library, &game)) {
+          platform_log_info("Reloaded %s in %.2fms", GAME_LIBRARY_PATH,
+                            (platform_get_time_ns() - reload_start) / 1e6);
+        }
+      }
+    }
+
+    platform_file_change changes[MAX_FILE_CHANGES_PER_FRAME];
+    uint32_t change_count = platform_watcher_poll(watcher, changes, MAX_FILE_CHANGES_PER_FRAME);
+    for (uint32_t i = 0; i < change_count; i++) {
+      if (strncmp(changes[i].path, "shaders/", 8) == 0) {
+        if (renderer_reload_shader(&renderer, changes[i].path)) {
+          platform_log_info("Reloaded %s in %.2fms", changes[i].path,
+                            (platform_get_time_ns() - changes[i].time_ns) / 1e6);
+        }
+      } else {
+        game.file_changed(&game_memory, changes[i].path, changes[i].time_ns);
+      }
+    }
+
+    game.update(&input, dt, &game_memory, &renderer, &audio_player);
+    renderer_end_frame(&renderer);
+    capture_end_frame(&capture, &renderer);
     SDL_GL_SwapWindow(window);
+    if (renderer_is_context_lost(&renderer)) {
+      platform_log_error("GL context lost, creating a new one");
+      SDL_GL_DeleteContext(gl_context);
+      gl_context = SDL_GL_CreateContext(window);
+      if (!gl_context || gladLoadGLLoader(SDL_GL_GetProcAddress) != 1) {
+        SDL_LogCritical(SDL_LOG_CATEGORY_ERROR, "[PLATFORM]: %s", SDL_GetError());
+        break;
+      }
+      SDL_GL_SetSwapInterval(golden_run ? 0 : 1);
+      renderer_handle_context_lost(&renderer);
+      capture_handle_context_lost(&capture);
+    }
+    if (startup_start != 0) {
+      platform_log_info("Time to first frame: %.2fms", (platform_get_time_ns() - startup_start) / 1e6);
+      startup_start = 0;
+    }
 
     allocator_clear(&game_memory.temp_allocator);
+    if (golden_run && capture_get_golden_result(&capture).state != CAPTURE_GOLDEN_PENDING) {
+      should_quit = true;
+    }
   }
 
-  game_deinit(&game_memory, &renderer);
-  ma_engine_uninit(&audio_player);
+  int exit_code = 0;
+  if (golden_run) {
+    capture_golden_result golden = capture_get_golden_result(&capture);
+    if (golden.state == CAPTURE_GOLDEN_PASSED) {
+      platform_log_info("Golden frame matched %s", capture_args.golden_path);
+    } else {
+      platform_log_error("Golden frame differs from %s: %u pixels, by up to %u", capture_args.golden_path,
+                         golden.mismatch_count, golden.max_difference);
+      exit_code = 1;
+    }
+  }
+  capture_destroy(&capture, &renderer);
+
+  // stop the audio device first so no voice is still reading sounds the game frees
+  audio_destroy(&audio_player);
+  platform_watcher_destroy(watcher);
+  // the game waits for its loads still in flight, so the pool goes after it
+  game.deinit(&game_memory, &renderer);
+  platform_jobs_destroy(jobs);
+  platform_library_unload(&game_library);
   renderer_destroy(&renderer);
   allocator_destroy(&game_memory.allocator);
   allocator_destroy(&game_memory.temp_allocator);
@@ -89,7 +262,8 @@ int main() {
   SDL_GL_DeleteContext(gl_context);
   SDL_Quit();
 
-  return 0;
+  platform_log_shutdown();
+  return exit_code;
 }
 
 typedef struct {
@@ -213,9 +387,9 @@ void parse_sdl_event(SDL_Window *window, SDL_Event *event, game_input *input, re
   case SDL_WINDOWEVENT:
     if (event->window.event == SDL_WINDOWEVENT_SIZE_CHANGED ||
         event->window.event == SDL_WINDOWEVENT_RESIZED) {
-      SDL_GL_GetDrawableSize(window, (int *)&renderer->framebuffer_size.x,
-                             (int *)&renderer->framebuffer_size.y);
-      glViewport(0, 0, (int)renderer->framebuffer_size.x, (int)renderer->framebuffer_size.y);
+      int drawable_width, drawable_height;
+      SDL_GL_GetDrawableSize(window, &drawable_width, &drawable_height);
+      renderer_resize(renderer, drawable_width, drawable_height);
       break;
 
     case SDL_KEYDOWN:
@@ -1,6 +1,7 @@
 #include "mem.hpp"
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/types.h>
 
 static arena arena_init(uintptr_t size) {
@@ -25,7 +26,19 @@ static void *arena_alloc(arena *arena, uintptr_t size, uintptr_t alignment) {
   return start_of_block;
 }
 
-static void arena_clear(arena *arena) { arena->cursor = 0; }
+static bool arena_extend(arena *arena, void *data, uintptr_t old_size, uintptr_t new_size) {
+  uintptr_t offset = (uintptr_t)data - (uintptr_t)arena->ptr;
+  if (offset + old_size != arena->cursor || offset + new_size > arena->size) {
+    return false;
+  }
+  arena->cursor = offset + new_size;
+  return true;
+}
+
+static void arena_clear(arena *arena) {
+  arena->cleared_cursor = arena->cursor;
+  arena->cursor = 0;
+}
 
 static void arena_free(arena *arena) { free(arena->ptr); };
 
@@ -100,7 +113,12 @@ static void *free_list_alloc(free_list *fl, uintptr_t size, uintptr_t alignment)
   size_t total_padding =
       calculate_required_padding((uintptr_t)node, alignment, sizeof(free_list_alloc_header));
   size_t alignment_padding = total_padding - sizeof(free_list_alloc_header);
-  size_t total_required_space = size + total_padding;
+  // rounded so the leftover node stays aligned, and a leftover too small for a node goes with the allocation
+  size_t total_required_space =
+      (size + total_padding + alignof(free_list_node) - 1) & ~(alignof(free_list_node) - 1);
+  if (total_required_space + sizeof(free_list_node) > node->block_size) {
+    total_required_space = node->block_size;
+  }
 
   // split the block if there's leftover space worth keeping
   size_t remaining_space = node->block_size - total_required_space;
@@ -168,6 +186,18 @@ static void free_list_free(free_list *fl) {
   free(fl->data);
 }
 
+static void allocator_lock(mem_allocator *allocator) {
+  while (__atomic_exchange_n(&allocator->lock, 1, __ATOMIC_ACQUIRE) != 0) {
+    while (__atomic_load_n(&allocator->lock, __ATOMIC_RELAXED) != 0) {
+      __builtin_ia32_pause();
+    }
+  }
+}
+
+static void allocator_unlock(mem_allocator *allocator) {
+  __atomic_store_n(&allocator->lock, 0, __ATOMIC_RELEASE);
+}
+
 mem_allocator allocator_arena_init(uintptr_t size) {
   mem_allocator alloc = {
       .type = ALLOCATOR_TYPE_ARENA,
@@ -199,8 +229,12 @@ void *allocator_alloc_impl(mem_allocator *allocator, uintptr_t size, uintptr_t a
   switch (allocator->type) {
   case ALLOCATOR_TYPE_ARENA:
     return arena_alloc(&allocator->arena, size, alignment);
-  case ALLOCATOR_TYPE_FREE_LIST:
-    return free_list_alloc(&allocator->free_list, size, alignment);
+  case ALLOCATOR_TYPE_FREE_LIST: {
+    allocator_lock(allocator);
+    void *data = free_list_alloc(&allocator->free_list, size, alignment);
+    allocator_unlock(allocator);
+    return data;
+  }
   }
   return NULL;
 }
@@ -210,7 +244,9 @@ void allocator_dealloc(mem_allocator *allocator, void *data) {
   case ALLOCATOR_TYPE_ARENA:
     break;
   case ALLOCATOR_TYPE_FREE_LIST:
+    allocator_lock(allocator);
     free_list_dealloc(&allocator->free_list, data);
+    allocator_unlock(allocator);
   }
 }
 
@@ -223,3 +259,39 @@ void allocator_clear(mem_allocator *allocator) {
     break;
   }
 }
+
+mem_allocator_usage allocator_get_usage(mem_allocator *allocator) {
+  switch (allocator->type) {
+  case ALLOCATOR_TYPE_ARENA:
+    return (mem_allocator_usage){
+        .used_bytes = allocator->arena.cursor,
+        .size_bytes = allocator->arena.size,
+        .last_cleared_bytes = allocator->arena.cleared_cursor,
+    };
+  case ALLOCATOR_TYPE_FREE_LIST:
+    // other threads may be allocating, a slightly stale count is fine for stats
+    return (mem_allocator_usage){
+        .used_bytes = __atomic_load_n(&allocator->free_list.used, __ATOMIC_RELAXED),
+        .size_bytes = allocator->free_list.size,
+        .last_cleared_bytes = 0,
+    };
+  }
+  return (mem_allocator_usage){};
+}
+
+void *allocator_realloc_impl(mem_allocator *allocator, void *data, uintptr_t old_size, uintptr_t new_size,
+                             uintptr_t alignment) {
+  if (data == NULL) {
+    return allocator_alloc_impl(allocator, new_size, alignment);
+  }
+  if (allocator->type == ALLOCATOR_TYPE_ARENA && arena_extend(&allocator->arena, data, old_size, new_size)) {
+    return data;
+  }
+  void *moved = allocator_alloc_impl(allocator, new_size, alignment);
+  if (moved == NULL) {
+    return NULL;
+  }
+  memcpy(moved, data, old_size < new_size ? old_size : new_size);
+  allocator_dealloc(allocator, data);
+  return moved;
+}
@@ -0,0 +1,487 @@
+#include "nav.hpp"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Matches the order of `nav_direction_vectors`.
+static const int32_t direction_offsets[NAV_DIRECTION_NONE][2] = {
+    {1, 0}, {0, 1}, {-1, 0}, {0, -1}, {1, 1}, {-1, 1}, {-1, -1}, {1, -1},
+};
+
+void nav_grid_init(nav_grid *grid, nav_config config, platform_jobs *jobs, mem_allocator *allocator) {
+  assert(config.width > 0 && config.height > 0 && config.cell_size > 0.0f);
+  assert(config.max_fields > 0 && config.max_fields <= NAV_MAX_FIELDS);
+  // the costliest possible path still has to fit in the integration field
+  assert((uint64_t)config.width * config.height * (NAV_BLOCKED - 1) < NAV_UNREACHABLE);
+  *grid = {};
+  grid->config = config;
+  grid->tiles_x = (config.width + NAV_TILE_SIZE - 1) / NAV_TILE_SIZE;
+  grid->tiles_y = (config.height + NAV_TILE_SIZE - 1) / NAV_TILE_SIZE;
+  uint32_t cell_count = config.width * config.height;
+  grid->costs = allocator_alloc(allocator, uint8_t, cell_count);
+  assert(grid->costs != NULL);
+  memset(grid->costs, 1, cell_count);
+  grid->field_lookup = hash_map_init<uint32_t, uint32_t>(allocator, config.max_fields);
+  grid->changes = dyn_array_init<uint32_t>(allocator, 0);
+
+  for (uint32_t i = 0; i < NAV_COST_BUCKETS; i++) {
+    grid->buckets[i] = dyn_array_init<uint32_t>(allocator, 0);
+  }
+  grid->seeds = dyn_array_init<nav_seed>(allocator, 0);
+  grid->reset_cells = dyn_array_init<uint32_t>(allocator, 0);
+  grid->reset_marks = allocator_alloc(allocator, uint8_t, cell_count);
+  grid->dirty_tiles = allocator_alloc(allocator, uint8_t, grid->tiles_x * grid->tiles_y);
+  grid->direction_jobs = allocator_alloc(allocator, nav_direction_job, grid->tiles_y);
+  assert(grid->reset_marks != NULL && grid->dirty_tiles != NULL && grid->direction_jobs != NULL);
+  memset(grid->reset_marks, 0, cell_count);
+
+  grid->jobs = jobs;
+  grid->allocator = allocator;
+}
+
+void nav_grid_destroy(nav_grid *grid) {
+  mem_allocator *allocator = grid->allocator;
+  for (uint32_t i = 0; i < grid->field_count; i++) {
+    allocator_dealloc(allocator, grid->fields[i].integration);
+    allocator_dealloc(allocator, grid->fields[i].directions);
+  }
+  for (uint32_t i = 0; i < NAV_COST_BUCKETS; i++) {
+    dyn_array_destroy(&grid->buckets[i]);
+  }
+  dyn_array_destroy(&grid->seeds);
+  dyn_array_destroy(&grid->reset_cells);
+  allocator_dealloc(allocator, grid->reset_marks);
+  allocator_dealloc(allocator, grid->dirty_tiles);
+  allocator_dealloc(allocator, grid->direction_jobs);
+  dyn_array_destroy(&grid->changes);
+  hash_map_destroy(&grid->field_lookup);
+  allocator_dealloc(allocator, grid->costs);
+  *grid = {};
+}
+
+void nav_set_cost(nav_grid *grid, uint32_t x, uint32_t y, uint8_t cost) {
+  assert(x < grid->config.width && y < grid->config.height && cost > 0);
+  uint32_t cell = y * grid->config.width + x;
+  if (grid->costs[cell] == cost) {
+    return;
+  }
+  grid->costs[cell] = cost;
+  if (grid->field_count == 0) {
+    return;
+  }
+  if (grid->changes.count == NAV_MAX_PENDING_CHANGES) {
+    // repairing this many changes would cost about as much as building the fields again
+    for (uint32_t i = 0; i < grid->field_count; i++) {
+      grid->fields[i].stale = true;
+      grid->fields[i].change_cursor = 0;
+    }
+    dyn_array_clear(&grid->changes);
+  }
+  dyn_array_push(&grid->changes, cell);
+}
+
+uint8_t nav_get_cost(nav_grid *grid, uint32_t x, uint32_t y) {
+  assert(x < grid->config.width && y < grid->config.height);
+  return grid->costs[y * grid->config.width + x];
+}
+
+bool nav_get_cell(nav_grid *grid, glm::vec2 pos, uint32_t *x, uint32_t *y) {
+  glm::vec2 cell = glm::floor((pos - grid->config.origin) / grid->config.cell_size);
+  if (cell.x < 0.0f || cell.y < 0.0f || cell.x >= grid->config.width || cell.y >= grid->config.height) {
+    return false;
+  }
+  *x = (uint32_t)cell.x;
+  *y = (uint32_t)cell.y;
+  return true;
+}
+
+// A cell's cost to the goal decides the directions of its neighbours too, so the tiles around it are marked.
+static void mark_dirty(nav_grid *grid, uint32_t cell) {
+  uint32_t x = cell % grid->config.width;
+  uint32_t y = cell / grid->config.width;
+  uint32_t tx0 = (x > 0 ? x - 1 : 0) / NAV_TILE_SIZE;
+  uint32_t ty0 = (y > 0 ? y - 1 : 0) / NAV_TILE_SIZE;
+  uint32_t tx1 = glm::min(x + 1, grid->config.width - 1) / NAV_TILE_SIZE;
+  uint32_t ty1 = glm::min(y + 1, grid->config.height - 1) / NAV_TILE_SIZE;
+  for (uint32_t ty = ty0; ty <= ty1; ty++) {
+    for (uint32_t tx = tx0; tx <= tx1; tx++) {
+      grid->dirty_tiles[ty * grid->tiles_x + tx] = 1;
+    }
+  }
+}
+
+static int compare_seeds(const void *a, const void *b) {
+  uint32_t cost_a = ((const nav_seed *)a)->cost;
+  uint32_t cost_b = ((const nav_seed *)b)->cost;
+  return (cost_a > cost_b) - (cost_a < cost_b);
+}
+
+/** Dijkstra outward from the grid's seeds, whose costs are already written into the field. Queued cells sit
+ * in the bucket of their cost modulo NAV_COST_BUCKETS: every edge is cheaper than the bucket count, so the
+ * cells queued at any time span fewer costs than there are buckets. Seeds may lie further apart than that,
+ * so they join the queue in order of cost once the search gets within reach of them. Returns how many cells
+ * got their final cost.
+ */
+static uint32_t integrate(nav_grid *grid, nav_field *field, bool track_dirty) {
+  nav_seed *seeds = grid->seeds.data;
+  uint32_t seed_count = grid->seeds.count;
+  qsort(seeds, seed_count, sizeof(nav_seed), compare_seeds);
+  uint32_t *integration = field->integration;
+  uint8_t *costs = grid->costs;
+  uint32_t width = grid->config.width;
+  uint32_t height = grid->config.height;
+
+  uint32_t queued = 0;
+  uint32_t expanded = 0;
+  uint32_t next_seed = 0;
+  uint32_t current = 0;
+  auto relax = [&](uint32_t neighbour) {
+    uint8_t cost = costs[neighbour];
+    uint32_t next = current + cost;
+    if (cost == NAV_BLOCKED || next >= integration[neighbour]) {
+      return;
+    }
+    integration[neighbour] = next;
+    dyn_array_push(&grid->buckets[next % NAV_COST_BUCKETS], neighbour);
+    queued++;
+    if (track_dirty) {
+      mark_dirty(grid, neighbour);
+    }
+  };
+
+  while (queued > 0 || next_seed < seed_count) {
+    if (queued == 0 && seeds[next_seed].cost > current) {
+      current = seeds[next_seed].cost;
+    }
+    while (next_seed < seed_count && seeds[next_seed].cost < current + NAV_COST_BUCKETS) {
+      dyn_array_push(&grid->buckets[seeds[next_seed].cost % NAV_COST_BUCKETS], seeds[next_seed].cell);
+      queued++;
+      next_seed++;
+    }
+    dyn_array<uint32_t> *bucket = &grid->buckets[current % NAV_COST_BUCKETS];
+    while (bucket->count > 0) {
+      uint32_t cell = dyn_array_pop(bucket);
+      queued--;
+      // queued again with a lower cost since, and already expanded from there
+      if (integration[cell] != current) {
+        continue;
+      }
+      expanded++;
+      uint32_t x = cell % width;
+      uint32_t y = cell / width;
+      if (x + 1 < width) {
+        relax(cell + 1);
+      }
+      if (x > 0) {
+        relax(cell - 1);
+      }
+      if (y + 1 < height) {
+        relax(cell + width);
+      }
+      if (y > 0) {
+        relax(cell - width);
+      }
+    }
+    current++;
+  }
+  return expanded;
+}
+
+// For the cells along the edge of the grid, where some of the neighbours are missing.
+static uint8_t get_edge_direction(nav_grid *grid, nav_field *field, int32_t x, int32_t y) {
+  int32_t width = (int32_t)grid->config.width;
+  int32_t height = (int32_t)grid->config.height;
+  uint32_t *integration = field->integration;
+  uint32_t best = integration[y * width + x];
+  uint8_t direction = NAV_DIRECTION_NONE;
+  for (uint8_t d = 0; d < NAV_DIRECTION_NONE; d++) {
+    int32_t nx = x + direction_offsets[d][0];
+    int32_t ny = y + direction_offsets[d][1];
+    if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+      continue;
+    }
+    if (d >= 4 &&
+        (integration[y * width + nx] == NAV_UNREACHABLE || integration[ny * width + x] == NAV_UNREACHABLE)) {
+      continue;
+    }
+    if (integration[ny * width + nx] < best) {
+      best = integration[ny * width + nx];
+      direction = d;
+    }
+  }
+  return direction;
+}
+
+/** Every cell points at its cheapest neighbour. Diagonals are skipped when either side they pass is
+ * unreachable: a side next to a reachable diagonal could only be unreachable by being blocked, so that keeps
+ * agents from cutting corners without looking at the costs. Cells off the edges take the slow path.
+ */
+static void compute_tile_directions(nav_grid *grid, nav_field *field, uint32_t tx, uint32_t ty) {
+  int32_t width = (int32_t)grid->config.width;
+  int32_t height = (int32_t)grid->config.height;
+  int32_t x0 = tx * NAV_TILE_SIZE;
+  int32_t y0 = ty * NAV_TILE_SIZE;
+  int32_t x1 = glm::min(x0 + NAV_TILE_SIZE, width);
+  int32_t y1 = glm::min(y0 + NAV_TILE_SIZE, height);
+  for (int32_t y = y0; y < y1; y++) {
+    uint8_t *directions = &field->directions[y * width];
+    if (y == 0 || y == height - 1) {
+      for (int32_t x = x0; x < x1; x++) {
+        directions[x] = get_edge_direction(grid, field, x, y);
+      }
+      continue;
+    }
+    const uint32_t *row = &field->integration[y * width];
+    const uint32_t *up = row + width;
+    const uint32_t *down = row - width;
+    for (int32_t x = x0; x < x1; x++) {
+      if (x == 0 || x == width - 1) {
+        directions[x] = get_edge_direction(grid, field, x, y);
+        continue;
+      }
+      uint32_t east = row[x + 1];
+      uint32_t north = up[x];
+      uint32_t west = row[x - 1];
+      uint32_t south = down[x];
+      uint32_t best = row[x];
+      uint8_t direction = NAV_DIRECTION_NONE;
+      if (east < best) {
+        best = east;
+        direction = 0;
+      }
+      if (north < best) {
+        best = north;
+        direction = 1;
+      }
+      if (west < best) {
+        best = west;
+        direction = 2;
+      }
+      if (south < best) {
+        best = south;
+        direction = 3;
+      }
+      if (east != NAV_UNREACHABLE && north != NAV_UNREACHABLE && up[x + 1] < best) {
+        best = up[x + 1];
+        direction = 4;
+      }
+      if (west != NAV_UNREACHABLE && north != NAV_UNREACHABLE && up[x - 1] < best) {
+        best = up[x - 1];
+        direction = 5;
+      }
+      if (west != NAV_UNREACHABLE && south != NAV_UNREACHABLE && down[x - 1] < best) {
+        best = down[x - 1];
+        direction = 6;
+      }
+      if (east != NAV_UNREACHABLE && south != NAV_UNREACHABLE && down[x + 1] < best) {
+        direction = 7;
+      }
+      directions[x] = direction;
+    }
+  }
+}
+
+static void compute_direction_row(nav_grid *grid, nav_field *field, uint32_t ty) {
+  for (uint32_t tx = 0; tx < grid->tiles_x; tx++) {
+    if (grid->dirty_tiles[ty * grid->tiles_x + tx]) {
+      compute_tile_directions(grid, field, tx, ty);
+    }
+  }
+}
+
+static void direction_job(void *data, mem_allocator *scratch) {
+  nav_direction_job *job = (nav_direction_job *)data;
+  compute_direction_row(job->grid, job->field, job->tile_y);
+}
+
+// Directions only read the finished integration field, so rows of tiles don't depend on each other.
+static void compute_directions(nav_grid *grid, nav_field *field) {
+  if (grid->jobs == NULL) {
+    for (uint32_t ty = 0; ty < grid->tiles_y; ty++) {
+      compute_direction_row(grid, field, ty);
+    }
+    return;
+  }
+  for (uint32_t ty = 0; ty < grid->tiles_y; ty++) {
+    uint8_t *row = &grid->dirty_tiles[ty * grid->tiles_x];
+    if (memchr(row, 1, grid->tiles_x) == NULL) {
+      continue;
+    }
+    grid->direction_jobs[ty] = (nav_direction_job){.grid = grid, .field = field, .tile_y = ty};
+    platform_jobs_push_counted(grid->jobs, direction_job, &grid->direction_jobs[ty],
+                               &grid->direction_jobs_pending);
+  }
+  // the pool may be busy with loads that have nothing to do with the grid
+  platform_jobs_wait_counter(grid->jobs, &grid->direction_jobs_pending);
+}
+
+static void build_field(nav_grid *grid, nav_field *field) {
+  uint32_t cell_count = grid->config.width * grid->config.height;
+  memset(field->integration, 0xFF, sizeof(uint32_t) * cell_count);
+  field->integration[field->goal] = 0;
+  dyn_array_clear(&grid->seeds);
+  dyn_array_push(&grid->seeds, (nav_seed){.cost = 0, .cell = field->goal});
+  integrate(grid, field, false);
+  memset(grid->dirty_tiles, 1, grid->tiles_x * grid->tiles_y);
+  compute_directions(grid, field);
+  field->stale = false;
+  field->change_cursor = grid->changes.count;
+  grid->stats.built_count++;
+}
+
+static void reset_cell(nav_grid *grid, uint32_t cell) {
+  grid->reset_marks[cell] = 1;
+  dyn_array_push(&grid->reset_cells, cell);
+}
+
+/** Costs only changed for the cells in the log, so the rest of the field stays right except for the cells
+ * whose cheapest path ran through a changed one. Those are found on the old costs still in the field: a
+ * neighbour that costs exactly its own cost more than a reset cell got its cost from that cell. Once reset
+ * they are seeded from the cells around them and integrated again, which also carries a cheaper way through
+ * a changed cell out into the rest of the field.
+ */
+static void repair_field(nav_grid *grid, nav_field *field) {
+  uint32_t *integration = field->integration;
+  uint32_t width = grid->config.width;
+  uint32_t height = grid->config.height;
+  dyn_array<uint32_t> *reset = &grid->reset_cells;
+  dyn_array_clear(reset);
+  for (uint32_t i = field->change_cursor; i < grid->changes.count; i++) {
+    uint32_t cell = grid->changes.data[i];
+    if (cell != field->goal && !grid->reset_marks[cell]) {
+      reset_cell(grid, cell);
+    }
+  }
+  for (uint32_t i = 0; i < reset->count; i++) {
+    uint32_t cell = reset->data[i];
+    uint32_t cost = integration[cell];
+    if (cost == NAV_UNREACHABLE) {
+      continue;
+    }
+    uint32_t x = cell % width;
+    uint32_t y = cell / width;
+    uint32_t neighbours[4];
+    uint32_t neighbour_count = 0;
+    if (x + 1 < width) {
+      neighbours[neighbour_count++] = cell + 1;
+    }
+    if (x > 0) {
+      neighbours[neighbour_count++] = cell - 1;
+    }
+    if (y + 1 < height) {
+      neighbours[neighbour_count++] = cell + width;
+    }
+    if (y > 0) {
+      neighbours[neighbour_count++] = cell - width;
+    }
+    for (uint32_t n = 0; n < neighbour_count; n++) {
+      uint32_t neighbour = neighbours[n];
+      uint8_t neighbour_cost = grid->costs[neighbour];
+      if (neighbour != field->goal && !grid->reset_marks[neighbour] && neighbour_cost != NAV_BLOCKED &&
+          integration[neighbour] == cost + neighbour_cost) {
+        reset_cell(grid, neighbour);
+      }
+    }
+  }
+
+  memset(grid->dirty_tiles, 0, grid->tiles_x * grid->tiles_y);
+  for (uint32_t i = 0; i < reset->count; i++) {
+    integration[reset->data[i]] = NAV_UNREACHABLE;
+    mark_dirty(grid, reset->data[i]);
+  }
+  dyn_array_clear(&grid->seeds);
+  for (uint32_t i = 0; i < reset->count; i++) {
+    uint32_t cell = reset->data[i];
+    grid->reset_marks[cell] = 0;
+    if (grid->costs[cell] == NAV_BLOCKED) {
+      continue;
+    }
+    uint32_t x = cell % width;
+    uint32_t y = cell / width;
+    uint32_t best = NAV_UNREACHABLE;
+    if (x + 1 < width) {
+      best = glm::min(best, integration[cell + 1]);
+    }
+    if (x > 0) {
+      best = glm::min(best, integration[cell - 1]);
+    }
+    if (y + 1 < height) {
+      best = glm::min(best, integration[cell + width]);
+    }
+    if (y > 0) {
+      best = glm::min(best, integration[cell - width]);
+    }
+    if (best != NAV_UNREACHABLE) {
+      integration[cell] = best + grid->costs[cell];
+      dyn_array_push(&grid->seeds, (nav_seed){.cost = integration[cell], .cell = cell});
+    }
+  }
+  uint32_t expanded = integrate(grid, field, true);
+  compute_directions(grid, field);
+  field->change_cursor = grid->changes.count;
+  grid->stats.repaired_count++;
+  grid->stats.repaired_cell_count += expanded;
+}
+
+static nav_field *take_field(nav_grid *grid) {
+  if (grid->field_count < grid->config.max_fields) {
+    nav_field *field = &grid->fields[grid->field_count++];
+    uint32_t cell_count = grid->config.width * grid->config.height;
+    field->integration = allocator_alloc(grid->allocator, uint32_t, cell_count);
+    field->directions = allocator_alloc(grid->allocator, uint8_t, cell_count);
+    assert(field->integration != NULL && field->directions != NULL);
+    return field;
+  }
+  nav_field *oldest = &grid->fields[0];
+  for (uint32_t i = 1; i < grid->field_count; i++) {
+    if (grid->fields[i].last_used < oldest->last_used) {
+      oldest = &grid->fields[i];
+    }
+  }
+  hash_map_remove(&grid->field_lookup, oldest->goal);
+  grid->stats.evicted_count++;
+  return oldest;
+}
+
+// Once every field is caught up the log starts over.
+static void trim_changes(nav_grid *grid) {
+  for (uint32_t i = 0; i < grid->field_count; i++) {
+    nav_field *field = &grid->fields[i];
+    if (!field->stale && field->change_cursor != grid->changes.count) {
+      return;
+    }
+  }
+  dyn_array_clear(&grid->changes);
+  for (uint32_t i = 0; i < grid->field_count; i++) {
+    grid->fields[i].change_cursor = 0;
+  }
+}
+
+nav_field *nav_get_field(nav_grid *grid, uint32_t goal_x, uint32_t goal_y) {
+  assert(goal_x < grid->config.width && goal_y < grid->config.height);
+  uint32_t goal = goal_y * grid->config.width + goal_x;
+  nav_field *field;
+  uint32_t *slot = hash_map_get(&grid->field_lookup, goal);
+  if (slot != NULL) {
+    field = &grid->fields[*slot];
+    if (field->stale) {
+      build_field(grid, field);
+    } else if (field->change_cursor < grid->changes.count) {
+      repair_field(grid, field);
+    }
+  } else {
+    field = take_field(grid);
+    field->goal = goal;
+    hash_map_put(&grid->field_lookup, goal, (uint32_t)(field - grid->fields));
+    build_field(grid, field);
+  }
+  field->last_used = ++grid->use_counter;
+  trim_changes(grid);
+  return field;
+}
+
+nav_stats nav_get_stats(nav_grid *grid) {
+  nav_stats stats = grid->stats;
+  stats.field_count = grid->field_count;
+  return stats;
+}
@@ -0,0 +1,162 @@
+#include "particle.hpp"
+#include <assert.h>
+#include <string.h>
+#include <xmmintrin.h>
+
+#define PARTICLE_STREAMS 6
+
+static float random_unit(uint32_t *state) {
+  // xorshift32, keeping the top 24 bits as the mantissa
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+particle_emitter particle_emitter_init(uint32_t capacity, particle_emitter_config config,
+                                       mem_allocator *allocator) {
+  capacity = (capacity + PARTICLE_LANES - 1) & ~(PARTICLE_LANES - 1);
+  assert(capacity > 0);
+
+  // one block for every stream, each stream starts on a 32 byte boundary since capacity is a multiple of 8
+  float *block = (float *)allocator_alloc_impl(allocator, sizeof(float) * capacity * PARTICLE_STREAMS, 32);
+  assert(block != NULL);
+  memset(block, 0, sizeof(float) * capacity * PARTICLE_STREAMS);
+
+  particle_emitter emitter = {
+      .config = config,
+      .capacity = capacity,
+      .count = 0,
+      .spawn_accumulator = 0.0f,
+      .rng_state = 0x9E3779B9u,
+      .pos_x = block,
+      .pos_y = block + capacity,
+      .vel_x = block + capacity * 2,
+      .vel_y = block + capacity * 3,
+      .age = block + capacity * 4,
+      .inv_lifetime = block + capacity * 5,
+  };
+  return emitter;
+}
+
+void particle_emitter_destroy(particle_emitter *emitter, mem_allocator *allocator) {
+  allocator_dealloc(allocator, emitter->pos_x);
+  *emitter = {};
+}
+
+void particle_emitter_burst(particle_emitter *emitter, uint32_t count) {
+  particle_emitter_config *config = &emitter->config;
+  for (uint32_t n = 0; n < count && emitter->count < emitter->capacity; n++) {
+    uint32_t i = emitter->count++;
+    float lifetime = glm::mix(config->lifetime_min, config->lifetime_max, random_unit(&emitter->rng_state));
+    glm::vec2 t = glm::vec2(random_unit(&emitter->rng_state), random_unit(&emitter->rng_state));
+    glm::vec2 velocity = glm::mix(config->velocity_min, config->velocity_max, t);
+    emitter->pos_x[i] = config->pos.x;
+    emitter->pos_y[i] = config->pos.y;
+    emitter->vel_x[i] = velocity.x;
+    emitter->vel_y[i] = velocity.y;
+    emitter->age[i] = 0.0f;
+    emitter->inv_lifetime[i] = lifetime > 0.0f ? 1.0f / lifetime : 1.0f;
+  }
+}
+
+void particle_emitter_update(particle_emitter *emitter, float dt) {
+  __m128 dt4 = _mm_set1_ps(dt);
+  __m128 dvx4 = _mm_set1_ps(emitter->config.acceleration.x * dt);
+  __m128 dvy4 = _mm_set1_ps(emitter->config.acceleration.y * dt);
+
+  // the tail of the last group runs on unused slots, which is cheaper than a scalar remainder loop
+  for (uint32_t i = 0; i < emitter->count; i += PARTICLE_LANES) {
+    for (uint32_t lane = 0; lane < PARTICLE_LANES; lane += 4) {
+      uint32_t j = i + lane;
+      __m128 vx = _mm_add_ps(_mm_load_ps(emitter->vel_x + j), dvx4);
+      __m128 vy = _mm_add_ps(_mm_load_ps(emitter->vel_y + j), dvy4);
+      __m128 px = _mm_add_ps(_mm_load_ps(emitter->pos_x + j), _mm_mul_ps(vx, dt4));
+      __m128 py = _mm_add_ps(_mm_load_ps(emitter->pos_y + j), _mm_mul_ps(vy, dt4));
+      __m128 age = _mm_add_ps(_mm_load_ps(emitter->age + j), dt4);
+      _mm_store_ps(emitter->vel_x + j, vx);
+      _mm_store_ps(emitter->vel_y + j, vy);
+      _mm_store_ps(emitter->pos_x + j, px);
+      _mm_store_ps(emitter->pos_y + j, py);
+      _mm_store_ps(emitter->age + j, age);
+    }
+  }
+
+  // swap dead particles with the last live one
+  uint32_t i = 0;
+  while (i < emitter->count) {
+    if (emitter->age[i] * emitter->inv_lifetime[i] < 1.0f) {
+      i++;
+      continue;
+    }
+    uint32_t last = --emitter->count;
+    emitter->pos_x[i] = emitter->pos_x[last];
+    emitter->pos_y[i] = emitter->pos_y[last];
+    emitter->vel_x[i] = emitter->vel_x[last];
+    emitter->vel_y[i] = emitter->vel_y[last];
+    emitter->age[i] = emitter->age[last];
+    emitter->inv_lifetime[i] = emitter->inv_lifetime[last];
+  }
+
+  emitter->spawn_accumulator += emitter->config.spawn_rate * dt;
+  uint32_t spawn_count = (uint32_t)emitter->spawn_accumulator;
+  emitter->spawn_accumulator -= (float)spawn_count;
+  particle_emitter_burst(emitter, spawn_count);
+}
+
+void particle_emitter_render(particle_emitter *emitter, struct renderer *renderer) {
+  if (emitter->count == 0) {
+    return;
+  }
+
+  // map whole groups so the last one can be written without a remainder loop
+  uint32_t padded_count = (emitter->count + PARTICLE_LANES - 1) & ~(PARTICLE_LANES - 1);
+  render_instance *instances = renderer_map_instances(renderer, padded_count);
+
+  particle_emitter_config *config = &emitter->config;
+  glm::vec4 color_start = config->color_start / 255.0f;
+  glm::vec4 color_delta = config->color_end / 255.0f - color_start;
+  __m128 one = _mm_set1_ps(1.0f);
+  __m128 z4 = _mm_set1_ps(config->pos.z);
+  __m128 size_start = _mm_set1_ps(config->size_start);
+  __m128 size_delta = _mm_set1_ps(config->size_end - config->size_start);
+  __m128 r_start = _mm_set1_ps(color_start.r), r_delta = _mm_set1_ps(color_delta.r);
+  __m128 g_start = _mm_set1_ps(color_start.g), g_delta = _mm_set1_ps(color_delta.g);
+  __m128 b_start = _mm_set1_ps(color_start.b), b_delta = _mm_set1_ps(color_delta.b);
+  __m128 a_start = _mm_set1_ps(color_start.a), a_delta = _mm_set1_ps(color_delta.a);
+
+  for (uint32_t i = 0; i < padded_count; i += PARTICLE_LANES) {
+    for (uint32_t lane = 0; lane < PARTICLE_LANES; lane += 4) {
+      uint32_t j = i + lane;
+      __m128 t = _mm_mul_ps(_mm_load_ps(emitter->age + j), _mm_load_ps(emitter->inv_lifetime + j));
+      t = _mm_min_ps(t, one);
+      __m128 x = _mm_load_ps(emitter->pos_x + j);
+      __m128 y = _mm_load_ps(emitter->pos_y + j);
+      __m128 z = z4;
+      __m128 size = _mm_add_ps(size_start, _mm_mul_ps(size_delta, t));
+      __m128 r = _mm_add_ps(r_start, _mm_mul_ps(r_delta, t));
+      __m128 g = _mm_add_ps(g_start, _mm_mul_ps(g_delta, t));
+      __m128 b = _mm_add_ps(b_start, _mm_mul_ps(b_delta, t));
+      __m128 a = _mm_add_ps(a_start, _mm_mul_ps(a_delta, t));
+
+      // turn four lanes of each stream into four interleaved instances
+      _MM_TRANSPOSE4_PS(x, y, z, size);
+      _MM_TRANSPOSE4_PS(r, g, b, a);
+      _mm_storeu_ps(&instances[j + 0].pos_size.x, x);
+      _mm_storeu_ps(&instances[j + 0].color.x, r);
+      _mm_storeu_ps(&instances[j + 1].pos_size.x, y);
+      _mm_storeu_ps(&instances[j + 1].color.x, g);
+      _mm_storeu_ps(&instances[j + 2].pos_size.x, z);
+      _mm_storeu_ps(&instances[j + 2].color.x, b);
+      _mm_storeu_ps(&instances[j + 3].pos_size.x, size);
+      _mm_storeu_ps(&instances[j + 3].color.x, a);
+    }
+  }
+
+  renderer_render_instances(renderer, (render_cmd_instances){
+                                          .texture_id = config->texture_id,
+                                          .count = emitter->count,
+                                      });
+}
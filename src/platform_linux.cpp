@@ -1,7 +1,17 @@
 #include "platform.hpp"
+#include <SDL2/SDL.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <sys/inotify.h>
 #include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
 
 void platform_get_file_size(const char *path, size_t *size) {
   struct stat st;
@@ -18,6 +28,16 @@ void platform_read_entire_file(const char *path, size_t size, void *out) {
   fclose(file);
 }
 
+void platform_read_file_range(const char *path, size_t offset, size_t size, void *out) {
+  FILE *file = fopen(path, "rb");
+  assert(file);
+  int res = fseek(file, (long)offset, SEEK_SET);
+  assert(res == 0);
+  size_t bytes_read = fread(out, 1, size, file);
+  assert(bytes_read == size);
+  fclose(file);
+}
+
 void platform_write_file(const char *path, size_t size, void *data) {
   FILE *file = fopen(path, "wb");
   assert(file);
@@ -26,12 +46,526 @@ void platform_write_file(const char *path, size_t size, void *data) {
   fclose(file);
 }
 
+bool platform_file_exists(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0;
+}
+
+void platform_create_directory(const char *path) {
+  int res = mkdir(path, 0755);
+  assert(res == 0 || errno == EEXIST);
+}
+
+void *platform_gl_get_proc_address(const char *name) { return SDL_GL_GetProcAddress(name); }
+
+static int64_t file_modified_ns(const char *path) {
+  struct stat st;
+  if (stat(path, &st) != 0) {
+    return -1;
+  }
+  return (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+static bool copy_file(const char *from, const char *to) {
+  FILE *in = fopen(from, "rb");
+  if (in == NULL) {
+    return false;
+  }
+  FILE *out = fopen(to, "wb");
+  if (out == NULL) {
+    fclose(in);
+    return false;
+  }
+  char buffer[64 * 1024];
+  size_t bytes_read;
+  bool ok = true;
+  while ((bytes_read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+    ok = ok && fwrite(buffer, 1, bytes_read, out) == bytes_read;
+  }
+  ok = ok && !ferror(in);
+  fclose(in);
+  ok = fclose(out) == 0 && ok;
+  return ok;
+}
+
+bool platform_library_load(platform_library *library, const char *path) {
+  if (path != library->path) {
+    assert(strlen(path) + 16 < PLATFORM_LIBRARY_PATH_SIZE);
+    strcpy(library->path, path);
+  }
+  // remember the attempt even when it fails, a broken build is only retried once it changes again
+  library->modified_ns = file_modified_ns(library->path);
+  if (library->modified_ns < 0) {
+    platform_log_error("Library %s doesn't exist", library->path);
+    return false;
+  }
+
+  char live_path[PLATFORM_LIBRARY_PATH_SIZE];
+  // dlopen only takes the path literally when it has a slash, otherwise it searches the library paths
+  snprintf(live_path, sizeof(live_path), "%s%s.%u.live", strchr(library->path, '/') != NULL ? "" : "./",
+           library->path, library->generation + 1);
+  if (!copy_file(library->path, live_path)) {
+    platform_log_error("Failed to copy %s", library->path);
+    unlink(live_path);
+    return false;
+  }
+  void *handle = dlopen(live_path, RTLD_NOW | RTLD_LOCAL);
+  if (handle == NULL) {
+    platform_log_error("Failed to load %s: %s", library->path, dlerror());
+    unlink(live_path);
+    return false;
+  }
+
+  platform_library_unload(library);
+  library->handle = handle;
+  strcpy(library->live_path, live_path);
+  library->generation++;
+  return true;
+}
+
+void platform_library_unload(platform_library *library) {
+  if (library->handle == NULL) {
+    return;
+  }
+  // queued log records still point at format strings inside the library
+  platform_log_flush();
+  dlclose(library->handle);
+  unlink(library->live_path);
+  library->handle = NULL;
+  library->live_path[0] = '\0';
+}
+
+void *platform_library_get_symbol(platform_library *library, const char *name) {
+  assert(library->handle != NULL);
+  return dlsym(library->handle, name);
+}
+
+bool platform_library_changed(platform_library *library) {
+  int64_t modified_ns = file_modified_ns(library->path);
+  return modified_ns >= 0 && modified_ns != library->modified_ns;
+}
+
+// Fixed size records so the ring never has to deal with wrap-around of variable length entries.
+#define LOG_MAX_ARGS 12
+#define LOG_STRING_BYTES 128
+#define LOG_RING_RECORDS 1024
+#define LOG_MAX_THREADS 32
+#define LOG_BATCH_BYTES (64 * 1024)
+#define LOG_IDLE_MS 5
+
+enum log_arg_kind : uint8_t {
+  LOG_ARG_INT,
+  LOG_ARG_INT64,
+  LOG_ARG_UINT,
+  LOG_ARG_UINT64,
+  LOG_ARG_DOUBLE,
+  LOG_ARG_POINTER,
+  LOG_ARG_STRING,
+};
+
+struct log_record {
+  uint64_t time_ns;
+  const char *format;
+  uint8_t level;
+  uint8_t arg_count;
+  uint16_t string_used;
+  log_arg_kind kinds[LOG_MAX_ARGS];
+  uint64_t args[LOG_MAX_ARGS];
+  char strings[LOG_STRING_BYTES];
+};
+
+// One ring per logging thread: the thread is the only producer and the flush thread the only consumer.
+struct log_ring {
+  log_record records[LOG_RING_RECORDS];
+  alignas(64) uint32_t write_index;
+  alignas(64) uint32_t read_index;
+  uint32_t dropped;
+};
+
+struct log_state {
+  log_ring *rings[LOG_MAX_THREADS];
+  uint32_t ring_count;
+  uint32_t unregistered_dropped;
+  uint32_t level;
+  uint32_t running;
+  platform_thread thread;
+  uint64_t start_ns;
+  char batch[LOG_BATCH_BYTES];
+};
+
+static log_state logger = {.level = PLATFORM_LOG_DEBUG};
+static thread_local log_ring *log_thread_ring = NULL;
+
+static const char *const log_level_names[] = {"[DEBUG] ", "[INFO] ", "[ERROR] "};
+
+static void log_write_sync(platform_log_level level, const char *format, va_list args) {
+  FILE *out = level == PLATFORM_LOG_ERROR ? stderr : stdout;
+  fputs(log_level_names[level], out);
+  vfprintf(out, format, args);
+  fputc('\n', out);
+}
+
+static log_ring *log_get_thread_ring() {
+  if (log_thread_ring != NULL) {
+    return log_thread_ring;
+  }
+  uint32_t slot = __atomic_fetch_add(&logger.ring_count, 1, __ATOMIC_RELAXED);
+  if (slot >= LOG_MAX_THREADS) {
+    return NULL;
+  }
+  log_ring *ring = (log_ring *)calloc(1, sizeof(log_ring));
+  assert(ring != NULL);
+  __atomic_store_n(&logger.rings[slot], ring, __ATOMIC_RELEASE);
+  log_thread_ring = ring;
+  return ring;
+}
+
+/** Walks the format the same way printf will and copies each argument out of the va_list by its type.
+ * Strings are copied into the record since the caller's buffer may be gone by the time it is formatted,
+ * anything that doesn't fit is cut short.
+ */
+static bool log_capture(log_record *record, const char *format, va_list args) {
+  record->arg_count = 0;
+  record->string_used = 0;
+  for (const char *c = format; *c != '\0'; c++) {
+    if (*c != '%') {
+      continue;
+    }
+    c++;
+    if (*c == '%') {
+      continue;
+    }
+    while (*c == '-' || *c == '+' || *c == ' ' || *c == '#' || *c == '0') {
+      c++;
+    }
+    for (uint32_t part = 0; part < 2; part++) {
+      if (*c == '*') {
+        if (record->arg_count == LOG_MAX_ARGS) {
+          return false;
+        }
+        record->kinds[record->arg_count] = LOG_ARG_INT;
+        record->args[record->arg_count++] = (uint64_t)(int64_t)va_arg(args, int);
+        c++;
+      }
+      while (*c >= '0' && *c <= '9') {
+        c++;
+      }
+      if (part == 0 && *c == '.') {
+        c++;
+      } else {
+        break;
+      }
+    }
+    bool wide = false;
+    while (*c == 'h' || *c == 'l' || *c == 'z' || *c == 'j' || *c == 't') {
+      wide = wide || *c == 'l' || *c == 'z' || *c == 'j' || *c == 't';
+      c++;
+    }
+    if (record->arg_count == LOG_MAX_ARGS) {
+      return false;
+    }
+
+    uint32_t i = record->arg_count++;
+    switch (*c) {
+    case 'd':
+    case 'i':
+    case 'c':
+      record->kinds[i] = wide ? LOG_ARG_INT64 : LOG_ARG_INT;
+      record->args[i] = wide ? (uint64_t)va_arg(args, long long) : (uint64_t)(int64_t)va_arg(args, int);
+      break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+      record->kinds[i] = wide ? LOG_ARG_UINT64 : LOG_ARG_UINT;
+      record->args[i] = wide ? (uint64_t)va_arg(args, unsigned long long) : va_arg(args, unsigned int);
+      break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G':
+    case 'a':
+    case 'A': {
+      double value = va_arg(args, double);
+      record->kinds[i] = LOG_ARG_DOUBLE;
+      memcpy(&record->args[i], &value, sizeof(value));
+    } break;
+    case 'p':
+      record->kinds[i] = LOG_ARG_POINTER;
+      record->args[i] = (uint64_t)(uintptr_t)va_arg(args, void *);
+      break;
+    case 's': {
+      const char *value = va_arg(args, const char *);
+      if (value == NULL) {
+        value = "(null)";
+      }
+      size_t available = LOG_STRING_BYTES - record->string_used;
+      size_t length = strnlen(value, available > 0 ? available - 1 : 0);
+      record->kinds[i] = LOG_ARG_STRING;
+      record->args[i] = record->string_used;
+      if (available > 0) {
+        memcpy(record->strings + record->string_used, value, length);
+        record->strings[record->string_used + length] = '\0';
+        record->string_used += length + 1;
+      } else {
+        record->args[i] = LOG_STRING_BYTES - 1;
+      }
+    } break;
+    default:
+      // unknown conversions, and %n which has no meaning once deferred
+      return false;
+    }
+  }
+  return true;
+}
+
+static void log_push(platform_log_level level, const char *format, va_list args) {
+  if ((uint32_t)level < __atomic_load_n(&logger.level, __ATOMIC_RELAXED)) {
+    return;
+  }
+  if (!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE)) {
+    log_write_sync(level, format, args);
+    return;
+  }
+
+  log_ring *ring = log_get_thread_ring();
+  if (ring == NULL) {
+    __atomic_fetch_add(&logger.unregistered_dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  uint32_t write_index = ring->write_index;
+  if (write_index - __atomic_load_n(&ring->read_index, __ATOMIC_ACQUIRE) == LOG_RING_RECORDS) {
+    __atomic_fetch_add(&ring->dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  log_record *record = &ring->records[write_index & (LOG_RING_RECORDS - 1)];
+  record->time_ns = platform_get_time_ns();
+  record->format = format;
+  record->level = (uint8_t)level;
+  va_list capture_args;
+  va_copy(capture_args, args);
+  bool captured = log_capture(record, format, capture_args);
+  va_end(capture_args);
+  if (!captured) {
+    // fall back to formatting right away rather than losing the message
+    record->format = "%s";
+    record->arg_count = 1;
+    record->kinds[0] = LOG_ARG_STRING;
+    record->args[0] = 0;
+    record->string_used = LOG_STRING_BYTES;
+    vsnprintf(record->strings, LOG_STRING_BYTES, format, args);
+  }
+  __atomic_store_n(&ring->write_index, write_index + 1, __ATOMIC_RELEASE);
+}
+
+template <typename T>
+static int log_snprintf(char *out, size_t capacity, const char *spec, int *stars, uint32_t star_count,
+                        T value) {
+  switch (star_count) {
+  case 0:
+    return snprintf(out, capacity, spec, value);
+  case 1:
+    return snprintf(out, capacity, spec, stars[0], value);
+  default:
+    return snprintf(out, capacity, spec, stars[0], stars[1], value);
+  }
+}
+
+static size_t log_format_arg(char *out, size_t capacity, const char *spec, log_record *record, uint32_t *arg,
+                             uint32_t star_count) {
+  if (*arg + star_count >= record->arg_count) {
+    return 0;
+  }
+  int stars[2] = {};
+  for (uint32_t i = 0; i < star_count; i++) {
+    stars[i] = (int)(int64_t)record->args[(*arg)++];
+  }
+  uint32_t i = (*arg)++;
+  uint64_t value = record->args[i];
+  double real;
+  memcpy(&real, &value, sizeof(real));
+
+  int written = 0;
+  switch (record->kinds[i]) {
+  case LOG_ARG_INT:
+    written = log_snprintf(out, capacity, spec, stars, star_count, (int)(int64_t)value);
+    break;
+  case LOG_ARG_INT64:
+    written = log_snprintf(out, capacity, spec, stars, star_count, (long long)value);
+    break;
+  case LOG_ARG_UINT:
+    written = log_snprintf(out, capacity, spec, stars, star_count, (unsigned int)value);
+    break;
+  case LOG_ARG_UINT64:
+    written = log_snprintf(out, capacity, spec, stars, star_count, (unsigned long long)value);
+    break;
+  case LOG_ARG_DOUBLE:
+    written = log_snprintf(out, capacity, spec, stars, star_count, real);
+    break;
+  case LOG_ARG_POINTER:
+    written = log_snprintf(out, capacity, spec, stars, star_count, (void *)(uintptr_t)value);
+    break;
+  case LOG_ARG_STRING:
+    written = log_snprintf(out, capacity, spec, stars, star_count, (const char *)(record->strings + value));
+    break;
+  }
+  if (written < 0) {
+    return 0;
+  }
+  return (size_t)written < capacity ? (size_t)written : capacity - 1;
+}
+
+// Replays the format one conversion at a time with the captured arguments, returns the bytes written.
+static size_t log_format_record(char *out, size_t capacity, log_record *record) {
+  size_t used = (size_t)snprintf(out, capacity, "%.3f %s", (record->time_ns - logger.start_ns) / 1e9,
+                                 log_level_names[record->level]);
+  uint32_t arg = 0;
+  const char *c = record->format;
+  while (*c != '\0' && used + 1 < capacity) {
+    if (*c != '%') {
+      out[used++] = *c++;
+      continue;
+    }
+    if (c[1] == '%') {
+      out[used++] = '%';
+      c += 2;
+      continue;
+    }
+
+    char spec[32];
+    uint32_t length = 0;
+    uint32_t star_count = 0;
+    spec[length++] = *c++;
+    while (*c != '\0' && strchr("-+ #0123456789.*hlzjt", *c) != NULL && length < sizeof(spec) - 2) {
+      star_count += *c == '*';
+      spec[length++] = *c++;
+    }
+    if (*c == '\0' || star_count > 2) {
+      break;
+    }
+    spec[length++] = *c++;
+    spec[length] = '\0';
+    used += log_format_arg(out + used, capacity - used, spec, record, &arg, star_count);
+  }
+  if (used + 1 >= capacity) {
+    used = capacity - 2;
+  }
+  out[used++] = '\n';
+  return used;
+}
+
+static void log_flush_batch(FILE *out, size_t *used) {
+  if (*used > 0) {
+    fwrite(logger.batch, 1, *used, out);
+    fflush(out);
+    *used = 0;
+  }
+}
+
+// Drains every ring into the batch buffer, errors are written separately since they go to stderr.
+static bool log_drain() {
+  bool drained_any = false;
+  size_t used = 0;
+  uint32_t ring_count = __atomic_load_n(&logger.ring_count, __ATOMIC_RELAXED);
+  if (ring_count > LOG_MAX_THREADS) {
+    ring_count = LOG_MAX_THREADS;
+  }
+  for (uint32_t r = 0; r < ring_count; r++) {
+    log_ring *ring = __atomic_load_n(&logger.rings[r], __ATOMIC_ACQUIRE);
+    if (ring == NULL) {
+      continue;
+    }
+    uint32_t read_index = ring->read_index;
+    uint32_t write_index = __atomic_load_n(&ring->write_index, __ATOMIC_ACQUIRE);
+    for (; read_index != write_index; read_index++) {
+      log_record *record = &ring->records[read_index & (LOG_RING_RECORDS - 1)];
+      if (LOG_BATCH_BYTES - used < 1024) {
+        log_flush_batch(stdout, &used);
+      }
+      if (record->level == PLATFORM_LOG_ERROR) {
+        log_flush_batch(stdout, &used);
+        size_t length = log_format_record(logger.batch, LOG_BATCH_BYTES, record);
+        fwrite(logger.batch, 1, length, stderr);
+        drained_any = true;
+        continue;
+      }
+      used += log_format_record(logger.batch + used, LOG_BATCH_BYTES - used, record);
+      drained_any = true;
+    }
+    __atomic_store_n(&ring->read_index, read_index, __ATOMIC_RELEASE);
+  }
+  log_flush_batch(stdout, &used);
+  return drained_any;
+}
+
+static void log_thread_main(void *data) {
+  while (__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE)) {
+    if (!log_drain()) {
+      platform_sleep_ms(LOG_IDLE_MS);
+    }
+  }
+  log_drain();
+}
+
+void platform_log_init() {
+  assert(!logger.running);
+  logger.start_ns = platform_get_time_ns();
+  __atomic_store_n(&logger.running, 1, __ATOMIC_RELEASE);
+  logger.thread = platform_thread_create(log_thread_main, NULL);
+}
+
+void platform_log_shutdown() {
+  if (!logger.running) {
+    return;
+  }
+  __atomic_store_n(&logger.running, 0, __ATOMIC_RELEASE);
+  platform_thread_join(logger.thread);
+  uint32_t dropped = platform_log_get_dropped();
+  if (dropped > 0) {
+    fprintf(stderr, "[ERROR] %u log messages dropped\n", dropped);
+  }
+}
+
+void platform_log_set_level(platform_log_level level) {
+  __atomic_store_n(&logger.level, (uint32_t)level, __ATOMIC_RELAXED);
+}
+
+uint32_t platform_log_get_dropped() {
+  uint32_t dropped = __atomic_load_n(&logger.unregistered_dropped, __ATOMIC_RELAXED);
+  uint32_t ring_count = __atomic_load_n(&logger.ring_count, __ATOMIC_RELAXED);
+  for (uint32_t r = 0; r < ring_count && r < LOG_MAX_THREADS; r++) {
+    log_ring *ring = __atomic_load_n(&logger.rings[r], __ATOMIC_ACQUIRE);
+    if (ring != NULL) {
+      dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+    }
+  }
+  return dropped;
+}
+
+void platform_log_flush() {
+  if (!__atomic_load_n(&logger.running, __ATOMIC_ACQUIRE)) {
+    return;
+  }
+  uint32_t ring_count = __atomic_load_n(&logger.ring_count, __ATOMIC_RELAXED);
+  for (uint32_t r = 0; r < ring_count && r < LOG_MAX_THREADS; r++) {
+    log_ring *ring = __atomic_load_n(&logger.rings[r], __ATOMIC_ACQUIRE);
+    if (ring == NULL) {
+      continue;
+    }
+    uint32_t write_index = __atomic_load_n(&ring->write_index, __ATOMIC_ACQUIRE);
+    while ((int32_t)(write_index - __atomic_load_n(&ring->read_index, __ATOMIC_ACQUIRE)) > 0) {
+      platform_sleep_ms(1);
+    }
+  }
+}
+
 void platform_log_info(const char *msg, ...) {
   va_list args;
   va_start(args, msg);
-  printf("[INFO] ");
-  vprintf(msg, args);
-  printf("\n");
+  log_push(PLATFORM_LOG_INFO, msg, args);
   va_end(args);
 }
 
@@ -39,9 +573,7 @@ void platform_log_debug(const char *msg, ...) {
 #ifndef NDEBUG
   va_list args;
   va_start(args, msg);
-  printf("[DEBUG] ");
-  vprintf(msg, args);
-  printf("\n");
+  log_push(PLATFORM_LOG_DEBUG, msg, args);
   va_end(args);
 #endif
 }
@@ -49,8 +581,276 @@ void platform_log_debug(const char *msg, ...) {
 void platform_log_error(const char *msg, ...) {
   va_list args;
   va_start(args, msg);
-  fprintf(stderr, "[ERROR] ");
-  vfprintf(stderr, msg, args);
-  fprintf(stderr, "\n");
+  log_push(PLATFORM_LOG_ERROR, msg, args);
   va_end(args);
 }
+
+struct thread_start {
+  platform_thread_fn fn;
+  void *data;
+};
+
+static void *thread_main(void *arg) {
+  thread_start start = *(thread_start *)arg;
+  free(arg);
+  start.fn(start.data);
+  return NULL;
+}
+
+platform_thread platform_thread_create(platform_thread_fn fn, void *data) {
+  thread_start *start = (thread_start *)malloc(sizeof(thread_start));
+  assert(start != NULL);
+  *start = (thread_start){.fn = fn, .data = data};
+  pthread_t thread;
+  int res = pthread_create(&thread, NULL, thread_main, start);
+  assert(res == 0);
+  return (platform_thread){.handle = (uint64_t)thread};
+}
+
+void platform_thread_join(platform_thread thread) { pthread_join((pthread_t)thread.handle, NULL); }
+
+void platform_sleep_ms(uint32_t ms) {
+  struct timespec ts = {.tv_sec = ms / 1000, .tv_nsec = (long)(ms % 1000) * 1000000L};
+  nanosleep(&ts, NULL);
+}
+
+uint64_t platform_get_time_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+uint32_t platform_get_cpu_count() {
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return count > 0 ? (uint32_t)count : 1;
+}
+
+struct platform_job {
+  platform_job_fn fn;
+  void *data;
+  uint32_t *counter;
+};
+
+struct platform_worker {
+  platform_jobs *jobs;
+  platform_thread thread;
+  mem_allocator scratch;
+};
+
+struct platform_jobs {
+  pthread_mutex_t mutex;
+  pthread_cond_t job_pushed;
+  pthread_cond_t jobs_finished;
+  platform_job queue[PLATFORM_JOBS_CAPACITY];
+  uint32_t head;
+  uint32_t tail;
+  uint32_t pending;
+  bool quit;
+  uint32_t worker_count;
+  platform_worker workers[PLATFORM_JOBS_MAX_WORKERS];
+};
+
+static void worker_main(void *data) {
+  platform_worker *worker = (platform_worker *)data;
+  platform_jobs *jobs = worker->jobs;
+  for (;;) {
+    pthread_mutex_lock(&jobs->mutex);
+    while (jobs->head == jobs->tail && !jobs->quit) {
+      pthread_cond_wait(&jobs->job_pushed, &jobs->mutex);
+    }
+    if (jobs->head == jobs->tail) {
+      pthread_mutex_unlock(&jobs->mutex);
+      return;
+    }
+    platform_job job = jobs->queue[jobs->head++ % PLATFORM_JOBS_CAPACITY];
+    pthread_mutex_unlock(&jobs->mutex);
+
+    job.fn(job.data, &worker->scratch);
+    allocator_clear(&worker->scratch);
+
+    pthread_mutex_lock(&jobs->mutex);
+    bool counter_done = job.counter != NULL && --*job.counter == 0;
+    if (--jobs->pending == 0 || counter_done) {
+      pthread_cond_broadcast(&jobs->jobs_finished);
+    }
+    pthread_mutex_unlock(&jobs->mutex);
+  }
+}
+
+platform_jobs *platform_jobs_create(uint32_t worker_count, uintptr_t scratch_size) {
+  assert(worker_count > 0 && worker_count <= PLATFORM_JOBS_MAX_WORKERS);
+  platform_jobs *jobs = (platform_jobs *)calloc(1, sizeof(platform_jobs));
+  assert(jobs != NULL);
+  pthread_mutex_init(&jobs->mutex, NULL);
+  pthread_cond_init(&jobs->job_pushed, NULL);
+  pthread_cond_init(&jobs->jobs_finished, NULL);
+  jobs->worker_count = worker_count;
+  for (uint32_t i = 0; i < worker_count; i++) {
+    platform_worker *worker = &jobs->workers[i];
+    worker->jobs = jobs;
+    worker->scratch = allocator_arena_init(scratch_size);
+    worker->thread = platform_thread_create(worker_main, worker);
+  }
+  return jobs;
+}
+
+void platform_jobs_destroy(platform_jobs *jobs) {
+  pthread_mutex_lock(&jobs->mutex);
+  jobs->quit = true;
+  pthread_cond_broadcast(&jobs->job_pushed);
+  pthread_mutex_unlock(&jobs->mutex);
+  for (uint32_t i = 0; i < jobs->worker_count; i++) {
+    platform_thread_join(jobs->workers[i].thread);
+    allocator_destroy(&jobs->workers[i].scratch);
+  }
+  pthread_cond_destroy(&jobs->jobs_finished);
+  pthread_cond_destroy(&jobs->job_pushed);
+  pthread_mutex_destroy(&jobs->mutex);
+  free(jobs);
+}
+
+void platform_jobs_push(platform_jobs *jobs, platform_job_fn fn, void *data) {
+  platform_jobs_push_counted(jobs, fn, data, NULL);
+}
+
+void platform_jobs_push_counted(platform_jobs *jobs, platform_job_fn fn, void *data, uint32_t *counter) {
+  pthread_mutex_lock(&jobs->mutex);
+  assert(jobs->tail - jobs->head < PLATFORM_JOBS_CAPACITY && "Job queue is full");
+  jobs->queue[jobs->tail++ % PLATFORM_JOBS_CAPACITY] =
+      (platform_job){.fn = fn, .data = data, .counter = counter};
+  jobs->pending++;
+  if (counter != NULL) {
+    (*counter)++;
+  }
+  pthread_cond_signal(&jobs->job_pushed);
+  pthread_mutex_unlock(&jobs->mutex);
+}
+
+void platform_jobs_wait(platform_jobs *jobs) {
+  pthread_mutex_lock(&jobs->mutex);
+  while (jobs->pending > 0) {
+    pthread_cond_wait(&jobs->jobs_finished, &jobs->mutex);
+  }
+  pthread_mutex_unlock(&jobs->mutex);
+}
+
+void platform_jobs_wait_counter(platform_jobs *jobs, uint32_t *counter) {
+  pthread_mutex_lock(&jobs->mutex);
+  while (*counter > 0) {
+    pthread_cond_wait(&jobs->jobs_finished, &jobs->mutex);
+  }
+  pthread_mutex_unlock(&jobs->mutex);
+}
+
+uint32_t platform_jobs_get_pending_count(platform_jobs *jobs) {
+  pthread_mutex_lock(&jobs->mutex);
+  uint32_t pending = jobs->pending;
+  pthread_mutex_unlock(&jobs->mutex);
+  return pending;
+}
+
+#define WATCH_POLL_MS 100
+
+struct platform_watcher {
+  int fd;
+  int watches[PLATFORM_WATCH_MAX_DIRS];
+  const char *dirs[PLATFORM_WATCH_MAX_DIRS];
+  uint32_t dir_count;
+  platform_thread thread;
+  uint32_t running;
+  pthread_mutex_t mutex;
+  platform_file_change changes[PLATFORM_WATCH_MAX_CHANGES];
+  uint32_t change_count;
+  uint32_t dropped;
+};
+
+static void watcher_push(platform_watcher *watcher, const char *dir, const char *name) {
+  platform_file_change change = {.time_ns = platform_get_time_ns()};
+  snprintf(change.path, sizeof(change.path), "%s/%s", dir, name);
+  pthread_mutex_lock(&watcher->mutex);
+  uint32_t i = 0;
+  while (i < watcher->change_count && strcmp(watcher->changes[i].path, change.path) != 0) {
+    i++;
+  }
+  if (i < watcher->change_count) {
+    watcher->changes[i].time_ns = change.time_ns;
+  } else if (watcher->change_count < PLATFORM_WATCH_MAX_CHANGES) {
+    watcher->changes[watcher->change_count] = change;
+    // published last, the poll only takes the lock when this is non-zero
+    __atomic_store_n(&watcher->change_count, watcher->change_count + 1, __ATOMIC_RELEASE);
+  } else {
+    watcher->dropped++;
+  }
+  pthread_mutex_unlock(&watcher->mutex);
+}
+
+static void watcher_main(void *data) {
+  platform_watcher *watcher = (platform_watcher *)data;
+  alignas(struct inotify_event) char buffer[16 * 1024];
+  struct pollfd pfd = {.fd = watcher->fd, .events = POLLIN};
+  while (__atomic_load_n(&watcher->running, __ATOMIC_ACQUIRE)) {
+    if (poll(&pfd, 1, WATCH_POLL_MS) <= 0) {
+      continue;
+    }
+    ssize_t length = read(watcher->fd, buffer, sizeof(buffer));
+    for (ssize_t offset = 0; offset < length;) {
+      struct inotify_event *event = (struct inotify_event *)(buffer + offset);
+      offset += sizeof(struct inotify_event) + event->len;
+      if (event->len == 0 || (event->mask & IN_ISDIR)) {
+        continue;
+      }
+      for (uint32_t i = 0; i < watcher->dir_count; i++) {
+        if (watcher->watches[i] == event->wd) {
+          watcher_push(watcher, watcher->dirs[i], event->name);
+        }
+      }
+    }
+  }
+}
+
+platform_watcher *platform_watcher_create(const char **dirs, uint32_t dir_count) {
+  assert(dir_count <= PLATFORM_WATCH_MAX_DIRS);
+  platform_watcher *watcher = (platform_watcher *)calloc(1, sizeof(platform_watcher));
+  assert(watcher != NULL);
+  watcher->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  assert(watcher->fd >= 0);
+  // editors either write in place or write a temporary file and move it over the original
+  for (uint32_t i = 0; i < dir_count; i++) {
+    watcher->dirs[i] = dirs[i];
+    watcher->watches[i] = inotify_add_watch(watcher->fd, dirs[i], IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watcher->watches[i] < 0) {
+      platform_log_error("Can't watch %s: %s", dirs[i], strerror(errno));
+    }
+  }
+  watcher->dir_count = dir_count;
+  pthread_mutex_init(&watcher->mutex, NULL);
+  watcher->running = 1;
+  watcher->thread = platform_thread_create(watcher_main, watcher);
+  return watcher;
+}
+
+void platform_watcher_destroy(platform_watcher *watcher) {
+  __atomic_store_n(&watcher->running, 0, __ATOMIC_RELEASE);
+  platform_thread_join(watcher->thread);
+  close(watcher->fd);
+  pthread_mutex_destroy(&watcher->mutex);
+  free(watcher);
+}
+
+uint32_t platform_watcher_poll(platform_watcher *watcher, platform_file_change *out, uint32_t max_out) {
+  if (__atomic_load_n(&watcher->change_count, __ATOMIC_ACQUIRE) == 0) {
+    return 0;
+  }
+  pthread_mutex_lock(&watcher->mutex);
+  uint32_t count = watcher->change_count < max_out ? watcher->change_count : max_out;
+  memcpy(out, watcher->changes, sizeof(platform_file_change) * count);
+  memmove(watcher->changes, watcher->changes + count,
+          sizeof(platform_file_change) * (watcher->change_count - count));
+  __atomic_store_n(&watcher->change_count, watcher->change_count - count, __ATOMIC_RELEASE);
+  if (watcher->dropped > 0) {
+    platform_log_error("%u file changes were dropped", watcher->dropped);
+    watcher->dropped = 0;
+  }
+  pthread_mutex_unlock(&watcher->mutex);
+  return count;
+}
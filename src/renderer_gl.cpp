@@ -2,6 +2,80 @@
 #include "renderer.hpp"
 #include <glad.h>
 #include <glm/glm.hpp>
+#include <stdio.h>
+#include <string.h>
+
+// glad only covers 3.3 core, program binaries come from ARB_get_program_binary / 4.1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void (*gl_get_program_binary_fn)(GLuint program, GLsizei buffer_size, GLsizei *length, GLenum *format,
+                                         void *binary);
+typedef void (*gl_program_binary_fn)(GLuint program, GLenum format, const void *binary, GLsizei length);
+typedef void (*gl_program_parameteri_fn)(GLuint program, GLenum name, GLint value);
+// context loss is only reported through ARB_robustness, on a context created with robust access
+typedef GLenum (*gl_get_graphics_reset_status_fn)();
+
+#define SHADER_CACHE_DIR "cache"
+#define SHADER_CACHE_MAGIC 0x50425348u // "HSBP"
+#define SHADER_INFO_LOG_SIZE 4096
+#define QUAD_VERTEX_PATH "shaders/default_vertex.glsl"
+#define QUAD_FRAGMENT_PATH "shaders/default_fragment.glsl"
+#define PARTICLE_VERTEX_PATH "shaders/particle_vertex.glsl"
+#define PARTICLE_FRAGMENT_PATH "shaders/particle_fragment.glsl"
+
+/** Linked programs are cached on disk under a key hashed from both sources and the driver's vendor, renderer
+ * and version strings, so a driver update or an edited shader simply misses the cache. Drivers are allowed
+ * to reject a binary they wrote themselves, in which case the program is compiled from source again.
+ */
+struct shader_cache {
+  gl_get_program_binary_fn get_program_binary;
+  gl_program_binary_fn program_binary;
+  gl_program_parameteri_fn program_parameteri;
+  uint64_t driver_hash;
+  uint32_t loaded_count;
+  uint32_t compiled_count;
+  uint64_t time_ns;
+};
+
+struct shader_cache_header {
+  uint32_t magic;
+  uint32_t format;
+  uint64_t key;
+  uint64_t size;
+};
+
+static uint64_t hash_string(uint64_t hash, const char *str) {
+  // FNV-1a
+  for (const char *c = str; *c != '\0'; c++) {
+    hash = (hash ^ (uint8_t)*c) * 0x100000001B3ull;
+  }
+  return hash;
+}
+
+static shader_cache shader_cache_init() {
+  shader_cache cache = {};
+  GLint format_count = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+  glGetError(); // not an error when the driver doesn't know the enum, the cache just stays off
+  if (format_count > 0) {
+    cache.get_program_binary = (gl_get_program_binary_fn)platform_gl_get_proc_address("glGetProgramBinary");
+    cache.program_binary = (gl_program_binary_fn)platform_gl_get_proc_address("glProgramBinary");
+    cache.program_parameteri = (gl_program_parameteri_fn)platform_gl_get_proc_address("glProgramParameteri");
+  }
+  if (cache.get_program_binary == NULL || cache.program_binary == NULL || cache.program_parameteri == NULL) {
+    cache = {};
+    platform_log_info("Program binaries are not supported, shaders are compiled on every launch");
+    return cache;
+  }
+
+  cache.driver_hash = 0xCBF29CE484222325ull;
+  cache.driver_hash = hash_string(cache.driver_hash, (const char *)glGetString(GL_VENDOR));
+  cache.driver_hash = hash_string(cache.driver_hash, (const char *)glGetString(GL_RENDERER));
+  cache.driver_hash = hash_string(cache.driver_hash, (const char *)glGetString(GL_VERSION));
+  platform_create_directory(SHADER_CACHE_DIR);
+  return cache;
+}
 
 static char *load_shader(const char *path, mem_allocator *allocator) {
   size_t file_size;
@@ -12,58 +86,543 @@ static char *load_shader(const char *path, mem_allocator *allocator) {
   return file_memory;
 }
 
-static GLuint compile_shader(GLenum kind, const char *src) {
+static GLuint compile_shader(GLenum kind, const char *src, const char *path) {
   GLuint shader = glCreateShader(kind);
   glShaderSource(shader, 1, &src, NULL);
   glCompileShader(shader);
+
+  GLint status;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+  if (status != GL_TRUE) {
+    char info_log[SHADER_INFO_LOG_SIZE];
+    glGetShaderInfoLog(shader, sizeof(info_log), NULL, info_log);
+    platform_log_error("Shader %s failed to compile:", path);
+    for (char *line = strtok(info_log, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+      platform_log_error("  %s", line);
+    }
+    glDeleteShader(shader);
+    return 0;
+  }
   return shader;
 };
 
-static GLuint load_sprite_texture(uint8_t pixels[], int width, int height) {
+static bool load_cached_program(shader_cache *cache, GLuint program, const char *cache_path, uint64_t key,
+                                mem_allocator *allocator) {
+  if (!platform_file_exists(cache_path)) {
+    return false;
+  }
+  size_t file_size;
+  platform_get_file_size(cache_path, &file_size);
+  if (file_size < sizeof(shader_cache_header)) {
+    return false;
+  }
+  uint8_t *file_memory = allocator_alloc(allocator, uint8_t, file_size);
+  platform_read_entire_file(cache_path, file_size, file_memory);
+  shader_cache_header *header = (shader_cache_header *)file_memory;
+  if (header->magic != SHADER_CACHE_MAGIC || header->key != key ||
+      header->size != file_size - sizeof(shader_cache_header)) {
+    return false;
+  }
+
+  cache->program_binary(program, header->format, file_memory + sizeof(shader_cache_header),
+                        (GLsizei)header->size);
+  GLint status;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  return status == GL_TRUE;
+}
+
+static void store_cached_program(shader_cache *cache, GLuint program, const char *cache_path, uint64_t key,
+                                 mem_allocator *allocator) {
+  GLint size = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+  if (size <= 0) {
+    return;
+  }
+  uint8_t *file_memory = allocator_alloc(allocator, uint8_t, sizeof(shader_cache_header) + size);
+  shader_cache_header *header = (shader_cache_header *)file_memory;
+  GLenum format;
+  GLsizei written = 0;
+  cache->get_program_binary(program, size, &written, &format, file_memory + sizeof(shader_cache_header));
+  *header = (shader_cache_header){
+      .magic = SHADER_CACHE_MAGIC,
+      .format = format,
+      .key = key,
+      .size = (uint64_t)written,
+  };
+  platform_write_file(cache_path, sizeof(shader_cache_header) + written, file_memory);
+}
+
+// Returns 0 when a shader doesn't compile or the program doesn't link, the log says why.
+static GLuint create_program(shader_cache *cache, const char *vertex_path, const char *fragment_path,
+                             mem_allocator *allocator) {
+  uint64_t start = platform_get_time_ns();
+  GLuint program = glCreateProgram();
+  char *vertex_shader_src = load_shader(vertex_path, allocator);
+  char *fragment_shader_src = load_shader(fragment_path, allocator);
+
+  bool use_cache = cache->program_binary != NULL;
+  uint64_t key = hash_string(hash_string(cache->driver_hash, vertex_shader_src), fragment_shader_src);
+  char cache_path[64];
+  snprintf(cache_path, sizeof(cache_path), SHADER_CACHE_DIR "/%016llx.bin", (unsigned long long)key);
+  if (use_cache && load_cached_program(cache, program, cache_path, key, allocator)) {
+    cache->loaded_count++;
+    cache->time_ns += platform_get_time_ns() - start;
+    return program;
+  }
+
+  GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_shader_src, vertex_path);
+  GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_shader_src, fragment_path);
+  if (vertex_shader == 0 || fragment_shader == 0) {
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    glDeleteProgram(program);
+    return 0;
+  }
+  glAttachShader(program, vertex_shader);
+  glAttachShader(program, fragment_shader);
+  if (use_cache) {
+    cache->program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  }
+  glLinkProgram(program);
+  glDetachShader(program, vertex_shader);
+  glDetachShader(program, fragment_shader);
+  glDeleteShader(vertex_shader);
+  glDeleteShader(fragment_shader);
+
+  GLint status;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+  if (status != GL_TRUE) {
+    char info_log[SHADER_INFO_LOG_SIZE];
+    glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
+    platform_log_error("Program %s + %s failed to link:", vertex_path, fragment_path);
+    for (char *line = strtok(info_log, "\n"); line != NULL; line = strtok(NULL, "\n")) {
+      platform_log_error("  %s", line);
+    }
+    glDeleteProgram(program);
+    return 0;
+  }
+
+  if (use_cache) {
+    store_cached_program(cache, program, cache_path, key, allocator);
+  }
+  cache->compiled_count++;
+  cache->time_ns += platform_get_time_ns() - start;
+  return program;
+}
+
+#define GL_STATE_UNKNOWN 0xFFFFFFFFu
+#define GL_STATE_TEXTURE_UNITS 4
+#define GL_STATE_MAX_UNIFORMS 32
+
+struct gl_uniform_value {
+  GLuint program;
+  GLint location;
+  uint32_t words[16];
+};
+
+/** Mirrors the GL state the renderer touches so calls that wouldn't change anything never reach the driver.
+ * Anything set to GL_STATE_UNKNOWN is issued unconditionally the next time, which is what invalidating does
+ * after someone else may have touched the context. Uniform values are remembered per program and location.
+ * Every cached call counts as issued or elided, texture binds that reached the driver are also counted apart.
+ */
+struct gl_state {
+  GLuint program;
+  GLuint vertex_array;
+  uint32_t active_unit;
+  GLuint textures[GL_STATE_TEXTURE_UNITS];
+  uint32_t blend;
+  uint32_t depth_test;
+  uint32_t depth_mask;
+  gl_uniform_value uniforms[GL_STATE_MAX_UNIFORMS];
+  uint32_t uniform_count;
+  uint32_t issued_count;
+  uint32_t elided_count;
+  uint32_t texture_bind_count;
+};
+
+static void gl_state_invalidate(gl_state *gl) {
+  gl->program = GL_STATE_UNKNOWN;
+  gl->vertex_array = GL_STATE_UNKNOWN;
+  gl->active_unit = GL_STATE_UNKNOWN;
+  for (uint32_t i = 0; i < GL_STATE_TEXTURE_UNITS; i++) {
+    gl->textures[i] = GL_STATE_UNKNOWN;
+  }
+  gl->blend = GL_STATE_UNKNOWN;
+  gl->depth_test = GL_STATE_UNKNOWN;
+  gl->depth_mask = GL_STATE_UNKNOWN;
+  gl->uniform_count = 0;
+}
+
+// Returns true when the cached value already matches, otherwise records the new one.
+static bool gl_state_matches(gl_state *gl, uint32_t *cached, uint32_t value) {
+  if (*cached == value) {
+    gl->elided_count++;
+    return true;
+  }
+  *cached = value;
+  gl->issued_count++;
+  return false;
+}
+
+static void gl_use_program(gl_state *gl, GLuint program) {
+  if (!gl_state_matches(gl, &gl->program, program)) {
+    glUseProgram(program);
+  }
+}
+
+static void gl_bind_vertex_array(gl_state *gl, GLuint vertex_array) {
+  if (!gl_state_matches(gl, &gl->vertex_array, vertex_array)) {
+    glBindVertexArray(vertex_array);
+  }
+}
+
+static void gl_bind_texture(gl_state *gl, uint32_t unit, GLuint texture) {
+  assert(unit < GL_STATE_TEXTURE_UNITS);
+  if (gl->textures[unit] == texture) {
+    gl->elided_count++;
+    return;
+  }
+  if (!gl_state_matches(gl, &gl->active_unit, unit)) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+  }
+  gl_state_matches(gl, &gl->textures[unit], texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  gl->texture_bind_count++;
+}
+
+// Deleting a bound texture or vertex array unbinds it, and GL may hand the same name out again.
+static void gl_forget_texture(gl_state *gl, GLuint texture) {
+  for (uint32_t i = 0; i < GL_STATE_TEXTURE_UNITS; i++) {
+    if (gl->textures[i] == texture) {
+      gl->textures[i] = 0;
+    }
+  }
+}
+
+static void gl_forget_vertex_array(gl_state *gl, GLuint vertex_array) {
+  if (gl->vertex_array == vertex_array) {
+    gl->vertex_array = 0;
+  }
+}
+
+static void gl_forget_program(gl_state *gl, GLuint program) {
+  if (gl->program == program) {
+    gl->program = GL_STATE_UNKNOWN;
+  }
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < gl->uniform_count; i++) {
+    if (gl->uniforms[i].program != program) {
+      gl->uniforms[kept++] = gl->uniforms[i];
+    }
+  }
+  gl->uniform_count = kept;
+}
+
+static void gl_set_capability(gl_state *gl, uint32_t *cached, GLenum capability, bool enabled) {
+  if (gl_state_matches(gl, cached, enabled)) {
+    return;
+  }
+  if (enabled) {
+    glEnable(capability);
+  } else {
+    glDisable(capability);
+  }
+}
+
+static void gl_set_blend(gl_state *gl, bool enabled) { gl_set_capability(gl, &gl->blend, GL_BLEND, enabled); }
+
+static void gl_set_depth_test(gl_state *gl, bool enabled) {
+  gl_set_capability(gl, &gl->depth_test, GL_DEPTH_TEST, enabled);
+}
+
+static void gl_set_depth_mask(gl_state *gl, bool enabled) {
+  if (!gl_state_matches(gl, &gl->depth_mask, enabled)) {
+    glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+  }
+}
+
+// Uniforms are set on the bound program, so the value is cached under it.
+static bool gl_uniform_matches(gl_state *gl, GLint location, const void *value, size_t size) {
+  assert(gl->program != GL_STATE_UNKNOWN && size <= sizeof(gl_uniform_value::words));
+  gl_uniform_value *entry = NULL;
+  for (uint32_t i = 0; i < gl->uniform_count; i++) {
+    if (gl->uniforms[i].program == gl->program && gl->uniforms[i].location == location) {
+      entry = &gl->uniforms[i];
+      break;
+    }
+  }
+  if (entry != NULL && memcmp(entry->words, value, size) == 0) {
+    gl->elided_count++;
+    return true;
+  }
+  if (entry == NULL && gl->uniform_count < GL_STATE_MAX_UNIFORMS) {
+    entry = &gl->uniforms[gl->uniform_count++];
+    entry->program = gl->program;
+    entry->location = location;
+  }
+  if (entry != NULL) {
+    memcpy(entry->words, value, size);
+  }
+  gl->issued_count++;
+  return false;
+}
+
+static void gl_uniform_mat4(gl_state *gl, GLint location, const glm::mat4 &value) {
+  if (!gl_uniform_matches(gl, location, glm::value_ptr(value), sizeof(value))) {
+    glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+  }
+}
+
+static void gl_uniform_int(gl_state *gl, GLint location, GLint value) {
+  if (!gl_uniform_matches(gl, location, &value, sizeof(value))) {
+    glUniform1i(location, value);
+  }
+}
+
+// Without pixels only the storage is allocated, the upload queue fills it in later.
+static GLuint load_sprite_texture(gl_state *gl, uint8_t pixels[], int width, int height, bool mipmaps) {
   GLuint texture;
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
   glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
+  gl_bind_texture(gl, 0, texture);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipmaps ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-  glGenerateMipmap(GL_TEXTURE_2D);
+  if (pixels != NULL && mipmaps) {
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
   return texture;
 }
 
+static GLuint load_glyph_texture(gl_state *gl, uint8_t pixels[], int width, int height) {
+  GLuint texture;
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glGenTextures(1, &texture);
+  gl_bind_texture(gl, 0, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, width, height, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  return texture;
+}
+
+struct render_texture {
+  GLuint gl_texture;
+  bool in_use;
+  bool single_channel;
+  bool mipmaps;
+  bool pending;
+  uint32_t width;
+  uint32_t height;
+  uint64_t bytes;
+  uint64_t last_used_frame;
+  render_texture_reload_fn reload;
+  void *reload_user;
+  uint32_t reload_index;
+};
+
+struct render_upload {
+  uint32_t texture_id;
+  const uint8_t *data;
+  uint32_t next_row;
+};
+
+struct render_capture_buffer {
+  GLuint buffer;
+  uintptr_t size;
+  GLsync fence;
+  uint32_t width;
+  uint32_t height;
+  uint64_t frame_index;
+};
+
+struct batch_vertex {
+  glm::vec3 pos;
+  glm::vec2 uv;
+  glm::vec4 color;
+  float single_channel;
+};
+
+struct render_mesh {
+  unsigned int vao;
+  unsigned int vbo;
+  uint32_t quad_count;
+  // emptied by a lost context until it is loaded again
+  bool lost;
+};
+
 struct renderer {
+  shader_cache shader_cache;
+  gl_get_graphics_reset_status_fn get_reset_status;
+  gl_state gl;
+  uint32_t last_issued_count;
+  uint32_t last_elided_count;
+  uint32_t last_texture_bind_count;
+  uint32_t last_draw_call_count;
   GLuint quad_program;
   unsigned int quad_vbo;
   unsigned int quad_vao;
   unsigned int quad_ebo;
+  unsigned int mesh_ebo;
+  unsigned int batch_vao;
+  unsigned int batch_vbo;
+  batch_vertex batch_vertices[RENDERER_MAX_BATCH_QUADS * 4];
+  uint32_t batch_quad_count;
+  GLuint batch_texture;
+  uint32_t draw_call_count;
+  render_mesh meshes[RENDERER_MAX_MESHES];
+  GLuint particle_program;
+  unsigned int particle_vao;
+  unsigned int instance_vbo;
+  uint32_t mapped_instances;
+  unsigned int debug_vao;
+  unsigned int debug_vbo;
   GLuint empty_texture;
+  render_texture textures[RENDERER_MAX_TEXTURES];
+  uint64_t texture_budget;
+  uint64_t resident_texture_bytes;
+  uint32_t evicted_texture_count;
+  uint32_t reloaded_texture_count;
+  uint64_t frame_index;
+  mem_allocator *temp_allocator;
+  render_upload uploads[RENDERER_MAX_UPLOADS];
+  uint32_t upload_head;
+  uint32_t upload_tail;
+  uint64_t upload_budget;
+  GLuint upload_buffers[RENDERER_UPLOAD_BUFFERS];
+  GLsync upload_fences[RENDERER_UPLOAD_BUFFERS];
+  uint32_t upload_buffer_index;
+  render_capture_buffer captures[RENDERER_CAPTURE_BUFFERS];
+  uint32_t capture_head;
+  uint32_t capture_tail;
   glm::vec2 framebuffer_size;
+  GLuint scene_fbo;
+  GLuint scene_color;
+  GLuint scene_depth;
+  glm::ivec2 scene_size;
+  // stands in for the window's framebuffer when drawing offscreen, 0 draws to the window
+  bool offscreen;
+  GLuint window_fbo;
+  GLuint window_color;
+  GLuint window_depth;
+  float render_scale;
+  render_resolution_config resolution;
+  GLuint timer_queries[RENDERER_TIMER_QUERIES];
+  bool timer_pending[RENDERER_TIMER_QUERIES];
+  float scene_gpu_ms;
+  uint32_t frames_since_rescale;
+  bool ui_layer;
   glm::vec2 camera_pos;
   GLint model_loc;
   GLint view_loc;
   GLint projection_loc;
   GLint texture_loc;
-  GLint color_loc;
-  GLint single_channel_loc;
+  GLint particle_view_loc;
+  GLint particle_projection_loc;
+  GLint particle_texture_loc;
+  glm::mat4 view;
+  glm::mat4 projection;
 };
 
-renderer renderer_init(int framebuffer_width, int framebuffer_height, mem_allocator *temp_allocator) {
-  renderer renderer = {.framebuffer_size = glm::vec2(static_cast<float>(framebuffer_width),
-                                                     static_cast<float>(framebuffer_height))};
+static void cache_uniform_locations(renderer *renderer) {
+  renderer->model_loc = glGetUniformLocation(renderer->quad_program, "model");
+  renderer->view_loc = glGetUniformLocation(renderer->quad_program, "view");
+  renderer->projection_loc = glGetUniformLocation(renderer->quad_program, "projection");
+  renderer->texture_loc = glGetUniformLocation(renderer->quad_program, "uTexture");
+  renderer->particle_view_loc = glGetUniformLocation(renderer->particle_program, "view");
+  renderer->particle_projection_loc = glGetUniformLocation(renderer->particle_program, "projection");
+  renderer->particle_texture_loc = glGetUniformLocation(renderer->particle_program, "uTexture");
+}
 
-  // Create quad program
-  renderer.quad_program = glCreateProgram();
-  char *vertex_shader_src = load_shader("shaders/default_vertex.glsl", temp_allocator);
-  GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_shader_src);
-  glAttachShader(renderer.quad_program, vertex_shader);
-  char *fragment_shader_src = load_shader("shaders/default_fragment.glsl", temp_allocator);
-  GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_shader_src);
-  glAttachShader(renderer.quad_program, fragment_shader);
-  glLinkProgram(renderer.quad_program);
-  glDeleteShader(vertex_shader);
-  glDeleteShader(fragment_shader);
+// The target is always allocated at the window size, lower scales only draw into its bottom left corner.
+static void create_scene_target(renderer *renderer) {
+  if (renderer->scene_fbo != 0) {
+    glDeleteFramebuffers(1, &renderer->scene_fbo);
+    glDeleteTextures(1, &renderer->scene_color);
+    gl_forget_texture(&renderer->gl, renderer->scene_color);
+    glDeleteRenderbuffers(1, &renderer->scene_depth);
+  }
+  int width = glm::max((int)renderer->framebuffer_size.x, 1);
+  int height = glm::max((int)renderer->framebuffer_size.y, 1);
+
+  glGenTextures(1, &renderer->scene_color);
+  gl_bind_texture(&renderer->gl, 0, renderer->scene_color);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glGenRenderbuffers(1, &renderer->scene_depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderer->scene_depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+  glGenFramebuffers(1, &renderer->scene_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, renderer->scene_fbo);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->scene_color, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderer->scene_depth);
+  assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+static void delete_window_target(renderer *renderer) {
+  if (renderer->window_fbo == 0) {
+    return;
+  }
+  glDeleteFramebuffers(1, &renderer->window_fbo);
+  glDeleteRenderbuffers(1, &renderer->window_color);
+  glDeleteRenderbuffers(1, &renderer->window_depth);
+  renderer->window_fbo = 0;
+  renderer->window_color = 0;
+  renderer->window_depth = 0;
+}
+
+// Only sampled by readbacks, so renderbuffers are enough.
+static void create_window_target(renderer *renderer) {
+  delete_window_target(renderer);
+  if (!renderer->offscreen) {
+    return;
+  }
+  int width = glm::max((int)renderer->framebuffer_size.x, 1);
+  int height = glm::max((int)renderer->framebuffer_size.y, 1);
+  glGenRenderbuffers(1, &renderer->window_color);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderer->window_color);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+  glGenRenderbuffers(1, &renderer->window_depth);
+  glBindRenderbuffer(GL_RENDERBUFFER, renderer->window_depth);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+  glGenFramebuffers(1, &renderer->window_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, renderer->window_fbo);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderer->window_color);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderer->window_depth);
+  assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/** Creates everything the renderer owns on the GL context, at init and again on a new context after the
+ * old one was lost. Textures and meshes are not part of it, they belong to whoever loaded them.
+ */
+static void create_gl_objects(renderer *renderer) {
+  renderer->get_reset_status =
+      (gl_get_graphics_reset_status_fn)platform_gl_get_proc_address("glGetGraphicsResetStatusARB");
+
+  // Create programs
+  renderer->shader_cache = shader_cache_init();
+  mem_allocator *temp_allocator = renderer->temp_allocator;
+  renderer->quad_program =
+      create_program(&renderer->shader_cache, QUAD_VERTEX_PATH, QUAD_FRAGMENT_PATH, temp_allocator);
+  renderer->particle_program =
+      create_program(&renderer->shader_cache, PARTICLE_VERTEX_PATH, PARTICLE_FRAGMENT_PATH, temp_allocator);
+  if (renderer->quad_program == 0 || renderer->particle_program == 0) {
+    platform_log_flush();
+    assert(false && "Shaders failed to build");
+  }
+  platform_log_info("Shaders ready in %.2fms (%u from cache, %u compiled)",
+                    renderer->shader_cache.time_ns / 1e6, renderer->shader_cache.loaded_count,
+                    renderer->shader_cache.compiled_count);
 
   // Create quad VAO
   float quad_vertices[] = {
@@ -74,14 +633,14 @@ renderer renderer_init(int framebuffer_width, int framebuffer_height, mem_alloca
       -0.5f, 0.5f,  0.0f, 0.0f, 0.0f  // top left
   };
   unsigned int quad_indices[] = {0, 1, 3, 1, 2, 3};
-  glGenVertexArrays(1, &renderer.quad_vao);
-  glGenBuffers(1, &renderer.quad_vbo);
-  glGenBuffers(1, &renderer.quad_ebo);
-  glBindVertexArray(renderer.quad_vao);
+  glGenVertexArrays(1, &renderer->quad_vao);
+  glGenBuffers(1, &renderer->quad_vbo);
+  glGenBuffers(1, &renderer->quad_ebo);
+  gl_bind_vertex_array(&renderer->gl, renderer->quad_vao);
 
-  glBindBuffer(GL_ARRAY_BUFFER, renderer.quad_vbo);
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->quad_vbo);
   glBufferData(GL_ARRAY_BUFFER, sizeof(quad_vertices), quad_vertices, GL_STATIC_DRAW);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer.quad_ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->quad_ebo);
   glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quad_indices), quad_indices, GL_STATIC_DRAW);
 
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float),
@@ -92,27 +651,171 @@ renderer renderer_init(int framebuffer_width, int framebuffer_height, mem_alloca
                         (void *)(3 * sizeof(float))); // color
   glEnableVertexAttribArray(1);
 
+  // Create the index buffer shared by all meshes
+  uint32_t *mesh_indices = allocator_alloc(temp_allocator, uint32_t, RENDERER_MAX_MESH_QUADS * 6);
+  for (uint32_t i = 0; i < RENDERER_MAX_MESH_QUADS; i++) {
+    for (uint32_t j = 0; j < 6; j++) {
+      mesh_indices[i * 6 + j] = i * 4 + quad_indices[j];
+    }
+  }
+  // unbind the quad VAO first so it keeps its own element buffer
+  gl_bind_vertex_array(&renderer->gl, 0);
+  glGenBuffers(1, &renderer->mesh_ebo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->mesh_ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32_t) * RENDERER_MAX_MESH_QUADS * 6, mesh_indices,
+               GL_STATIC_DRAW);
+
+  // Create the batch VAO, quads are written on the CPU and share the mesh index buffer
+  glGenVertexArrays(1, &renderer->batch_vao);
+  glGenBuffers(1, &renderer->batch_vbo);
+  gl_bind_vertex_array(&renderer->gl, renderer->batch_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->batch_vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(renderer->batch_vertices), NULL, GL_STREAM_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->mesh_ebo);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(batch_vertex), (void *)offsetof(batch_vertex, pos));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(batch_vertex), (void *)offsetof(batch_vertex, uv));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(batch_vertex),
+                        (void *)offsetof(batch_vertex, color));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(batch_vertex),
+                        (void *)offsetof(batch_vertex, single_channel));
+  glEnableVertexAttribArray(3);
+  gl_bind_vertex_array(&renderer->gl, 0);
+
+  // Create particle VAO, reusing the quad geometry with one instance per particle
+  glGenVertexArrays(1, &renderer->particle_vao);
+  glGenBuffers(1, &renderer->instance_vbo);
+  gl_bind_vertex_array(&renderer->gl, renderer->particle_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->quad_vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->quad_ebo);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->instance_vbo);
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(render_instance),
+                        (void *)offsetof(render_instance, pos_size));
+  glVertexAttribDivisor(2, 1);
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(render_instance),
+                        (void *)offsetof(render_instance, color));
+  glVertexAttribDivisor(3, 1);
+  glEnableVertexAttribArray(3);
+  gl_bind_vertex_array(&renderer->gl, 0);
+
+  // Create the debug VAO, only position and color come from the vertices
+  glGenVertexArrays(1, &renderer->debug_vao);
+  glGenBuffers(1, &renderer->debug_vbo);
+  gl_bind_vertex_array(&renderer->gl, renderer->debug_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->debug_vbo);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(render_debug_vertex),
+                        (void *)offsetof(render_debug_vertex, pos));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(render_debug_vertex),
+                        (void *)offsetof(render_debug_vertex, color));
+  glEnableVertexAttribArray(2);
+  gl_bind_vertex_array(&renderer->gl, 0);
+
   // Create empty texture
   uint8_t white[4] = {255, 255, 255, 255};
-  renderer.empty_texture = load_sprite_texture(white, 1, 1);
+  renderer->empty_texture = load_sprite_texture(&renderer->gl, white, 1, 1, false);
+
+  // Create the pixel buffers texture uploads rotate through
+  glGenBuffers(RENDERER_UPLOAD_BUFFERS, renderer->upload_buffers);
+  for (uint32_t i = 0; i < RENDERER_UPLOAD_BUFFERS; i++) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer->upload_buffers[i]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, renderer->upload_budget, NULL, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
 
-  // Cache uniform locations
-  renderer.model_loc = glGetUniformLocation(renderer.quad_program, "model");
-  renderer.view_loc = glGetUniformLocation(renderer.quad_program, "view");
-  renderer.projection_loc = glGetUniformLocation(renderer.quad_program, "projection");
-  renderer.texture_loc = glGetUniformLocation(renderer.quad_program, "uTexture");
-  renderer.color_loc = glGetUniformLocation(renderer.quad_program, "uColor");
-  renderer.single_channel_loc = glGetUniformLocation(renderer.quad_program, "uIsSingleChannel");
+  // Create the offscreen scene target and the queries timing it
+  create_scene_target(renderer);
+  create_window_target(renderer);
+  glGenQueries(RENDERER_TIMER_QUERIES, renderer->timer_queries);
 
-  glEnable(GL_DEPTH_TEST);
+  cache_uniform_locations(renderer);
+
+  gl_set_depth_test(&renderer->gl, true);
+  gl_set_depth_mask(&renderer->gl, true);
   glDepthFunc(GL_LEQUAL);
-  glEnable(GL_BLEND);
+  gl_set_blend(&renderer->gl, true);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+}
+
+static void create_mesh_buffers(renderer *renderer, render_mesh *mesh) {
+  glGenVertexArrays(1, &mesh->vao);
+  glGenBuffers(1, &mesh->vbo);
+  gl_bind_vertex_array(&renderer->gl, mesh->vao);
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, renderer->mesh_ebo);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(render_vertex),
+                        (void *)offsetof(render_vertex, pos));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(render_vertex), (void *)offsetof(render_vertex, uv));
+  glEnableVertexAttribArray(1);
+}
+
+renderer renderer_init(int framebuffer_width, int framebuffer_height, mem_allocator *temp_allocator) {
+  renderer renderer = {.framebuffer_size = glm::vec2(static_cast<float>(framebuffer_width),
+                                                     static_cast<float>(framebuffer_height))};
+  renderer.texture_budget = RENDERER_DEFAULT_TEXTURE_BUDGET;
+  renderer.upload_budget = RENDERER_DEFAULT_UPLOAD_BUDGET;
+  renderer.temp_allocator = temp_allocator;
+  gl_state_invalidate(&renderer.gl);
+  renderer.render_scale = 1.0f;
+  renderer.resolution = (render_resolution_config){
+      .target_frame_ms = RENDERER_DEFAULT_TARGET_FRAME_MS,
+      .min_scale = RENDERER_DEFAULT_MIN_SCALE,
+      .max_scale = 1.0f,
+  };
+
+  create_gl_objects(&renderer);
   return renderer;
 }
 
 void renderer_destroy(renderer *renderer) {
+  for (uint32_t i = 0; i < RENDERER_MAX_MESHES; i++) {
+    if (renderer->meshes[i].vao != 0) {
+      glDeleteBuffers(1, &renderer->meshes[i].vbo);
+      glDeleteVertexArrays(1, &renderer->meshes[i].vao);
+    }
+  }
+  for (uint32_t i = 0; i < RENDERER_MAX_TEXTURES; i++) {
+    if (renderer->textures[i].gl_texture != 0) {
+      glDeleteTextures(1, &renderer->textures[i].gl_texture);
+    }
+  }
+  for (uint32_t i = 0; i < RENDERER_UPLOAD_BUFFERS; i++) {
+    if (renderer->upload_fences[i] != NULL) {
+      glDeleteSync(renderer->upload_fences[i]);
+    }
+  }
+  glDeleteBuffers(RENDERER_UPLOAD_BUFFERS, renderer->upload_buffers);
+  for (uint32_t i = 0; i < RENDERER_CAPTURE_BUFFERS; i++) {
+    render_capture_buffer *capture = &renderer->captures[i];
+    if (capture->fence != NULL) {
+      glDeleteSync(capture->fence);
+    }
+    if (capture->buffer != 0) {
+      glDeleteBuffers(1, &capture->buffer);
+    }
+  }
+  glDeleteQueries(RENDERER_TIMER_QUERIES, renderer->timer_queries);
+  glDeleteFramebuffers(1, &renderer->scene_fbo);
+  glDeleteTextures(1, &renderer->scene_color);
+  glDeleteRenderbuffers(1, &renderer->scene_depth);
+  delete_window_target(renderer);
+  glDeleteBuffers(1, &renderer->batch_vbo);
+  glDeleteVertexArrays(1, &renderer->batch_vao);
+  glDeleteBuffers(1, &renderer->mesh_ebo);
+  glDeleteBuffers(1, &renderer->instance_vbo);
+  glDeleteVertexArrays(1, &renderer->particle_vao);
+  glDeleteBuffers(1, &renderer->debug_vbo);
+  glDeleteVertexArrays(1, &renderer->debug_vao);
+  glDeleteProgram(renderer->particle_program);
   glDeleteBuffers(1, &renderer->quad_vbo);
   glDeleteBuffers(1, &renderer->quad_ebo);
   glDeleteVertexArrays(1, &renderer->quad_vao);
@@ -120,35 +823,581 @@ void renderer_destroy(renderer *renderer) {
   glDeleteProgram(renderer->quad_program);
 }
 
+static void evict_textures(renderer *renderer, uint64_t incoming_bytes) {
+  while (renderer->resident_texture_bytes + incoming_bytes > renderer->texture_budget) {
+    // textures drawn this frame stay, their draws are already issued
+    render_texture *victim = NULL;
+    for (uint32_t i = 0; i < RENDERER_MAX_TEXTURES; i++) {
+      render_texture *texture = &renderer->textures[i];
+      if (texture->gl_texture == 0 || texture->reload == NULL || texture->pending ||
+          texture->last_used_frame == renderer->frame_index) {
+        continue;
+      }
+      if (victim == NULL || texture->last_used_frame < victim->last_used_frame) {
+        victim = texture;
+      }
+    }
+    if (victim == NULL) {
+      return;
+    }
+    glDeleteTextures(1, &victim->gl_texture);
+    gl_forget_texture(&renderer->gl, victim->gl_texture);
+    victim->gl_texture = 0;
+    renderer->resident_texture_bytes -= victim->bytes;
+    renderer->evicted_texture_count++;
+  }
+}
+
+// Textures without pixels have nothing to upload, and would never finish in the queue.
+static bool queue_upload(renderer *renderer, uint32_t texture_id, const uint8_t *data) {
+  render_texture *texture = &renderer->textures[texture_id - 1];
+  if (texture->width == 0 || texture->height == 0) {
+    return false;
+  }
+  assert(renderer->upload_tail - renderer->upload_head < RENDERER_MAX_UPLOADS && "Upload queue is full");
+  renderer->uploads[renderer->upload_tail++ % RENDERER_MAX_UPLOADS] = (render_upload){
+      .texture_id = texture_id,
+      .data = data,
+  };
+  return true;
+}
+
+/** Glyphs and reloads are uploaded right away, glyphs are tiny and reloaded pixels only live in the temp
+ * allocator until the end of the frame. Everything else gets its storage now and its pixels through the
+ * upload queue.
+ */
+static void upload_texture(renderer *renderer, uint32_t texture_id, uint8_t *data, bool immediate) {
+  render_texture *texture = &renderer->textures[texture_id - 1];
+  evict_textures(renderer, texture->bytes);
+  if (texture->single_channel) {
+    texture->gl_texture = load_glyph_texture(&renderer->gl, data, texture->width, texture->height);
+  } else if (immediate) {
+    texture->gl_texture =
+        load_sprite_texture(&renderer->gl, data, texture->width, texture->height, texture->mipmaps);
+  } else {
+    texture->gl_texture =
+        load_sprite_texture(&renderer->gl, NULL, texture->width, texture->height, texture->mipmaps);
+    texture->pending = queue_upload(renderer, texture_id, data);
+  }
+  renderer->resident_texture_bytes += texture->bytes;
+}
+
+struct render_upload_chunk {
+  uint32_t texture_id;
+  uint32_t first_row;
+  uint32_t row_count;
+  uintptr_t offset;
+};
+
+/** Copies as many rows as fit in this frame's budget into the next pixel buffer, then hands them to GL as
+ * sub-image uploads sourced from that buffer. A buffer is only reused once the fence placed after its last
+ * uploads has signaled, otherwise the queue waits for the next frame unless `wait` is set.
+ */
+static bool process_uploads(renderer *renderer, bool wait) {
+  if (renderer->upload_head == renderer->upload_tail) {
+    return false;
+  }
+  uint32_t buffer_index = renderer->upload_buffer_index;
+  GLsync *fence = &renderer->upload_fences[buffer_index];
+  if (*fence != NULL) {
+    GLenum status = glClientWaitSync(*fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? UINT64_MAX : 0);
+    if (status == GL_TIMEOUT_EXPIRED) {
+      return false;
+    }
+    glDeleteSync(*fence);
+    *fence = NULL;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer->upload_buffers[buffer_index]);
+  uint8_t *mapped = (uint8_t *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, renderer->upload_budget,
+                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT |
+                                                    GL_MAP_UNSYNCHRONIZED_BIT);
+  assert(mapped != NULL);
+
+  render_upload_chunk chunks[RENDERER_MAX_UPLOADS];
+  uint32_t chunk_count = 0;
+  uintptr_t used = 0;
+  while (renderer->upload_head != renderer->upload_tail) {
+    render_upload *upload = &renderer->uploads[renderer->upload_head % RENDERER_MAX_UPLOADS];
+    // deleted, or evicted before an update went through
+    if (upload->texture_id == 0 || renderer->textures[upload->texture_id - 1].gl_texture == 0) {
+      renderer->upload_head++;
+      continue;
+    }
+    render_texture *texture = &renderer->textures[upload->texture_id - 1];
+    uintptr_t row_bytes = texture->width * 4;
+    assert(row_bytes <= renderer->upload_budget && "Texture rows don't fit in the upload budget");
+    uint32_t row_count = glm::min((uint32_t)((renderer->upload_budget - used) / row_bytes),
+                                  texture->height - upload->next_row);
+    if (row_count == 0) {
+      break;
+    }
+    memcpy(mapped + used, upload->data + upload->next_row * row_bytes, row_count * row_bytes);
+    chunks[chunk_count++] = (render_upload_chunk){
+        .texture_id = upload->texture_id,
+        .first_row = upload->next_row,
+        .row_count = row_count,
+        .offset = used,
+    };
+    used += row_count * row_bytes;
+    upload->next_row += row_count;
+    if (upload->next_row < texture->height) {
+      break;
+    }
+    renderer->upload_head++;
+  }
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (uint32_t i = 0; i < chunk_count; i++) {
+    render_upload_chunk *chunk = &chunks[i];
+    render_texture *texture = &renderer->textures[chunk->texture_id - 1];
+    gl_bind_texture(&renderer->gl, 0, texture->gl_texture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, chunk->first_row, texture->width, chunk->row_count, GL_RGBA,
+                    GL_UNSIGNED_BYTE, (void *)chunk->offset);
+    if (chunk->first_row + chunk->row_count == texture->height) {
+      if (texture->mipmaps) {
+        glGenerateMipmap(GL_TEXTURE_2D);
+      }
+      texture->pending = false;
+    }
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+  *fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  renderer->upload_buffer_index = (buffer_index + 1) % RENDERER_UPLOAD_BUFFERS;
+  return true;
+}
+
+uint32_t renderer_get_pending_upload_count(struct renderer *renderer) {
+  return renderer->upload_tail - renderer->upload_head;
+}
+
+bool renderer_is_texture_ready(struct renderer *renderer, uint32_t texture_id) {
+  assert(texture_id != 0 && texture_id <= RENDERER_MAX_TEXTURES);
+  return !renderer->textures[texture_id - 1].pending;
+}
+
+void renderer_set_upload_budget(struct renderer *renderer, uint64_t budget_bytes) {
+  renderer_flush_uploads(renderer);
+  renderer->upload_budget = budget_bytes;
+  for (uint32_t i = 0; i < RENDERER_UPLOAD_BUFFERS; i++) {
+    if (renderer->upload_fences[i] != NULL) {
+      glClientWaitSync(renderer->upload_fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_MAX);
+      glDeleteSync(renderer->upload_fences[i]);
+      renderer->upload_fences[i] = NULL;
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, renderer->upload_buffers[i]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, budget_bytes, NULL, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void renderer_flush_uploads(struct renderer *renderer) {
+  while (renderer->upload_head != renderer->upload_tail) {
+    process_uploads(renderer, true);
+  }
+}
+
+static uint32_t create_texture(renderer *renderer, uint8_t *data, glm::vec2 size, bool single_channel,
+                               bool mipmaps, render_texture_reload_fn reload, void *reload_user,
+                               uint32_t reload_index) {
+  uint32_t texture_id = 0;
+  for (uint32_t i = 0; i < RENDERER_MAX_TEXTURES; i++) {
+    if (!renderer->textures[i].in_use) {
+      texture_id = i + 1;
+      break;
+    }
+  }
+  assert(texture_id != 0 && "Out of texture slots");
+
+  render_texture *texture = &renderer->textures[texture_id - 1];
+  uint32_t width = (uint32_t)size.x;
+  uint32_t height = (uint32_t)size.y;
+  // a full mip chain adds a third on top of the base level
+  uint64_t base_bytes = (uint64_t)width * height * (single_channel ? 1 : 4);
+  *texture = (render_texture){
+      .in_use = true,
+      .single_channel = single_channel,
+      .mipmaps = mipmaps,
+      .width = width,
+      .height = height,
+      .bytes = mipmaps ? base_bytes + base_bytes / 3 : base_bytes,
+      .last_used_frame = renderer->frame_index,
+      .reload = reload,
+      .reload_user = reload_user,
+      .reload_index = reload_index,
+  };
+  upload_texture(renderer, texture_id, data, false);
+  return texture_id;
+}
+
+// Resolves a texture id to a GL texture for drawing, marking it used and reloading it if it was evicted.
+static GLuint use_texture(renderer *renderer, uint32_t texture_id) {
+  if (texture_id == 0) {
+    return renderer->empty_texture;
+  }
+  assert(texture_id <= RENDERER_MAX_TEXTURES && renderer->textures[texture_id - 1].in_use);
+  render_texture *texture = &renderer->textures[texture_id - 1];
+  texture->last_used_frame = renderer->frame_index;
+  if (texture->gl_texture == 0 && texture->reload != NULL) {
+    uint8_t *data = texture->reload(texture->reload_user, texture->reload_index, renderer->temp_allocator);
+    if (data != NULL) {
+      upload_texture(renderer, texture_id, data, true);
+      renderer->reloaded_texture_count++;
+    }
+  }
+  return texture->gl_texture != 0 && !texture->pending ? texture->gl_texture : renderer->empty_texture;
+}
+
+void renderer_set_texture_budget(struct renderer *renderer, uint64_t budget_bytes) {
+  renderer->texture_budget = budget_bytes;
+  evict_textures(renderer, 0);
+}
+
+render_texture_stats renderer_get_texture_stats(struct renderer *renderer) {
+  render_texture_stats stats = {
+      .budget_bytes = renderer->texture_budget,
+      .resident_bytes = renderer->resident_texture_bytes,
+      .evicted_count = renderer->evicted_texture_count,
+      .reloaded_count = renderer->reloaded_texture_count,
+  };
+  for (uint32_t i = 0; i < RENDERER_MAX_TEXTURES; i++) {
+    stats.resident_count += renderer->textures[i].gl_texture != 0;
+  }
+  return stats;
+}
+
+bool renderer_is_context_lost(struct renderer *renderer) {
+  return renderer->get_reset_status != NULL && renderer->get_reset_status() != GL_NO_ERROR;
+}
+
+void renderer_handle_context_lost(struct renderer *renderer) {
+  // every name below belonged to the old context, so nothing is deleted, only forgotten
+  for (uint32_t i = 0; i < RENDERER_MAX_TEXTURES; i++) {
+    renderer->textures[i].gl_texture = 0;
+    renderer->textures[i].pending = false;
+  }
+  renderer->resident_texture_bytes = 0;
+  renderer->upload_head = renderer->upload_tail;
+  for (uint32_t i = 0; i < RENDERER_UPLOAD_BUFFERS; i++) {
+    renderer->upload_fences[i] = NULL;
+  }
+  renderer->upload_buffer_index = 0;
+  // frames still being read back went with the context
+  for (uint32_t i = 0; i < RENDERER_CAPTURE_BUFFERS; i++) {
+    renderer->captures[i] = {};
+  }
+  renderer->capture_head = renderer->capture_tail;
+  for (uint32_t i = 0; i < RENDERER_TIMER_QUERIES; i++) {
+    renderer->timer_pending[i] = false;
+  }
+  renderer->frames_since_rescale = 0;
+  renderer->batch_quad_count = 0;
+  renderer->mapped_instances = 0;
+  renderer->scene_fbo = 0;
+  renderer->window_fbo = 0;
+  gl_state_invalidate(&renderer->gl);
+
+  create_gl_objects(renderer);
+  // meshes keep their ids so their owners can load them again
+  for (uint32_t i = 0; i < RENDERER_MAX_MESHES; i++) {
+    render_mesh *mesh = &renderer->meshes[i];
+    if (mesh->vao != 0) {
+      create_mesh_buffers(renderer, mesh);
+      mesh->quad_count = 0;
+      mesh->lost = true;
+    }
+  }
+  platform_log_info("Recreated the renderer on a new GL context");
+}
+
+static void flush_batch(renderer *renderer) {
+  if (renderer->batch_quad_count == 0) {
+    return;
+  }
+  gl_use_program(&renderer->gl, renderer->quad_program);
+  gl_bind_vertex_array(&renderer->gl, renderer->batch_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->batch_vbo);
+  // orphan the previous batch so the write doesn't wait for its draw
+  glBufferData(GL_ARRAY_BUFFER, sizeof(renderer->batch_vertices), NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(batch_vertex) * 4 * renderer->batch_quad_count,
+                  renderer->batch_vertices);
+  gl_uniform_mat4(&renderer->gl, renderer->model_loc, glm::mat4(1.0f));
+  gl_bind_texture(&renderer->gl, 0, renderer->batch_texture);
+  glDrawElements(GL_TRIANGLES, renderer->batch_quad_count * 6, GL_UNSIGNED_INT, 0);
+  renderer->draw_call_count++;
+  renderer->batch_quad_count = 0;
+}
+
 static void render_quad(renderer *renderer, GLuint texture_id, glm::vec3 pos, glm::vec2 size,
-                        glm::vec4 color) {
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, texture_id);
-  glm::mat4 model = glm::mat4(1.0f);
-  model = glm::translate(model, pos);
-  model = glm::scale(model, glm::vec3(size.x, size.y, 0.0f));
-  glUniformMatrix4fv(renderer->model_loc, 1, GL_FALSE, glm::value_ptr(model));
-  glUniform4f(renderer->color_loc, color.r, color.g, color.b, color.a);
-  glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+                        glm::vec4 color, bool single_channel, glm::vec4 uv_rect, glm::mat2 basis) {
+  if (renderer->batch_quad_count == RENDERER_MAX_BATCH_QUADS ||
+      (renderer->batch_quad_count > 0 && renderer->batch_texture != texture_id)) {
+    flush_batch(renderer);
+  }
+  renderer->batch_texture = texture_id;
+
+  glm::vec3 half_x = glm::vec3(basis[0] * (size.x * 0.5f), 0.0f);
+  glm::vec3 half_y = glm::vec3(basis[1] * (size.y * 0.5f), 0.0f);
+  float flag = single_channel ? 1.0f : 0.0f;
+  batch_vertex *quad = &renderer->batch_vertices[renderer->batch_quad_count++ * 4];
+  quad[0] = (batch_vertex){pos + half_x + half_y, {uv_rect.z, uv_rect.y}, color, flag}; // top right
+  quad[1] = (batch_vertex){pos + half_x - half_y, {uv_rect.z, uv_rect.w}, color, flag}; // bottom right
+  quad[2] = (batch_vertex){pos - half_x - half_y, {uv_rect.x, uv_rect.w}, color, flag}; // bottom left
+  quad[3] = (batch_vertex){pos - half_x + half_y, {uv_rect.x, uv_rect.y}, color, flag}; // top left
 }
 
 void renderer_move_camera(struct renderer *renderer, glm::vec2 delta) {
   renderer->camera_pos = renderer->camera_pos + delta;
 }
 
+void renderer_get_view_bounds(struct renderer *renderer, glm::vec2 *min, glm::vec2 *max) {
+  *min = renderer->camera_pos;
+  *max = renderer->camera_pos + renderer->framebuffer_size;
+}
+
+/** Builds the new program before touching the old one, so a shader that doesn't compile leaves the last
+ * working version in place. Uniforms are set again by the next draw since the cache forgot the old program.
+ */
+bool renderer_reload_shader(struct renderer *renderer, const char *path) {
+  struct {
+    GLuint *program;
+    const char *vertex_path;
+    const char *fragment_path;
+  } programs[] = {
+      {&renderer->quad_program, QUAD_VERTEX_PATH, QUAD_FRAGMENT_PATH},
+      {&renderer->particle_program, PARTICLE_VERTEX_PATH, PARTICLE_FRAGMENT_PATH},
+  };
+  bool reloaded = false;
+  for (uint32_t i = 0; i < sizeof(programs) / sizeof(programs[0]); i++) {
+    if (strcmp(path, programs[i].vertex_path) != 0 && strcmp(path, programs[i].fragment_path) != 0) {
+      continue;
+    }
+    GLuint program = create_program(&renderer->shader_cache, programs[i].vertex_path,
+                                     programs[i].fragment_path, renderer->temp_allocator);
+    if (program == 0) {
+      platform_log_error("Keeping the previous version of %s", path);
+      continue;
+    }
+    flush_batch(renderer);
+    gl_forget_program(&renderer->gl, *programs[i].program);
+    glDeleteProgram(*programs[i].program);
+    *programs[i].program = program;
+    reloaded = true;
+  }
+  if (reloaded) {
+    cache_uniform_locations(renderer);
+  }
+  return reloaded;
+}
+
+void renderer_resize(struct renderer *renderer, int framebuffer_width, int framebuffer_height) {
+  renderer->framebuffer_size = glm::vec2((float)framebuffer_width, (float)framebuffer_height);
+  create_scene_target(renderer);
+  create_window_target(renderer);
+}
+
+void renderer_set_offscreen(struct renderer *renderer, bool offscreen) {
+  renderer->offscreen = offscreen;
+  create_window_target(renderer);
+}
+
+/** Reads the oldest timer query back, it was issued RENDERER_TIMER_QUERIES - 1 frames ago so it is normally
+ * done without waiting. Fill rate scales with the pixel count, so the new scale is the square root of the
+ * time ratio. Drops happen quickly, raises only after a long stretch of headroom so the scale doesn't
+ * oscillate around the target.
+ */
+static void update_render_scale(renderer *renderer) {
+  uint32_t slot = renderer->frame_index % RENDERER_TIMER_QUERIES;
+  if (!renderer->timer_pending[slot]) {
+    return;
+  }
+  GLuint available = 0;
+  glGetQueryObjectuiv(renderer->timer_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+  if (!available) {
+    return;
+  }
+  GLuint64 elapsed_ns = 0;
+  glGetQueryObjectui64v(renderer->timer_queries[slot], GL_QUERY_RESULT, &elapsed_ns);
+  renderer->timer_pending[slot] = false;
+
+  // queries still in flight were measured at the old scale
+  renderer->frames_since_rescale++;
+  if (renderer->frames_since_rescale <= RENDERER_TIMER_QUERIES) {
+    return;
+  }
+  float elapsed_ms = elapsed_ns / 1e6f;
+  renderer->scene_gpu_ms = renderer->scene_gpu_ms == 0.0f
+                               ? elapsed_ms
+                               : glm::mix(renderer->scene_gpu_ms, elapsed_ms, 0.1f);
+
+  render_resolution_config *config = &renderer->resolution;
+  float scale = renderer->render_scale;
+  if (renderer->scene_gpu_ms > config->target_frame_ms && renderer->frames_since_rescale > 8) {
+    scale *= glm::sqrt(config->target_frame_ms / renderer->scene_gpu_ms);
+    scale = glm::min(scale, renderer->render_scale - 0.05f);
+  } else if (renderer->scene_gpu_ms < config->target_frame_ms * 0.75f &&
+             renderer->frames_since_rescale > 60) {
+    scale += 0.05f;
+  }
+  scale = glm::clamp(scale, config->min_scale, config->max_scale);
+  if (scale != renderer->render_scale) {
+    renderer->render_scale = scale;
+    renderer->frames_since_rescale = 0;
+    renderer->scene_gpu_ms = 0.0f;
+  }
+}
+
 void renderer_begin_frame(struct renderer *renderer) {
-  glUseProgram(renderer->quad_program);
-  glBindVertexArray(renderer->quad_vao);
-  glUniform1i(renderer->texture_loc, 0);
-  glm::mat4 view = glm::mat4(1.0f);
-  view = glm::translate(view, glm::vec3(-renderer->camera_pos.x, -renderer->camera_pos.y, 0.0f));
-  glUniformMatrix4fv(renderer->view_loc, 1, GL_FALSE, glm::value_ptr(view));
-  glm::mat4 projection =
+  renderer->frame_index++;
+  renderer->last_draw_call_count = renderer->draw_call_count;
+  renderer->draw_call_count = 0;
+  renderer->last_issued_count = renderer->gl.issued_count;
+  renderer->last_elided_count = renderer->gl.elided_count;
+  renderer->last_texture_bind_count = renderer->gl.texture_bind_count;
+  renderer->gl.issued_count = 0;
+  renderer->gl.elided_count = 0;
+  renderer->gl.texture_bind_count = 0;
+  process_uploads(renderer, false);
+  update_render_scale(renderer);
+
+  // the projection stays in window units, only the viewport shrinks
+  renderer->scene_size = glm::max(glm::ivec2(renderer->framebuffer_size * renderer->render_scale + 0.5f),
+                                  glm::ivec2(1));
+  glBindFramebuffer(GL_FRAMEBUFFER, renderer->scene_fbo);
+  glViewport(0, 0, renderer->scene_size.x, renderer->scene_size.y);
+  glBeginQuery(GL_TIME_ELAPSED, renderer->timer_queries[renderer->frame_index % RENDERER_TIMER_QUERIES]);
+  renderer->ui_layer = false;
+
+  gl_use_program(&renderer->gl, renderer->quad_program);
+  gl_uniform_int(&renderer->gl, renderer->texture_loc, 0);
+  renderer->view = glm::mat4(1.0f);
+  renderer->view =
+      glm::translate(renderer->view, glm::vec3(-renderer->camera_pos.x, -renderer->camera_pos.y, 0.0f));
+  gl_uniform_mat4(&renderer->gl, renderer->view_loc, renderer->view);
+  renderer->projection =
       glm::ortho(0.0f, renderer->framebuffer_size.x, 0.0f, renderer->framebuffer_size.y, -1.0f, 10.0f);
-  glUniformMatrix4fv(renderer->projection_loc, 1, GL_FALSE, glm::value_ptr(projection));
+  gl_uniform_mat4(&renderer->gl, renderer->projection_loc, renderer->projection);
+}
+
+void renderer_begin_ui_layer(struct renderer *renderer) {
+  assert(!renderer->ui_layer);
+  flush_batch(renderer);
+  glEndQuery(GL_TIME_ELAPSED);
+  renderer->timer_pending[renderer->frame_index % RENDERER_TIMER_QUERIES] = true;
+
+  glm::ivec2 window_size = glm::ivec2(renderer->framebuffer_size);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->scene_fbo);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer->window_fbo);
+  glBlitFramebuffer(0, 0, renderer->scene_size.x, renderer->scene_size.y, 0, 0, window_size.x, window_size.y,
+                    GL_COLOR_BUFFER_BIT, renderer->scene_size == window_size ? GL_NEAREST : GL_LINEAR);
+  glBindFramebuffer(GL_FRAMEBUFFER, renderer->window_fbo);
+  glViewport(0, 0, window_size.x, window_size.y);
+  glClear(GL_DEPTH_BUFFER_BIT);
+
+  gl_use_program(&renderer->gl, renderer->quad_program);
+  renderer->view = glm::mat4(1.0f);
+  gl_uniform_mat4(&renderer->gl, renderer->view_loc, renderer->view);
+  renderer->ui_layer = true;
+}
+
+void renderer_end_frame(struct renderer *renderer) {
+  if (!renderer->ui_layer) {
+    renderer_begin_ui_layer(renderer);
+  }
+  flush_batch(renderer);
+}
+
+bool renderer_capture_frame(struct renderer *renderer) {
+  if (renderer->capture_tail - renderer->capture_head == RENDERER_CAPTURE_BUFFERS) {
+    return false;
+  }
+  render_capture_buffer *capture = &renderer->captures[renderer->capture_tail % RENDERER_CAPTURE_BUFFERS];
+  capture->width = (uint32_t)renderer->framebuffer_size.x;
+  capture->height = (uint32_t)renderer->framebuffer_size.y;
+  capture->frame_index = renderer->frame_index;
+  uintptr_t size = (uintptr_t)capture->width * capture->height * 4;
+  // buffers are created on the first capture and only grow with the window
+  if (capture->buffer == 0) {
+    glGenBuffers(1, &capture->buffer);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->buffer);
+  if (capture->size < size) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    capture->size = size;
+  }
+  // with a pack buffer bound the read only queues a copy, the pixels land in the buffer offset zero
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->window_fbo);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, (void *)0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  capture->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  renderer->capture_tail++;
+  return true;
+}
+
+bool renderer_read_capture(struct renderer *renderer, mem_allocator *allocator, bool wait,
+                           render_capture *out) {
+  if (renderer->capture_head == renderer->capture_tail) {
+    return false;
+  }
+  render_capture_buffer *capture = &renderer->captures[renderer->capture_head % RENDERER_CAPTURE_BUFFERS];
+  GLenum status = glClientWaitSync(capture->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? UINT64_MAX : 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    return false;
+  }
+  glDeleteSync(capture->fence);
+  capture->fence = NULL;
+  renderer->capture_head++;
+
+  uintptr_t row_bytes = (uintptr_t)capture->width * 4;
+  uint8_t *pixels = allocator_alloc(allocator, uint8_t, row_bytes * capture->height);
+  assert(pixels != NULL);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->buffer);
+  uint8_t *mapped =
+      (uint8_t *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, row_bytes * capture->height, GL_MAP_READ_BIT);
+  assert(mapped != NULL);
+  // GL rows start at the bottom
+  for (uint32_t y = 0; y < capture->height; y++) {
+    memcpy(pixels + y * row_bytes, mapped + (capture->height - 1 - y) * row_bytes, row_bytes);
+  }
+  glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  *out = (render_capture){
+      .pixels = pixels,
+      .width = capture->width,
+      .height = capture->height,
+      .frame_index = capture->frame_index,
+  };
+  return true;
+}
+
+void renderer_set_resolution_config(struct renderer *renderer, render_resolution_config config) {
+  assert(config.min_scale > 0.0f && config.min_scale <= config.max_scale && config.max_scale <= 1.0f);
+  renderer->resolution = config;
+  renderer->render_scale = glm::clamp(renderer->render_scale, config.min_scale, config.max_scale);
+  renderer->frames_since_rescale = 0;
+  renderer->scene_gpu_ms = 0.0f;
+}
+
+float renderer_get_render_scale(struct renderer *renderer) { return renderer->render_scale; }
+
+float renderer_get_scene_gpu_ms(struct renderer *renderer) { return renderer->scene_gpu_ms; }
+
+uint32_t renderer_get_draw_call_count(struct renderer *renderer) { return renderer->draw_call_count; }
+
+render_state_stats renderer_get_state_stats(struct renderer *renderer) {
+  return (render_state_stats){
+      .issued_count = renderer->last_issued_count,
+      .elided_count = renderer->last_elided_count,
+      .texture_bind_count = renderer->last_texture_bind_count,
+      .draw_call_count = renderer->last_draw_call_count,
+  };
 }
 
 void renderer_render_clear(struct renderer *renderer, glm::vec4 color) {
+  flush_batch(renderer);
   glm::vec4 gl_color = color / 255.0f;
   glClearColor(gl_color.r, gl_color.g, gl_color.b, gl_color.a);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -156,37 +1405,211 @@ void renderer_render_clear(struct renderer *renderer, glm::vec4 color) {
 
 void renderer_render_quad(struct renderer *renderer, render_cmd_quad quad) {
   glm::vec4 gl_color = glm::vec4(quad.color) / 255.0f;
-  GLuint texture_id = quad.texture_id != 0 ? quad.texture_id : renderer->empty_texture;
-  glUniform1i(renderer->single_channel_loc, GL_FALSE);
-  render_quad(renderer, texture_id, quad.pos, quad.size, gl_color);
+  GLuint texture_id = use_texture(renderer, quad.texture_id);
+  glm::vec4 uv_rect = quad.uv_rect == glm::vec4(0.0f) ? glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) : quad.uv_rect;
+  glm::mat2 basis = quad.basis == glm::mat2(0.0f) ? glm::mat2(1.0f) : quad.basis;
+  render_quad(renderer, texture_id, quad.pos, quad.size, gl_color, false, uv_rect, basis);
 }
 
 void renderer_render_glyph(struct renderer *renderer, render_cmd_glyph glyph) {
   glm::vec4 gl_color = glm::vec4(glyph.color) / 255.0f;
-  glUniform1i(renderer->single_channel_loc, GL_TRUE);
   assert(glyph.texture_id != 0);
-  render_quad(renderer, glyph.texture_id, glyph.pos, glyph.size, gl_color);
+  glm::vec4 uv_rect = glyph.uv_rect == glm::vec4(0.0f) ? glm::vec4(0.0f, 0.0f, 1.0f, 1.0f) : glyph.uv_rect;
+  GLuint texture_id = use_texture(renderer, glyph.texture_id);
+  render_quad(renderer, texture_id, glyph.pos, glyph.size, gl_color, true, uv_rect, glm::mat2(1.0f));
 }
 
 void renderer_delete_texture(struct renderer *renderer, render_cmd_delete_texture delete_texture) {
-  glDeleteTextures(1, delete_texture.texture_id);
+  uint32_t texture_id = *delete_texture.texture_id;
+  if (texture_id == 0) {
+    return;
+  }
+  // the batch may still reference it
+  flush_batch(renderer);
+  render_texture *texture = &renderer->textures[texture_id - 1];
+  if (texture->gl_texture != 0) {
+    glDeleteTextures(1, &texture->gl_texture);
+    gl_forget_texture(&renderer->gl, texture->gl_texture);
+    renderer->resident_texture_bytes -= texture->bytes;
+  }
+  for (uint32_t i = renderer->upload_head; i != renderer->upload_tail; i++) {
+    render_upload *upload = &renderer->uploads[i % RENDERER_MAX_UPLOADS];
+    if (upload->texture_id == texture_id) {
+      upload->texture_id = 0;
+    }
+  }
+  *texture = {};
   *delete_texture.texture_id = 0;
 }
 
 void renderer_load_texture(struct renderer *renderer, render_cmd_load_texture load_texture) {
-  *load_texture.texture_id = load_sprite_texture(load_texture.data, load_texture.size.x, load_texture.size.y);
+  *load_texture.texture_id = create_texture(renderer, load_texture.data, load_texture.size, false,
+                                            load_texture.mipmaps, load_texture.reload,
+                                            load_texture.reload_user, load_texture.reload_index);
+}
+
+void renderer_update_texture(struct renderer *renderer, render_cmd_update_texture update_texture) {
+  assert(update_texture.texture_id != 0 && update_texture.texture_id <= RENDERER_MAX_TEXTURES);
+  render_texture *texture = &renderer->textures[update_texture.texture_id - 1];
+  assert(!texture->single_channel && "Glyphs can't be updated");
+  if (texture->gl_texture == 0) {
+    // evicted, the next draw reloads it anyway
+    return;
+  }
+  queue_upload(renderer, update_texture.texture_id, update_texture.data);
+}
+
+void renderer_set_texture_reload(struct renderer *renderer, render_cmd_set_texture_reload set_reload) {
+  assert(set_reload.texture_id != 0 && set_reload.texture_id <= RENDERER_MAX_TEXTURES);
+  render_texture *texture = &renderer->textures[set_reload.texture_id - 1];
+  assert(texture->in_use);
+  texture->reload = set_reload.reload;
+  texture->reload_user = set_reload.reload_user;
+  texture->reload_index = set_reload.reload_index;
 }
 
 void renderer_load_glyph(struct renderer *renderer, render_cmd_load_glyph load_glyph) {
-  GLuint texture;
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glGenTextures(1, &texture);
-  glBindTexture(GL_TEXTURE_2D, texture);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, load_glyph.size.x, load_glyph.size.y, 0, GL_RED, GL_UNSIGNED_BYTE,
-               load_glyph.data);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  *load_glyph.texture_id = texture;
+  *load_glyph.texture_id = create_texture(renderer, load_glyph.data, load_glyph.size, true, false,
+                                          load_glyph.reload, load_glyph.reload_user, load_glyph.reload_index);
+}
+
+void renderer_load_mesh(struct renderer *renderer, render_cmd_load_mesh load_mesh) {
+  assert(load_mesh.quad_count <= RENDERER_MAX_MESH_QUADS);
+  uint32_t mesh_id = *load_mesh.mesh_id;
+  if (mesh_id == 0) {
+    for (uint32_t i = 0; i < RENDERER_MAX_MESHES; i++) {
+      if (renderer->meshes[i].vao == 0) {
+        mesh_id = i + 1;
+        break;
+      }
+    }
+    assert(mesh_id != 0 && "Out of mesh slots");
+
+    create_mesh_buffers(renderer, &renderer->meshes[mesh_id - 1]);
+  }
+
+  // rebuilding an existing mesh reuses its buffers
+  render_mesh *mesh = &renderer->meshes[mesh_id - 1];
+  glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(render_vertex) * 4 * load_mesh.quad_count, load_mesh.vertices,
+               GL_STATIC_DRAW);
+  mesh->quad_count = load_mesh.quad_count;
+  mesh->lost = false;
+  *load_mesh.mesh_id = mesh_id;
+}
+
+void renderer_render_mesh(struct renderer *renderer, render_cmd_mesh cmd) {
+  assert(cmd.mesh_id != 0 && cmd.mesh_id <= RENDERER_MAX_MESHES);
+  render_mesh *mesh = &renderer->meshes[cmd.mesh_id - 1];
+  if (mesh->quad_count == 0) {
+    return;
+  }
+
+  flush_batch(renderer);
+  glm::vec4 gl_color = glm::vec4(cmd.color) / 255.0f;
+  gl_bind_texture(&renderer->gl, 0, use_texture(renderer, cmd.texture_id));
+  gl_use_program(&renderer->gl, renderer->quad_program);
+  gl_uniform_mat4(&renderer->gl, renderer->model_loc, glm::translate(glm::mat4(1.0f), cmd.pos));
+  gl_bind_vertex_array(&renderer->gl, mesh->vao);
+  // mesh vertices have no color or channel flag, so those attributes come from the current values
+  glVertexAttrib4f(2, gl_color.r, gl_color.g, gl_color.b, gl_color.a);
+  glVertexAttrib1f(3, 0.0f);
+  glDrawElements(GL_TRIANGLES, mesh->quad_count * 6, GL_UNSIGNED_INT, 0);
+  renderer->draw_call_count++;
+}
+
+bool renderer_is_mesh_lost(struct renderer *renderer, uint32_t mesh_id) {
+  assert(mesh_id != 0 && mesh_id <= RENDERER_MAX_MESHES);
+  return renderer->meshes[mesh_id - 1].lost;
+}
+
+void renderer_delete_mesh(struct renderer *renderer, render_cmd_delete_mesh delete_mesh) {
+  uint32_t mesh_id = *delete_mesh.mesh_id;
+  if (mesh_id == 0) {
+    return;
+  }
+  render_mesh *mesh = &renderer->meshes[mesh_id - 1];
+  glDeleteBuffers(1, &mesh->vbo);
+  glDeleteVertexArrays(1, &mesh->vao);
+  gl_forget_vertex_array(&renderer->gl, mesh->vao);
+  *mesh = {};
+  *delete_mesh.mesh_id = 0;
+}
+
+render_instance *renderer_map_instances(struct renderer *renderer, uint32_t count) {
+  assert(renderer->mapped_instances == 0 && "Instances are already mapped");
+  if (count == 0) {
+    return NULL;
+  }
+  // orphan last draw's storage so mapping never waits on the GPU
+  GLsizeiptr size = sizeof(render_instance) * count;
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->instance_vbo);
+  glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+  void *instances =
+      glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+  assert(instances != NULL);
+  renderer->mapped_instances = count;
+  return (render_instance *)instances;
+}
+
+void renderer_render_instances(struct renderer *renderer, render_cmd_instances cmd) {
+  if (renderer->mapped_instances == 0) {
+    return;
+  }
+  assert(cmd.count <= renderer->mapped_instances);
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->instance_vbo);
+  glUnmapBuffer(GL_ARRAY_BUFFER);
+  renderer->mapped_instances = 0;
+  if (cmd.count == 0) {
+    return;
+  }
+
+  flush_batch(renderer);
+  gl_use_program(&renderer->gl, renderer->particle_program);
+  gl_uniform_mat4(&renderer->gl, renderer->particle_view_loc, renderer->view);
+  gl_uniform_mat4(&renderer->gl, renderer->particle_projection_loc, renderer->projection);
+  gl_uniform_int(&renderer->gl, renderer->particle_texture_loc, 0);
+  gl_bind_texture(&renderer->gl, 0, use_texture(renderer, cmd.texture_id));
+  gl_bind_vertex_array(&renderer->gl, renderer->particle_vao);
+
+  // translucent particles shouldn't hide each other through the depth buffer
+  gl_set_depth_mask(&renderer->gl, false);
+  glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, cmd.count);
+  renderer->draw_call_count++;
+  gl_set_depth_mask(&renderer->gl, true);
+}
+
+void renderer_render_debug(struct renderer *renderer, render_cmd_debug cmd) {
+  assert(cmd.line_vertex_count % 2 == 0 && cmd.triangle_vertex_count % 3 == 0);
+  uint32_t vertex_count = cmd.line_vertex_count + cmd.triangle_vertex_count;
+  if (vertex_count == 0) {
+    return;
+  }
+
+  flush_batch(renderer);
+  gl_use_program(&renderer->gl, renderer->quad_program);
+  gl_uniform_mat4(&renderer->gl, renderer->model_loc, glm::mat4(1.0f));
+  gl_bind_texture(&renderer->gl, 0, renderer->empty_texture);
+  gl_bind_vertex_array(&renderer->gl, renderer->debug_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, renderer->debug_vbo);
+  // orphaned every time, the stream is rebuilt every frame anyway
+  GLsizeiptr triangle_size = sizeof(render_debug_vertex) * cmd.triangle_vertex_count;
+  glBufferData(GL_ARRAY_BUFFER, sizeof(render_debug_vertex) * vertex_count, NULL, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, triangle_size, cmd.triangle_vertices);
+  glBufferSubData(GL_ARRAY_BUFFER, triangle_size, sizeof(render_debug_vertex) * cmd.line_vertex_count,
+                  cmd.line_vertices);
+  glVertexAttrib2f(1, 0.0f, 0.0f);
+  glVertexAttrib1f(3, 0.0f);
+
+  // debug shapes are meant to be seen, so nothing drawn before hides them
+  gl_set_depth_test(&renderer->gl, false);
+  if (cmd.triangle_vertex_count > 0) {
+    glDrawArrays(GL_TRIANGLES, 0, cmd.triangle_vertex_count);
+    renderer->draw_call_count++;
+  }
+  if (cmd.line_vertex_count > 0) {
+    glDrawArrays(GL_LINES, cmd.triangle_vertex_count, cmd.line_vertex_count);
+    renderer->draw_call_count++;
+  }
+  gl_set_depth_test(&renderer->gl, true);
 }
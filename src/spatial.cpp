@@ -0,0 +1,249 @@
+#include "spatial.hpp"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+static uint32_t next_power_of_two(uint32_t v) {
+  uint32_t result = 1;
+  while (result < v) {
+    result <<= 1;
+  }
+  return result;
+}
+
+static int32_t cell_coord(const spatial_grid *grid, float v) {
+  return (int32_t)floorf(v * grid->inv_cell_size);
+}
+
+static uint32_t cell_bucket(const spatial_grid *grid, int32_t cx, int32_t cy) {
+  uint32_t h = ((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u);
+  return h & grid->bucket_mask;
+}
+
+// Past a cell in either half extent an object could overlap cells further out than queries look, so it goes
+// into the oversized bucket after the hashed ones, which every query walks.
+static uint32_t aabb_bucket(const spatial_grid *grid, spatial_aabb aabb) {
+  glm::vec2 half_extent = (aabb.max - aabb.min) * 0.5f;
+  if (half_extent.x > grid->cell_size || half_extent.y > grid->cell_size) {
+    return grid->bucket_mask + 1;
+  }
+  glm::vec2 center = (aabb.min + aabb.max) * 0.5f;
+  return cell_bucket(grid, cell_coord(grid, center.x), cell_coord(grid, center.y));
+}
+
+static bool aabb_overlaps(spatial_aabb a, spatial_aabb b) {
+  return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y && a.max.y >= b.min.y;
+}
+
+static void link_object(spatial_grid *grid, uint32_t id, uint32_t bucket) {
+  uint32_t head = grid->buckets[bucket];
+  grid->next[id] = head;
+  grid->prev[id] = SPATIAL_NULL;
+  if (head != SPATIAL_NULL) {
+    grid->prev[head] = id;
+  }
+  grid->buckets[bucket] = id;
+  grid->bucket[id] = bucket;
+}
+
+static void unlink_object(spatial_grid *grid, uint32_t id) {
+  uint32_t next = grid->next[id];
+  uint32_t prev = grid->prev[id];
+  if (prev != SPATIAL_NULL) {
+    grid->next[prev] = next;
+  } else {
+    grid->buckets[grid->bucket[id]] = next;
+  }
+  if (next != SPATIAL_NULL) {
+    grid->prev[next] = prev;
+  }
+}
+
+static uint32_t begin_query(spatial_grid *grid) {
+  grid->query_stamp++;
+  if (grid->query_stamp == 0) {
+    // stamps wrapped around, forget every previous query
+    memset(grid->stamp, 0, sizeof(uint32_t) * grid->capacity);
+    grid->query_stamp = 1;
+  }
+  return grid->query_stamp;
+}
+
+/** Calls `visit(id)` once for every oversized object and every object whose center cell could overlap
+ * `aabb`. The rest are at most a cell in half extent, so the range only grows by one cell a side. Several
+ * cells may share a bucket, so objects are stamped per query to avoid reporting them twice. Stops when
+ * `visit` returns false.
+ */
+template <typename F> static void for_each_candidate(spatial_grid *grid, spatial_aabb aabb, F &&visit) {
+  uint32_t stamp = begin_query(grid);
+  int32_t x0 = cell_coord(grid, aabb.min.x - grid->cell_size);
+  int32_t y0 = cell_coord(grid, aabb.min.y - grid->cell_size);
+  int32_t x1 = cell_coord(grid, aabb.max.x + grid->cell_size);
+  int32_t y1 = cell_coord(grid, aabb.max.y + grid->cell_size);
+
+  auto visit_bucket = [&](uint32_t bucket) {
+    for (uint32_t id = grid->buckets[bucket]; id != SPATIAL_NULL; id = grid->next[id]) {
+      if (grid->stamp[id] == stamp) {
+        continue;
+      }
+      grid->stamp[id] = stamp;
+      if (!visit(id)) {
+        return false;
+      }
+    }
+    return true;
+  };
+
+  if (!visit_bucket(grid->bucket_mask + 1)) {
+    return;
+  }
+
+  // a range covering more cells than there are buckets touches every bucket anyway
+  uint64_t cell_count = (uint64_t)(x1 - x0 + 1) * (uint64_t)(y1 - y0 + 1);
+  if (cell_count > (uint64_t)grid->bucket_mask + 1) {
+    for (uint32_t bucket = 0; bucket <= grid->bucket_mask; bucket++) {
+      if (!visit_bucket(bucket)) {
+        return;
+      }
+    }
+    return;
+  }
+
+  for (int32_t cy = y0; cy <= y1; cy++) {
+    for (int32_t cx = x0; cx <= x1; cx++) {
+      if (!visit_bucket(cell_bucket(grid, cx, cy))) {
+        return;
+      }
+    }
+  }
+}
+
+spatial_grid spatial_grid_init(uint32_t capacity, float cell_size, mem_allocator *allocator) {
+  assert(capacity > 0 && capacity < SPATIAL_NULL);
+  assert(cell_size > 0.0f);
+
+  uint32_t bucket_count = next_power_of_two(capacity < 64 ? 64 : capacity);
+  spatial_grid grid = {
+      .cell_size = cell_size,
+      .inv_cell_size = 1.0f / cell_size,
+      .bucket_mask = bucket_count - 1,
+      .buckets = allocator_alloc(allocator, uint32_t, bucket_count + 1),
+      .capacity = capacity,
+      .bounds = allocator_alloc(allocator, spatial_aabb, capacity),
+      .next = allocator_alloc(allocator, uint32_t, capacity),
+      .prev = allocator_alloc(allocator, uint32_t, capacity),
+      .bucket = allocator_alloc(allocator, uint32_t, capacity),
+      .stamp = allocator_alloc(allocator, uint32_t, capacity),
+  };
+  assert(grid.buckets != NULL && grid.bounds != NULL && grid.next != NULL && grid.prev != NULL &&
+         grid.bucket != NULL && grid.stamp != NULL);
+
+  spatial_grid_clear(&grid);
+  return grid;
+}
+
+void spatial_grid_destroy(spatial_grid *grid, mem_allocator *allocator) {
+  allocator_dealloc(allocator, grid->stamp);
+  allocator_dealloc(allocator, grid->bucket);
+  allocator_dealloc(allocator, grid->prev);
+  allocator_dealloc(allocator, grid->next);
+  allocator_dealloc(allocator, grid->bounds);
+  allocator_dealloc(allocator, grid->buckets);
+  *grid = {};
+}
+
+void spatial_grid_clear(spatial_grid *grid) {
+  memset(grid->buckets, 0xFF, sizeof(uint32_t) * (grid->bucket_mask + 2));
+  memset(grid->stamp, 0, sizeof(uint32_t) * grid->capacity);
+  for (uint32_t i = 0; i < grid->capacity; i++) {
+    grid->next[i] = i + 1 < grid->capacity ? i + 1 : SPATIAL_NULL;
+    grid->bucket[i] = SPATIAL_NULL;
+  }
+  grid->free_head = 0;
+  grid->count = 0;
+  grid->query_stamp = 0;
+}
+
+uint32_t spatial_grid_insert(spatial_grid *grid, spatial_aabb aabb) {
+  uint32_t id = grid->free_head;
+  assert(id != SPATIAL_NULL && "Spatial grid is full");
+  grid->free_head = grid->next[id];
+
+  grid->bounds[id] = aabb;
+  link_object(grid, id, aabb_bucket(grid, aabb));
+  grid->count++;
+  return id;
+}
+
+void spatial_grid_update(spatial_grid *grid, uint32_t id, spatial_aabb aabb) {
+  assert(id < grid->capacity && grid->bucket[id] != SPATIAL_NULL);
+  grid->bounds[id] = aabb;
+
+  // most moves stay inside the same cell and need no relinking
+  uint32_t bucket = aabb_bucket(grid, aabb);
+  if (bucket != grid->bucket[id]) {
+    unlink_object(grid, id);
+    link_object(grid, id, bucket);
+  }
+}
+
+void spatial_grid_remove(spatial_grid *grid, uint32_t id) {
+  assert(id < grid->capacity && grid->bucket[id] != SPATIAL_NULL);
+  unlink_object(grid, id);
+  grid->bucket[id] = SPATIAL_NULL;
+  grid->next[id] = grid->free_head;
+  grid->free_head = id;
+  grid->count--;
+}
+
+uint32_t spatial_grid_query_aabb(spatial_grid *grid, spatial_aabb aabb, uint32_t *out, uint32_t max_out) {
+  uint32_t count = 0;
+  if (max_out == 0) {
+    return 0;
+  }
+  for_each_candidate(grid, aabb, [&](uint32_t id) {
+    if (aabb_overlaps(grid->bounds[id], aabb)) {
+      out[count++] = id;
+    }
+    return count < max_out;
+  });
+  return count;
+}
+
+uint32_t spatial_grid_query_radius(spatial_grid *grid, glm::vec2 center, float radius, uint32_t *out,
+                                   uint32_t max_out) {
+  uint32_t count = 0;
+  if (max_out == 0) {
+    return 0;
+  }
+  spatial_aabb range = {.min = center - radius, .max = center + radius};
+  float radius_sq = radius * radius;
+  for_each_candidate(grid, range, [&](uint32_t id) {
+    spatial_aabb bounds = grid->bounds[id];
+    glm::vec2 closest = glm::clamp(center, bounds.min, bounds.max);
+    glm::vec2 d = center - closest;
+    if (d.x * d.x + d.y * d.y <= radius_sq) {
+      out[count++] = id;
+    }
+    return count < max_out;
+  });
+  return count;
+}
+
+uint32_t spatial_grid_query_pairs(spatial_grid *grid, spatial_pair *out, uint32_t max_out) {
+  uint32_t count = 0;
+  for (uint32_t a = 0; a < grid->capacity && count < max_out; a++) {
+    if (grid->bucket[a] == SPATIAL_NULL) {
+      continue;
+    }
+    spatial_aabb bounds = grid->bounds[a];
+    // only report each pair once, from the side with the lower id
+    for_each_candidate(grid, bounds, [&](uint32_t b) {
+      if (b > a && aabb_overlaps(bounds, grid->bounds[b])) {
+        out[count++] = (spatial_pair){.a = a, .b = b};
+      }
+      return count < max_out;
+    });
+  }
+  return count;
+}
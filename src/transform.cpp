@@ -0,0 +1,246 @@
+#include "transform.hpp"
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <xmmintrin.h>
+
+transform_hierarchy transform_hierarchy_init(uint32_t capacity, mem_allocator *allocator) {
+  assert(capacity > 0 && capacity < TRANSFORM_NULL);
+  transform_hierarchy hierarchy = {
+      .capacity = capacity,
+      .count = 0,
+      .first_dirty = TRANSFORM_NULL,
+      .updated_count = 0,
+      .free_head = 0,
+  };
+  hierarchy.parent = allocator_alloc(allocator, uint32_t, capacity);
+  hierarchy.index_to_id = allocator_alloc(allocator, uint32_t, capacity);
+  hierarchy.local = allocator_alloc(allocator, transform_local, capacity);
+  hierarchy.world = allocator_alloc(allocator, transform_affine, capacity);
+  hierarchy.world_z = allocator_alloc(allocator, float, capacity);
+  hierarchy.dirty = allocator_alloc(allocator, uint8_t, capacity);
+  hierarchy.id_to_index = allocator_alloc(allocator, uint32_t, capacity);
+  hierarchy.order = allocator_alloc(allocator, uint32_t, capacity);
+  hierarchy.remap = allocator_alloc(allocator, uint32_t, capacity);
+  size_t scratch_stride = glm::max(sizeof(transform_affine), sizeof(transform_local));
+  hierarchy.scratch = allocator_alloc_impl(allocator, scratch_stride * capacity, alignof(transform_affine));
+  assert(hierarchy.parent != NULL && hierarchy.index_to_id != NULL && hierarchy.local != NULL &&
+         hierarchy.world != NULL && hierarchy.world_z != NULL && hierarchy.dirty != NULL &&
+         hierarchy.id_to_index != NULL && hierarchy.order != NULL && hierarchy.remap != NULL &&
+         hierarchy.scratch != NULL);
+
+  memset(hierarchy.dirty, 0, capacity);
+  for (uint32_t i = 0; i < capacity; i++) {
+    hierarchy.id_to_index[i] = i + 1 < capacity ? i + 1 : TRANSFORM_NULL;
+  }
+  return hierarchy;
+}
+
+void transform_hierarchy_destroy(transform_hierarchy *hierarchy, mem_allocator *allocator) {
+  allocator_dealloc(allocator, hierarchy->scratch);
+  allocator_dealloc(allocator, hierarchy->remap);
+  allocator_dealloc(allocator, hierarchy->order);
+  allocator_dealloc(allocator, hierarchy->id_to_index);
+  allocator_dealloc(allocator, hierarchy->dirty);
+  allocator_dealloc(allocator, hierarchy->world_z);
+  allocator_dealloc(allocator, hierarchy->world);
+  allocator_dealloc(allocator, hierarchy->local);
+  allocator_dealloc(allocator, hierarchy->index_to_id);
+  allocator_dealloc(allocator, hierarchy->parent);
+  *hierarchy = {};
+}
+
+static uint32_t index_of(transform_hierarchy *hierarchy, uint32_t id) {
+  assert(id < hierarchy->capacity);
+  uint32_t index = hierarchy->id_to_index[id];
+  assert(index < hierarchy->count && hierarchy->index_to_id[index] == id && "Transform was destroyed");
+  return index;
+}
+
+static void mark_dirty(transform_hierarchy *hierarchy, uint32_t index) {
+  hierarchy->dirty[index] = 1;
+  hierarchy->first_dirty = glm::min(hierarchy->first_dirty, index);
+}
+
+static void permute(void *array, size_t stride, uint32_t first, uint32_t count, const uint32_t *order,
+                    void *scratch) {
+  uint8_t *base = (uint8_t *)array;
+  for (uint32_t k = 0; k < count; k++) {
+    memcpy((uint8_t *)scratch + k * stride, base + order[k] * stride, stride);
+  }
+  memcpy(base + first * stride, scratch, count * stride);
+}
+
+/** Moves the subtree under `root` behind everything else, keeping the relative order on both sides so every
+ * parent still comes before its children. Returns the new index of `root`.
+ */
+static uint32_t move_subtree_to_end(transform_hierarchy *hierarchy, uint32_t root) {
+  uint32_t first = root;
+  uint32_t count = hierarchy->count - first;
+
+  // descendants come after their parents, so one pass finds the whole subtree
+  uint32_t *in_subtree = hierarchy->remap;
+  in_subtree[root] = 1;
+  for (uint32_t i = root + 1; i < hierarchy->count; i++) {
+    uint32_t parent = hierarchy->parent[i];
+    in_subtree[i] = parent != TRANSFORM_NULL && parent >= first && in_subtree[parent];
+  }
+  uint32_t kept = 0;
+  for (uint32_t i = first; i < hierarchy->count; i++) {
+    if (!in_subtree[i]) {
+      hierarchy->order[kept++] = i;
+    }
+  }
+  uint32_t moved = kept;
+  for (uint32_t i = first; i < hierarchy->count; i++) {
+    if (in_subtree[i]) {
+      hierarchy->order[moved++] = i;
+    }
+  }
+  for (uint32_t k = 0; k < count; k++) {
+    hierarchy->remap[hierarchy->order[k]] = first + k;
+  }
+
+  permute(hierarchy->parent, sizeof(uint32_t), first, count, hierarchy->order, hierarchy->scratch);
+  permute(hierarchy->index_to_id, sizeof(uint32_t), first, count, hierarchy->order, hierarchy->scratch);
+  permute(hierarchy->local, sizeof(transform_local), first, count, hierarchy->order, hierarchy->scratch);
+  permute(hierarchy->world, sizeof(transform_affine), first, count, hierarchy->order, hierarchy->scratch);
+  permute(hierarchy->world_z, sizeof(float), first, count, hierarchy->order, hierarchy->scratch);
+  permute(hierarchy->dirty, sizeof(uint8_t), first, count, hierarchy->order, hierarchy->scratch);
+  for (uint32_t i = first; i < hierarchy->count; i++) {
+    uint32_t parent = hierarchy->parent[i];
+    if (parent != TRANSFORM_NULL && parent >= first) {
+      hierarchy->parent[i] = hierarchy->remap[parent];
+    }
+    hierarchy->id_to_index[hierarchy->index_to_id[i]] = i;
+  }
+  // dirty flags moved along with their nodes
+  if (hierarchy->first_dirty != TRANSFORM_NULL) {
+    hierarchy->first_dirty = glm::min(hierarchy->first_dirty, first);
+  }
+  return first + kept;
+}
+
+uint32_t transform_create(transform_hierarchy *hierarchy, uint32_t parent_id) {
+  assert(hierarchy->count < hierarchy->capacity && hierarchy->free_head != TRANSFORM_NULL &&
+         "Out of transforms");
+  uint32_t id = hierarchy->free_head;
+  hierarchy->free_head = hierarchy->id_to_index[id];
+
+  // appending keeps the parent first
+  uint32_t index = hierarchy->count++;
+  hierarchy->parent[index] = parent_id == TRANSFORM_NULL ? TRANSFORM_NULL : index_of(hierarchy, parent_id);
+  hierarchy->index_to_id[index] = id;
+  hierarchy->id_to_index[id] = index;
+  hierarchy->local[index] = (transform_local){
+      .pos = glm::vec3(0.0f),
+      .rotation = 0.0f,
+      .scale = glm::vec2(1.0f),
+  };
+  mark_dirty(hierarchy, index);
+  return id;
+}
+
+void transform_destroy(transform_hierarchy *hierarchy, uint32_t id) {
+  uint32_t root = move_subtree_to_end(hierarchy, index_of(hierarchy, id));
+  for (uint32_t i = root; i < hierarchy->count; i++) {
+    uint32_t freed = hierarchy->index_to_id[i];
+    hierarchy->id_to_index[freed] = hierarchy->free_head;
+    hierarchy->free_head = freed;
+    hierarchy->index_to_id[i] = TRANSFORM_NULL;
+  }
+  hierarchy->count = root;
+}
+
+void transform_set_parent(transform_hierarchy *hierarchy, uint32_t id, uint32_t parent_id) {
+  uint32_t index = index_of(hierarchy, id);
+  uint32_t parent = TRANSFORM_NULL;
+  if (parent_id != TRANSFORM_NULL) {
+    parent = index_of(hierarchy, parent_id);
+    for (uint32_t ancestor = parent; ancestor != TRANSFORM_NULL; ancestor = hierarchy->parent[ancestor]) {
+      assert(ancestor != index && "A transform can't be parented to its own descendant");
+    }
+    // a later parent would break the ordering, so the subtree moves behind it
+    if (parent > index) {
+      index = move_subtree_to_end(hierarchy, index);
+      parent = hierarchy->id_to_index[parent_id];
+    }
+  }
+  hierarchy->parent[index] = parent;
+  mark_dirty(hierarchy, index);
+}
+
+void transform_set_local(transform_hierarchy *hierarchy, uint32_t id, transform_local local) {
+  uint32_t index = index_of(hierarchy, id);
+  hierarchy->local[index] = local;
+  mark_dirty(hierarchy, index);
+}
+
+transform_local transform_get_local(transform_hierarchy *hierarchy, uint32_t id) {
+  return hierarchy->local[index_of(hierarchy, id)];
+}
+
+static void local_to_affine(const transform_local *local, transform_affine *out) {
+  float c = cosf(local->rotation);
+  float s = sinf(local->rotation);
+  *out = (transform_affine){{
+      {c * local->scale.x, -s * local->scale.y, local->pos.x, 0.0f},
+      {s * local->scale.x, c * local->scale.y, local->pos.y, 0.0f},
+  }};
+}
+
+static void compose(const transform_affine *parent, const transform_affine *local, transform_affine *out) {
+  __m128 local0 = _mm_load_ps(local->rows[0]);
+  __m128 local1 = _mm_load_ps(local->rows[1]);
+  // picks the parent's translation out of its row
+  __m128 unit_z = _mm_set_ps(0.0f, 1.0f, 0.0f, 0.0f);
+  for (uint32_t r = 0; r < 2; r++) {
+    __m128 row = _mm_load_ps(parent->rows[r]);
+    __m128 result = _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(0, 0, 0, 0)), local0);
+    result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(row, row, _MM_SHUFFLE(1, 1, 1, 1)), local1));
+    result = _mm_add_ps(result, _mm_mul_ps(row, unit_z));
+    _mm_store_ps(out->rows[r], result);
+  }
+}
+
+void transform_update(transform_hierarchy *hierarchy) {
+  hierarchy->updated_count = 0;
+  uint32_t first = hierarchy->first_dirty;
+  if (first >= hierarchy->count) {
+    hierarchy->first_dirty = TRANSFORM_NULL;
+    return;
+  }
+
+  // a parent is always visited before its children, so its flag already says whether it changed
+  for (uint32_t i = first; i < hierarchy->count; i++) {
+    uint32_t parent = hierarchy->parent[i];
+    if (!hierarchy->dirty[i] && (parent == TRANSFORM_NULL || !hierarchy->dirty[parent])) {
+      continue;
+    }
+    hierarchy->dirty[i] = 1;
+    transform_local *local = &hierarchy->local[i];
+    if (parent == TRANSFORM_NULL) {
+      local_to_affine(local, &hierarchy->world[i]);
+      hierarchy->world_z[i] = local->pos.z;
+    } else {
+      transform_affine local_affine;
+      local_to_affine(local, &local_affine);
+      compose(&hierarchy->world[parent], &local_affine, &hierarchy->world[i]);
+      hierarchy->world_z[i] = hierarchy->world_z[parent] + local->pos.z;
+    }
+    hierarchy->updated_count++;
+  }
+  memset(hierarchy->dirty + first, 0, hierarchy->count - first);
+  hierarchy->first_dirty = TRANSFORM_NULL;
+}
+
+glm::vec3 transform_get_world_pos(transform_hierarchy *hierarchy, uint32_t id) {
+  uint32_t index = index_of(hierarchy, id);
+  transform_affine *world = &hierarchy->world[index];
+  return glm::vec3(world->rows[0][2], world->rows[1][2], hierarchy->world_z[index]);
+}
+
+glm::mat2 transform_get_world_basis(transform_hierarchy *hierarchy, uint32_t id) {
+  transform_affine *world = &hierarchy->world[index_of(hierarchy, id)];
+  return glm::mat2(world->rows[0][0], world->rows[1][0], world->rows[0][1], world->rows[1][1]);
+}